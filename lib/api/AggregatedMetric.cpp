@@ -0,0 +1,299 @@
+//
+// Copyright (c) 2015-2020 Microsoft Corporation and Contributors.
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "AggregatedMetric.hpp"
+
+#include "pal/PAL.hpp"
+#include "pal/TaskDispatcher.hpp"
+#include "utils/Utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <mutex>
+
+namespace MAT_NS_BEGIN
+{
+
+    namespace Models {
+
+        /// <summary>
+        /// Accumulates pushed values and periodically emits them as one
+        /// ILogger::LogAggregatedMetric event.
+        ///
+        /// PushMetric is lock-free: samples are spread over a few shards by
+        /// calling thread, and every aggregate is an atomic updated in place.
+        /// The interval task drains the shards by exchanging each aggregate with
+        /// its identity value. A sample racing with the drain may have some of
+        /// its aggregates reported in the next interval.
+        /// </summary>
+        class AggregatedMetricImpl
+        {
+        public:
+            AggregatedMetricImpl(std::string const& name,
+                std::string const& units,
+                unsigned intervalInSec,
+                std::string const& instanceName,
+                std::string const& objectClass,
+                std::string const& objectId,
+                EventProperties const& eventProperties,
+                ILogger* pLogger) :
+                m_name(name),
+                m_units(units),
+                m_instanceName(instanceName),
+                m_objectClass(objectClass),
+                m_objectId(objectId),
+                m_properties(eventProperties),
+                m_logger(pLogger),
+                m_intervalMs(intervalInSec * 1000),
+                m_stopped(false),
+                m_startTimeMs(PAL::getMonotonicTimeMs())
+            {
+                for (Shard& shard : m_shards)
+                {
+                    shard.reset();
+                }
+
+                if (m_logger == nullptr)
+                {
+                    LOG_WARN("AggregatedMetric %s has no logger, values will not be reported", m_name.c_str());
+                    return;
+                }
+
+                if (m_intervalMs != 0)
+                {
+                    m_taskDispatcher = PAL::getDefaultTaskDispatcher();
+                    LOCKGUARD(m_lock);
+                    m_scheduledEmit = PAL::scheduleTask(m_taskDispatcher.get(), m_intervalMs, this, &AggregatedMetricImpl::onInterval);
+                }
+            }
+
+            ~AggregatedMetricImpl()
+            {
+                {
+                    LOCKGUARD(m_lock);
+                    m_stopped = true;
+                }
+                if (m_taskDispatcher)
+                {
+                    // Waits for an interval callback that is already running
+                    m_scheduledEmit.Cancel(CancelWaitTimeMs);
+                }
+
+                // Report what was pushed since the last interval
+                emit();
+            }
+
+            void PushMetric(double value)
+            {
+                if (std::isnan(value))
+                {
+                    return;
+                }
+
+                Shard& shard = m_shards[GetThreadShardIndex(ShardCount)];
+                shard.count.fetch_add(1, std::memory_order_relaxed);
+                atomicAdd(shard.sum, value);
+                atomicAdd(shard.sumOfSquares, value * value);
+                atomicMin(shard.minimum, value);
+                atomicMax(shard.maximum, value);
+                shard.buckets[getBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+            }
+
+        protected:
+            /// Smallest and largest power of two used as a bucket boundary
+            static constexpr int MinBucketExponent = -16;
+            static constexpr int MaxBucketExponent = 47;
+            static constexpr size_t BucketCount = MaxBucketExponent - MinBucketExponent + 1;
+            static constexpr size_t ShardCount = 8;
+            static constexpr uint64_t CancelWaitTimeMs = 500;
+
+            struct Shard
+            {
+                std::atomic<uint64_t> count;
+                std::atomic<double>   sum;
+                std::atomic<double>   sumOfSquares;
+                std::atomic<double>   minimum;
+                std::atomic<double>   maximum;
+                std::atomic<uint64_t> buckets[BucketCount];
+
+                void reset()
+                {
+                    count = 0;
+                    sum = 0.0;
+                    sumOfSquares = 0.0;
+                    minimum = std::numeric_limits<double>::infinity();
+                    maximum = -std::numeric_limits<double>::infinity();
+                    for (auto& bucket : buckets)
+                    {
+                        bucket = 0;
+                    }
+                }
+            };
+
+            /// <summary>
+            /// Values are counted in power-of-two buckets: bucket e holds the
+            /// values in [2^(e-1), 2^e). Zero, negative and tiny values fall
+            /// into the lowest bucket, huge values into the highest one.
+            /// Buckets from several intervals or instances can be summed.
+            /// </summary>
+            static size_t getBucketIndex(double value)
+            {
+                int exponent = MinBucketExponent;
+                if (value > 0)
+                {
+                    std::frexp(value, &exponent);
+                }
+                if (exponent < MinBucketExponent)
+                {
+                    exponent = MinBucketExponent;
+                }
+                else if (exponent > MaxBucketExponent)
+                {
+                    exponent = MaxBucketExponent;
+                }
+                return static_cast<size_t>(exponent - MinBucketExponent);
+            }
+
+            static void atomicAdd(std::atomic<double>& target, double value)
+            {
+                double current = target.load(std::memory_order_relaxed);
+                while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed))
+                {
+                }
+            }
+
+            static void atomicMin(std::atomic<double>& target, double value)
+            {
+                double current = target.load(std::memory_order_relaxed);
+                while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+                {
+                }
+            }
+
+            static void atomicMax(std::atomic<double>& target, double value)
+            {
+                double current = target.load(std::memory_order_relaxed);
+                while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+                {
+                }
+            }
+
+            void onInterval()
+            {
+                LOCKGUARD(m_lock);
+                if (m_stopped)
+                {
+                    return;
+                }
+                emit();
+                m_scheduledEmit = PAL::scheduleTask(m_taskDispatcher.get(), m_intervalMs, this, &AggregatedMetricImpl::onInterval);
+            }
+
+            void emit()
+            {
+                const int64_t now = PAL::getMonotonicTimeMs();
+                const int64_t durationMs = now - m_startTimeMs;
+                m_startTimeMs = now;
+
+                uint64_t count = 0;
+                double sum = 0.0;
+                double sumOfSquares = 0.0;
+                double minimum = std::numeric_limits<double>::infinity();
+                double maximum = -std::numeric_limits<double>::infinity();
+                uint64_t buckets[BucketCount] = {};
+                for (Shard& shard : m_shards)
+                {
+                    count += shard.count.exchange(0);
+                    sum += shard.sum.exchange(0.0);
+                    sumOfSquares += shard.sumOfSquares.exchange(0.0);
+                    minimum = std::min(minimum, shard.minimum.exchange(std::numeric_limits<double>::infinity()));
+                    maximum = std::max(maximum, shard.maximum.exchange(-std::numeric_limits<double>::infinity()));
+                    for (size_t i = 0; i < BucketCount; i++)
+                    {
+                        buckets[i] += shard.buckets[i].exchange(0);
+                    }
+                }
+
+                if (count == 0 || m_logger == nullptr)
+                {
+                    return;
+                }
+
+                AggregatedMetricData data(m_name, static_cast<long>(durationMs * 1000), static_cast<long>(count));
+                data.units = m_units;
+                data.instanceName = m_instanceName;
+                data.objectClass = m_objectClass;
+                data.objectId = m_objectId;
+                data.aggregates[AggregateType_Sum] = sum;
+                data.aggregates[AggregateType_SumOfSquares] = sumOfSquares;
+                if (minimum <= maximum)
+                {
+                    data.aggregates[AggregateType_Minimum] = minimum;
+                    data.aggregates[AggregateType_Maximum] = maximum;
+                }
+                for (size_t i = 0; i < BucketCount; i++)
+                {
+                    if (buckets[i] != 0)
+                    {
+                        data.buckets[static_cast<long>(i) + MinBucketExponent] = static_cast<long>(buckets[i]);
+                    }
+                }
+
+                m_logger->LogAggregatedMetric(data, m_properties);
+            }
+
+            std::string                      m_name;
+            std::string                      m_units;
+            std::string                      m_instanceName;
+            std::string                      m_objectClass;
+            std::string                      m_objectId;
+            EventProperties                  m_properties;
+            ILogger*                         m_logger;
+            unsigned                         m_intervalMs;
+
+            std::mutex                       m_lock;
+            bool                             m_stopped;
+            int64_t                          m_startTimeMs;
+            std::shared_ptr<ITaskDispatcher> m_taskDispatcher;
+            PAL::DeferredCallbackHandle      m_scheduledEmit;
+
+            Shard                            m_shards[ShardCount];
+        };
+
+        AggregatedMetric::AggregatedMetric(std::string const& name,
+            std::string const& units,
+            unsigned const intervalInSec,
+            EventProperties const& eventProperties,
+            ILogger* pLogger) :
+            AggregatedMetric(name, units, intervalInSec, std::string(), std::string(), std::string(), eventProperties, pLogger)
+        {
+        }
+
+        AggregatedMetric::AggregatedMetric(std::string const& name,
+            std::string const& units,
+            unsigned const intervalInSec,
+            std::string const& instanceName,
+            std::string const& objectClass,
+            std::string const& objectId,
+            EventProperties const& eventProperties,
+            ILogger* pLogger) :
+            m_pAggregatedMetricImpl(new AggregatedMetricImpl(name, units, intervalInSec, instanceName, objectClass, objectId, eventProperties, pLogger))
+        {
+        }
+
+        AggregatedMetric::~AggregatedMetric()
+        {
+            delete static_cast<AggregatedMetricImpl*>(m_pAggregatedMetricImpl);
+        }
+
+        void AggregatedMetric::PushMetric(double value)
+        {
+            static_cast<AggregatedMetricImpl*>(m_pAggregatedMetricImpl)->PushMetric(value);
+        }
+
+    } // Models
+
+} MAT_NS_END
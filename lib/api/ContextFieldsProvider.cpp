@@ -17,7 +17,9 @@ namespace MAT_NS_BEGIN
     }
 
     ContextFieldsProvider::ContextFieldsProvider(ContextFieldsProvider* parent)
-        : m_parent(parent)
+        : m_parent(parent),
+          m_templateDirty(true),
+          m_fieldsExposed(false)
     {
         if (!m_parent)
         {
@@ -27,6 +29,8 @@ namespace MAT_NS_BEGIN
 
     ContextFieldsProvider::ContextFieldsProvider(ContextFieldsProvider const& copy)
     {
+        m_templateDirty = true;
+        m_fieldsExposed = false;
         m_parent = copy.m_parent;
         m_commonContextFields = copy.m_commonContextFields;
         m_customContextFields = copy.m_customContextFields;
@@ -41,6 +45,7 @@ namespace MAT_NS_BEGIN
         m_customContextFields = copy.m_customContextFields;
         m_commonContextEventToConfigIds = copy.m_commonContextEventToConfigIds;
         m_ticketsMap = copy.m_ticketsMap;
+        m_templateDirty = true;
         return *this;
     }
 
@@ -54,352 +59,297 @@ namespace MAT_NS_BEGIN
 
         if (record.data.size() == 0)
         {
-            ::CsProtocol::Data data;
-            record.data.push_back(data);
+            record.data.emplace_back();
         }
         if (record.extApp.size() == 0)
         {
-            ::CsProtocol::App app;
-            record.extApp.push_back(app);
+            record.extApp.emplace_back();
         }
 
         if (record.extDevice.size() == 0)
         {
-            ::CsProtocol::Device device;
-            record.extDevice.push_back(device);
+            record.extDevice.emplace_back();
         }
 
         if (record.extOs.size() == 0)
         {
-            ::CsProtocol::Os os;
-            record.extOs.push_back(os);
+            record.extOs.emplace_back();
         }
 
         if (record.extUser.size() == 0)
         {
-            ::CsProtocol::User user;
-            record.extUser.push_back(user);
+            record.extUser.emplace_back();
         }
 
         if (record.extLoc.size() == 0)
         {
-            ::CsProtocol::Loc loc;
-            record.extLoc.push_back(loc);
+            record.extLoc.emplace_back();
         }
 
         if (record.extNet.size() == 0)
         {
-            ::CsProtocol::Net net;
-            record.extNet.push_back(net);
+            record.extNet.emplace_back();
         }
 
         if (record.extProtocol.size() == 0)
         {
-            ::CsProtocol::Protocol proto;
-            record.extProtocol.push_back(proto);
+            record.extProtocol.emplace_back();
         }
 
         if (record.extM365a.size() == 0)
         {
-            ::CsProtocol::M365a m365a;
-            record.extM365a.push_back(m365a);
+            record.extM365a.emplace_back();
         }
 
         std::map<std::string, ::CsProtocol::Value>& ext = record.data[0].properties;
         {
             LOCKGUARD(m_lock);
 
-            std::string value = m_commonContextFields[COMMONFIELDS_APP_EXPERIMENTIDS].as_string;
-            if (!value.empty())
+            if (m_templateDirty || m_fieldsExposed)
+            {
+                updateRecordTemplate();
+            }
+
+            if (!m_experimentIds.empty())
             {// for ECS set event specific config ids
-                std::string eventName = record.name;
-                if (!eventName.empty())
+                const std::string* value = &m_experimentIds;
+                if (!record.name.empty())
                 {
-                    const auto& iter = m_commonContextEventToConfigIds.find(eventName);
+                    const auto& iter = m_commonContextEventToConfigIds.find(record.name);
                     if (iter != m_commonContextEventToConfigIds.end())
                     {
-                        value = iter->second;
+                        value = &iter->second;
                     }
                 }
 
-                record.extApp[0].expId = value;
+                record.extApp[0].expId = *value;
             }
 
-            if (!m_commonContextFields.empty())
+            for (auto const& property : m_commonPropertiesTemplate)
             {
-                if (m_commonContextFields.find(SESSION_IMPRESSION_ID) != m_commonContextFields.end())
-                {
-                    CsProtocol::Value temp;
-                    EventProperty prop = m_commonContextFields[SESSION_IMPRESSION_ID];
-                    temp.stringValue = prop.as_string;
-
-                    ext[SESSION_IMPRESSION_ID] = temp;
-                }
+                ext[property.first] = property.second;
+            }
 
-                if (m_commonContextFields.find(COMMONFIELDS_APP_EXPERIMENTETAG) != m_commonContextFields.end())
-                {
-                    CsProtocol::Value temp;
-                    EventProperty prop = m_commonContextFields[COMMONFIELDS_APP_EXPERIMENTETAG];
-                    temp.stringValue = prop.as_string;
+            for (auto const& assignment : m_commonFieldsTemplate)
+            {
+                assignment.field(record) = assignment.value;
+            }
 
-                    ext[COMMONFIELDS_APP_EXPERIMENTETAG] = temp;
-                }
+            if (!m_ticketsTemplate.empty())
+            {
+                CsProtocol::Protocol temp;
+                temp.ticketKeys.push_back(m_ticketsTemplate);
+                record.extProtocol.push_back(std::move(temp));
+            }
 
-                auto iter = m_commonContextFields.find(COMMONFIELDS_APP_ID);
-                bool hasAppId = (iter != m_commonContextFields.end());
-                if (hasAppId)
+            if (!commonOnly)
+            {
+                for (auto const& property : m_customPropertiesTemplate)
                 {
-                    record.extApp[0].id = iter->second.as_string;
+                    ext[property.first] = property.second;
                 }
+            }
+            LOG_TRACE("Record=%p decorated with SemanticContext=%p", &record, this);
+        }
+    }
 
-                iter = m_commonContextFields.find(COMMONFIELDS_APP_ENV);
-                bool hasAppEnv = (iter != m_commonContextFields.end());
-                if (hasAppEnv)
-                {
-                    record.extApp[0].env = iter->second.as_string;
-                }
+    void ContextFieldsProvider::updateRecordTemplate()
+    {
+        using FieldAccessor = std::string& (*)(::CsProtocol::Record&);
 
-                iter = m_commonContextFields.find(COMMONFIELDS_APP_NAME);
-                if (iter != m_commonContextFields.end())
-                {
-                    record.extApp[0].name = iter->second.as_string;
-                }
-                else if (hasAppId)
-                {
-                    // Backwards-compat: legacy Aria exporter maps CS3.0 ext.app.name to AppInfo.Id
-                    // TODO:
-                    // - consider resolving that protocol "wrinkle" backend-side
-                    // - consider parsing ext.app.id if it contains app hash!name:ver information
-                    record.extApp[0].name = record.extApp[0].id;
-                }
+        // Common fields copied verbatim into Part A extensions
+        static const std::pair<const char*, FieldAccessor> s_commonFields[] =
+        {
+            { COMMONFIELDS_APP_ID,           [](::CsProtocol::Record& r) -> std::string& { return r.extApp[0].id; } },
+            { COMMONFIELDS_APP_ENV,          [](::CsProtocol::Record& r) -> std::string& { return r.extApp[0].env; } },
+            { COMMONFIELDS_APP_VERSION,      [](::CsProtocol::Record& r) -> std::string& { return r.extApp[0].ver; } },
+            { COMMONFIELDS_APP_LANGUAGE,     [](::CsProtocol::Record& r) -> std::string& { return r.extApp[0].locale; } },
+            { COMMONFIELDS_DEVICE_ORGID,     [](::CsProtocol::Record& r) -> std::string& { return r.extDevice[0].orgId; } },
+            { COMMONFIELDS_DEVICE_MAKE,      [](::CsProtocol::Record& r) -> std::string& { return r.extProtocol[0].devMake; } },
+            { COMMONFIELDS_DEVICE_MODEL,     [](::CsProtocol::Record& r) -> std::string& { return r.extProtocol[0].devModel; } },
+            { COMMONFIELDS_DEVICE_CLASS,     [](::CsProtocol::Record& r) -> std::string& { return r.extDevice[0].deviceClass; } },
+            { COMMONFIELDS_COMMERCIAL_ID,    [](::CsProtocol::Record& r) -> std::string& { return r.extM365a[0].enrolledTenantId; } },
+            { COMMONFIELDS_OS_NAME,          [](::CsProtocol::Record& r) -> std::string& { return r.extOs[0].name; } },
+            { COMMONFIELDS_OS_BUILD,         [](::CsProtocol::Record& r) -> std::string& { return r.extOs[0].ver; } },
+            { COMMONFIELDS_USER_ID,          [](::CsProtocol::Record& r) -> std::string& { return r.extUser[0].localId; } },
+            { COMMONFIELDS_USER_LANGUAGE,    [](::CsProtocol::Record& r) -> std::string& { return r.extUser[0].locale; } },
+            { COMMONFIELDS_USER_TIMEZONE,    [](::CsProtocol::Record& r) -> std::string& { return r.extLoc[0].timezone; } },
+            { COMMONFIELDS_NETWORK_COST,     [](::CsProtocol::Record& r) -> std::string& { return r.extNet[0].cost; } },
+            { COMMONFIELDS_NETWORK_PROVIDER, [](::CsProtocol::Record& r) -> std::string& { return r.extNet[0].provider; } },
+            { COMMONFIELDS_NETWORK_TYPE,     [](::CsProtocol::Record& r) -> std::string& { return r.extNet[0].type; } }
+        };
+
+        m_experimentIds.clear();
+        m_commonFieldsTemplate.clear();
+        m_commonPropertiesTemplate.clear();
+        m_customPropertiesTemplate.clear();
+        m_ticketsTemplate.clear();
+
+        auto iter = m_commonContextFields.find(COMMONFIELDS_APP_EXPERIMENTIDS);
+        if (iter != m_commonContextFields.end())
+        {
+            m_experimentIds = iter->second.as_string;
+        }
 
-                iter = m_commonContextFields.find(COMMONFIELDS_APP_VERSION);
-                if (iter != m_commonContextFields.end())
-                {
-                    record.extApp[0].ver = iter->second.as_string;
-                }
+        for (const char* name : { SESSION_IMPRESSION_ID, COMMONFIELDS_APP_EXPERIMENTETAG })
+        {
+            iter = m_commonContextFields.find(name);
+            if (iter != m_commonContextFields.end())
+            {
+                CsProtocol::Value temp;
+                temp.stringValue = iter->second.as_string;
+                m_commonPropertiesTemplate.emplace_back(name, temp);
+            }
+        }
 
-                iter = m_commonContextFields.find(COMMONFIELDS_APP_LANGUAGE);
-                if (iter != m_commonContextFields.end())
-                {
-                    record.extApp[0].locale = iter->second.as_string;
-                }
+        for (auto const& field : s_commonFields)
+        {
+            iter = m_commonContextFields.find(field.first);
+            if (iter != m_commonContextFields.end())
+            {
+                m_commonFieldsTemplate.push_back({ field.second, iter->second.as_string });
+            }
+        }
 
-                iter = m_commonContextFields.find(COMMONFIELDS_DEVICE_ID);
-                if (iter != m_commonContextFields.end())
-                {
-                    // Use "c:" prefix
-                    std::string temp("c:");
-                    const char *deviceId = iter->second.as_string;
-                    if (deviceId != nullptr)
-                    {
-                        size_t len = strlen(deviceId);
-                        if (len >= 2 && deviceId[1] == ':' && (
-                            deviceId[0] == 'c' || // c: Custom identifier
-                            deviceId[0] == 'u' || // u: Mac OS X UUID
-                            deviceId[0] == 'a' || // a: Android ID
-                            deviceId[0] == 's' || // s: SQM ID
-                            deviceId[0] == 'x' || // x: XBox One hardware ID
-                            deviceId[0] == 'i'))  // i: iOS ID
-                        {
-                            // Remove "c:" prefix
-                            temp = "";
-                        }
-                        // Strip curly braces from GUID while populating localId.
-                        // Otherwise 1DS collector would not strip the prefix.
-                        if ((deviceId[0] == '{') && (deviceId[len - 1] == '}'))
-                        {
-                            temp.append(deviceId + 1, len - 2);
-                        }
-                        else
-                        {
-                            temp.append(deviceId);
-                        }
-                    }
-                    record.extDevice[0].localId = temp;
-                }
+        iter = m_commonContextFields.find(COMMONFIELDS_APP_NAME);
+        if (iter == m_commonContextFields.end())
+        {
+            // Backwards-compat: legacy Aria exporter maps CS3.0 ext.app.name to AppInfo.Id
+            // TODO:
+            // - consider resolving that protocol "wrinkle" backend-side
+            // - consider parsing ext.app.id if it contains app hash!name:ver information
+            iter = m_commonContextFields.find(COMMONFIELDS_APP_ID);
+        }
+        if (iter != m_commonContextFields.end())
+        {
+            m_commonFieldsTemplate.push_back({ [](::CsProtocol::Record& r) -> std::string& { return r.extApp[0].name; }, iter->second.as_string });
+        }
 
-                iter = m_commonContextFields.find(COMMONFIELDS_DEVICE_ORGID);
-                if (iter != m_commonContextFields.end())
+        iter = m_commonContextFields.find(COMMONFIELDS_DEVICE_ID);
+        if (iter != m_commonContextFields.end())
+        {
+            // Use "c:" prefix
+            std::string temp("c:");
+            const char *deviceId = iter->second.as_string;
+            if (deviceId != nullptr)
+            {
+                size_t len = strlen(deviceId);
+                if (len >= 2 && deviceId[1] == ':' && (
+                    deviceId[0] == 'c' || // c: Custom identifier
+                    deviceId[0] == 'u' || // u: Mac OS X UUID
+                    deviceId[0] == 'a' || // a: Android ID
+                    deviceId[0] == 's' || // s: SQM ID
+                    deviceId[0] == 'x' || // x: XBox One hardware ID
+                    deviceId[0] == 'i'))  // i: iOS ID
                 {
-                    record.extDevice[0].orgId = iter->second.as_string;
+                    // Remove "c:" prefix
+                    temp = "";
                 }
-
-                iter = m_commonContextFields.find(COMMONFIELDS_DEVICE_MAKE);
-                if (iter != m_commonContextFields.end())
+                // Strip curly braces from GUID while populating localId.
+                // Otherwise 1DS collector would not strip the prefix.
+                if ((deviceId[0] == '{') && (deviceId[len - 1] == '}'))
                 {
-                    record.extProtocol[0].devMake = iter->second.as_string;
+                    temp.append(deviceId + 1, len - 2);
                 }
-
-                iter = m_commonContextFields.find(COMMONFIELDS_DEVICE_MODEL);
-                if (iter != m_commonContextFields.end())
+                else
                 {
-                    record.extProtocol[0].devModel = iter->second.as_string;
+                    temp.append(deviceId);
                 }
+            }
+            m_commonFieldsTemplate.push_back({ [](::CsProtocol::Record& r) -> std::string& { return r.extDevice[0].localId; }, temp });
+        }
 
-                iter = m_commonContextFields.find(COMMONFIELDS_DEVICE_CLASS);
-                if (iter != m_commonContextFields.end())
-                {
-                    record.extDevice[0].deviceClass = iter->second.as_string;
-                }
+        for (auto const& field : m_ticketsMap)
+        {
+            m_ticketsTemplate.push_back(field.second);
+        }
 
-                iter = m_commonContextFields.find(COMMONFIELDS_COMMERCIAL_ID);
-                if (iter != m_commonContextFields.end())
-                {
-                    record.extM365a[0].enrolledTenantId = iter->second.as_string;
-                }
+        for (auto const& field : m_customContextFields)
+        {
+            if (field.second.piiKind != PiiKind_None)
+            {
+                CsProtocol::PII pii;
+                pii.Kind = static_cast<CsProtocol::PIIKind>(field.second.piiKind);
+                CsProtocol::Value temp;
+                CsProtocol::Attributes attrib;
+                attrib.pii.push_back(pii);
 
-                iter = m_commonContextFields.find(COMMONFIELDS_OS_NAME);
-                if (iter != m_commonContextFields.end())
-                {
-                    record.extOs[0].name = iter->second.as_string;
-                }
 
-                iter = m_commonContextFields.find(COMMONFIELDS_OS_BUILD);
-                if (iter != m_commonContextFields.end())
-                {
-                    //EventProperty prop = (*m_commonContextFieldsP)[COMMONFIELDS_OS_VERSION];
-                    record.extOs[0].ver = iter->second.as_string;
-                }
+                temp.attributes.push_back(attrib);
 
-                iter = m_commonContextFields.find(COMMONFIELDS_USER_ID);
-                if (iter != m_commonContextFields.end())
-                {
-                    record.extUser[0].localId = iter->second.as_string;
-                }
+                temp.stringValue = field.second.to_string();
+                m_customPropertiesTemplate.emplace_back(field.first, temp);
+            }
+            else
+            {
+                std::vector<uint8_t> guid;
+                uint8_t guid_bytes[16] = { 0 };
 
-                iter = m_commonContextFields.find(COMMONFIELDS_USER_LANGUAGE);
-                if (iter != m_commonContextFields.end())
+                switch (field.second.type)
+                {
+                case EventProperty::TYPE_STRING:
                 {
-                    record.extUser[0].locale = iter->second.as_string;
+                    CsProtocol::Value temp;
+                    temp.stringValue = field.second.to_string();
+                    m_customPropertiesTemplate.emplace_back(field.first, temp);
+                    break;
                 }
-
-                iter = m_commonContextFields.find(COMMONFIELDS_USER_TIMEZONE);
-                if (iter != m_commonContextFields.end())
+                case EventProperty::TYPE_INT64:
                 {
-                    record.extLoc[0].timezone = iter->second.as_string;
+                    CsProtocol::Value temp;
+                    temp.type = ::CsProtocol::ValueKind::ValueInt64;
+                    temp.longValue = field.second.as_int64;
+                    m_customPropertiesTemplate.emplace_back(field.first, temp);
+                    break;
                 }
-
-                iter = m_commonContextFields.find(COMMONFIELDS_NETWORK_COST);
-                if (iter != m_commonContextFields.end())
+                case EventProperty::TYPE_DOUBLE:
                 {
-                    record.extNet[0].cost = iter->second.as_string;
+                    CsProtocol::Value temp;
+                    temp.type = ::CsProtocol::ValueKind::ValueDouble;
+                    temp.doubleValue = field.second.as_double;
+                    m_customPropertiesTemplate.emplace_back(field.first, temp);
+                    break;
                 }
-
-                iter = m_commonContextFields.find(COMMONFIELDS_NETWORK_PROVIDER);
-                if (iter != m_commonContextFields.end())
+                case EventProperty::TYPE_TIME:
                 {
-                    record.extNet[0].provider = iter->second.as_string;
+                    CsProtocol::Value temp;
+                    temp.type = ::CsProtocol::ValueKind::ValueDateTime;
+                    temp.longValue = field.second.as_time_ticks.ticks;
+                    m_customPropertiesTemplate.emplace_back(field.first, temp);
+                    break;
                 }
-
-                iter = m_commonContextFields.find(COMMONFIELDS_NETWORK_TYPE);
-                if (iter != m_commonContextFields.end())
+                case EventProperty::TYPE_BOOLEAN:
                 {
-                    record.extNet[0].type = iter->second.as_string;
+                    CsProtocol::Value temp;
+                    temp.type = ::CsProtocol::ValueKind::ValueBool;
+                    temp.longValue = field.second.as_bool;
+                    m_customPropertiesTemplate.emplace_back(field.first, temp);
+                    break;
                 }
-            }
-
-            if (m_ticketsMap.size() > 0)
-            {
-                std::vector<std::string> tickets;
-                for (auto const& field : m_ticketsMap)
+                case EventProperty::TYPE_GUID:
                 {
-                    tickets.push_back(field.second);
+                    GUID_t temp = field.second.as_guid;
+                    temp.to_bytes(guid_bytes);
+                    guid = std::vector<uint8_t>(guid_bytes, guid_bytes + sizeof(guid_bytes) / sizeof(guid_bytes[0]));
+
+                    CsProtocol::Value tempValue;
+                    tempValue.type = ::CsProtocol::ValueKind::ValueGuid;
+                    tempValue.guidValue.push_back(guid);
+                    m_customPropertiesTemplate.emplace_back(field.first, tempValue);
+                    break;
                 }
-                CsProtocol::Protocol temp;
-                temp.ticketKeys.push_back(tickets);
-                record.extProtocol.push_back(temp);
-            }
-
-            if (!commonOnly)
-            {
-                for (auto const& field : m_customContextFields)
+                default:
                 {
-                    if (field.second.piiKind != PiiKind_None)
-                    {
-                        CsProtocol::PII pii;
-                        pii.Kind = static_cast<CsProtocol::PIIKind>(field.second.piiKind);
-                        CsProtocol::Value temp;
-                        CsProtocol::Attributes attrib;
-                        attrib.pii.push_back(pii);
-
-
-                        temp.attributes.push_back(attrib);
-
-                        temp.stringValue = field.second.to_string();
-                        record.data[0].properties[field.first] = temp;
-                    }
-                    else
-                    {
-                        std::vector<uint8_t> guid;
-                        uint8_t guid_bytes[16] = { 0 };
-
-                        switch (field.second.type)
-                        {
-                        case EventProperty::TYPE_STRING:
-                        {
-                            CsProtocol::Value temp;
-                            temp.stringValue = field.second.to_string();
-                            record.data[0].properties[field.first] = temp;
-                            break;
-                        }
-                        case EventProperty::TYPE_INT64:
-                        {
-                            CsProtocol::Value temp;
-                            temp.type = ::CsProtocol::ValueKind::ValueInt64;
-                            temp.longValue = field.second.as_int64;
-                            record.data[0].properties[field.first] = temp;
-                            break;
-                        }
-                        case EventProperty::TYPE_DOUBLE:
-                        {
-                            CsProtocol::Value temp;
-                            temp.type = ::CsProtocol::ValueKind::ValueDouble;
-                            temp.doubleValue = field.second.as_double;
-                            record.data[0].properties[field.first] = temp;
-                            break;
-                        }
-                        case EventProperty::TYPE_TIME:
-                        {
-                            CsProtocol::Value temp;
-                            temp.type = ::CsProtocol::ValueKind::ValueDateTime;
-                            temp.longValue = field.second.as_time_ticks.ticks;
-                            record.data[0].properties[field.first] = temp;
-                            break;
-                        }
-                        case EventProperty::TYPE_BOOLEAN:
-                        {
-                            CsProtocol::Value temp;
-                            temp.type = ::CsProtocol::ValueKind::ValueBool;
-                            temp.longValue = field.second.as_bool;
-                            record.data[0].properties[field.first] = temp;
-                            break;
-                        }
-                        case EventProperty::TYPE_GUID:
-                        {
-                            GUID_t temp = field.second.as_guid;
-                            temp.to_bytes(guid_bytes);
-                            guid = std::vector<uint8_t>(guid_bytes, guid_bytes + sizeof(guid_bytes) / sizeof(guid_bytes[0]));
-
-                            CsProtocol::Value tempValue;
-                            tempValue.type = ::CsProtocol::ValueKind::ValueGuid;
-                            tempValue.guidValue.push_back(guid);
-                            record.data[0].properties[field.first] = tempValue;
-                            break;
-                        }
-                        default:
-                        {
-                            // Convert all unknown types to string
-                            CsProtocol::Value temp;
-                            temp.stringValue = field.second.to_string();
-                            record.data[0].properties[field.first] = temp;
-                        }
-                        }
-                    }
+                    // Convert all unknown types to string
+                    CsProtocol::Value temp;
+                    temp.stringValue = field.second.to_string();
+                    m_customPropertiesTemplate.emplace_back(field.first, temp);
+                }
                 }
             }
-            LOG_TRACE("Record=%p decorated with SemanticContext=%p", &record, this);
         }
+
+        m_templateDirty = false;
     }
 
     void ContextFieldsProvider::ClearExperimentIds()
@@ -433,12 +383,14 @@ namespace MAT_NS_BEGIN
     {
         LOCKGUARD(m_lock);
         m_commonContextFields[name] = value;
+        m_templateDirty = true;
     }
 
     void ContextFieldsProvider::SetCustomField(const std::string& name, const EventProperty& value)
     {
         LOCKGUARD(m_lock);
         m_customContextFields[name] = value;
+        m_templateDirty = true;
     }
 
     void ContextFieldsProvider::SetTicket(TicketType type, const std::string& ticketValue)
@@ -447,6 +399,7 @@ namespace MAT_NS_BEGIN
         if (!ticketValue.empty())
         {
             m_ticketsMap[type] = ticketValue;
+            m_templateDirty = true;
         }
     }
 
@@ -457,11 +410,19 @@ namespace MAT_NS_BEGIN
 
     std::map<std::string, EventProperty>& ContextFieldsProvider::GetCommonFields()
     {
+        // Caller may modify the map through the returned reference at any
+        // later time, so from now on the template is rebuilt on every read.
+        LOCKGUARD(m_lock);
+        m_fieldsExposed = true;
         return m_commonContextFields;
     }
 
     std::map<std::string, EventProperty>& ContextFieldsProvider::GetCustomFields()
     {
+        // Caller may modify the map through the returned reference at any
+        // later time, so from now on the template is rebuilt on every read.
+        LOCKGUARD(m_lock);
+        m_fieldsExposed = true;
         return m_customContextFields;
     }
 
@@ -13,6 +13,8 @@
 #include <mutex>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 #include <cassert>
 
 namespace MAT_NS_BEGIN
@@ -42,6 +44,17 @@ namespace MAT_NS_BEGIN
 
     protected:
 
+        /// <summary>
+        /// Part A extension field resolved from a common context field
+        /// </summary>
+        struct CommonFieldAssignment
+        {
+            std::string& (*field)(::CsProtocol::Record& record);
+            std::string value;
+        };
+
+        void updateRecordTemplate();
+
         std::mutex              m_lock;
         ContextFieldsProvider*  m_parent;
 
@@ -52,6 +65,20 @@ namespace MAT_NS_BEGIN
         std::map<std::string, std::string>   m_commonContextEventToConfigIds;
 
         std::map<TicketType, std::string>    m_ticketsMap;
+
+        // Record decoration template derived from the maps above. It is
+        // rebuilt on the first event after a field changes, so decorating
+        // an event does not repeat the map lookups and value conversions.
+        // Once GetCommonFields/GetCustomFields handed out a mutable reference
+        // the maps can change behind our back, so the template is always
+        // rebuilt from then on.
+        bool                                                     m_templateDirty;
+        bool                                                     m_fieldsExposed;
+        std::string                                              m_experimentIds;
+        std::vector<CommonFieldAssignment>                       m_commonFieldsTemplate;
+        std::vector<std::pair<std::string, ::CsProtocol::Value>> m_commonPropertiesTemplate;
+        std::vector<std::pair<std::string, ::CsProtocol::Value>> m_customPropertiesTemplate;
+        std::vector<std::string>                                 m_ticketsTemplate;
     };
 
 
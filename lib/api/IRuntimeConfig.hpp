@@ -10,13 +10,38 @@
 #include "ILogger.hpp"
 #include "ILogConfiguration.hpp"
 
+#include <cstdint>
 #include <string>
 #include <map>
+#include <memory>
 
 namespace MAT_NS_BEGIN
 {
     ///@cond INTERNAL_DOCS
 
+    /// <summary>
+    /// Typed copy of the settings read on hot paths (for every event or every
+    /// upload), so that these paths do not look up string keys in the
+    /// configuration map. A published snapshot is never modified.
+    /// </summary>
+    struct RuntimeConfigSnapshot
+    {
+        /// Largest serialized event accepted, CFG_MAP_TPM/CFG_INT_TPM_MAX_BLOB_BYTES
+        uint32_t maxBlobBytes = 0;
+
+        /// Maximum number of concurrent upload requests, CFG_INT_MAX_PENDING_REQ
+        uint32_t maxPendingRequests = 0;
+
+        /// Window for coalescing max-latency events, CFG_INT_IMMEDIATE_UPLOAD_WINDOW_MS
+        uint32_t immediateUploadWindowMs = 0;
+
+        /// Tenant token of the stats events, see GetMetaStatsTenantToken()
+        std::string metaStatsTenantToken;
+
+        /// Interval for sending stats events, see GetMetaStatsSendIntervalSec()
+        unsigned metaStatsSendIntervalSec = 0;
+    };
+
     class IRuntimeConfig {
 
     public:
@@ -186,6 +211,28 @@ namespace MAT_NS_BEGIN
 
         virtual uint32_t GetTeardownTime() = 0;
 
+        /// <summary>
+        /// Gets the current snapshot of the settings read on hot paths.
+        /// </summary>
+        /// <remarks>
+        /// The snapshot stays valid for the lifetime of this object. Changes
+        /// to the settings it mirrors, made through operator[] or directly in
+        /// the ILogConfiguration, take effect only when UpdateSnapshot() is
+        /// called, which ILogManager::Configure() does. This is a change from
+        /// earlier releases, where these settings were read on every use.
+        /// </remarks>
+        /// <returns>The most recently published snapshot.</returns>
+        virtual RuntimeConfigSnapshot const* GetSnapshot() = 0;
+
+        /// <summary>
+        /// Publishes a new snapshot built from the current configuration.
+        /// </summary>
+        /// <remarks>
+        /// Implementations that receive settings from elsewhere, e.g. from
+        /// ECS, must call this after applying them.
+        /// </remarks>
+        virtual void UpdateSnapshot() = 0;
+
         /// <summary>
         /// Get UTC channel provider group ID
         /// </summary>
@@ -13,6 +13,7 @@
 #include "offline/OfflineStorageHandler.hpp"
 
 #include "system/TelemetrySystem.hpp"
+#include "decorators/EventPropertiesDecorator.hpp"
 
 #include "EventProperty.hpp"
 #include "TransmitProfiles.hpp"
@@ -232,6 +233,9 @@ namespace MAT_NS_BEGIN
         int32_t sdkMode = configuration[CFG_INT_SDK_MODE];
         (void)sdkMode; // variable may be unused when SDK is compiled without private modules
 
+        // Pick up the settings adjusted above
+        m_config->UpdateSnapshot();
+
 #ifdef HAVE_MAT_UTC
         // UTC is not active
         configuration[CFG_STR_UTC][CFG_BOOL_UTC_ACTIVE] = false;
@@ -316,6 +320,7 @@ namespace MAT_NS_BEGIN
             // Default mode is Common Schema - direct
             m_system.reset(new TelemetrySystem(*this, *m_config, *m_offlineStorage, *m_httpClient,
                                                *m_taskDispatcher, m_bandwidthController, *m_logSessionDataProvider));
+            m_systemSerializesProperties = true;
         }
         LOG_TRACE("Telemetry system created, starting up...");
         if (m_system && !deferSystemStart)
@@ -340,6 +345,7 @@ namespace MAT_NS_BEGIN
     /// </summary>
     void LogManagerImpl::Configure()
     {
+        m_config->UpdateSnapshot();
         // TODO: [maxgolov] - add other config params.
 #ifdef HAVE_MAT_WININET_HTTP_CLIENT
         HttpClient_WinInet* client = static_cast<HttpClient_WinInet*>(m_httpClient.get());
@@ -697,13 +703,32 @@ namespace MAT_NS_BEGIN
         return m_debugEventSource.DetachEventSource(other);
     }
 
+    /// <summary>
+    /// Adds the properties of an event that the Logger left for the serializer
+    /// to its record, for code that looks at the record before serialization.
+    /// </summary>
+    static void addEventProperties(IncomingEventContextPtr const& event)
+    {
+        if (event->properties != nullptr)
+        {
+            EventPropertiesDecorator::decorateProperties(*(event->source), *(event->properties));
+            event->properties = nullptr;
+        }
+    }
+
     void LogManagerImpl::sendEvent(IncomingEventContextPtr const& event)
     {
-        LOCKGUARD(m_lock);
+        // Callers reach this method through a live Logger (see ActiveLoggerCall), and
+        // FlushAndTeardown shuts every Logger down before it stops and releases m_system.
+        // That makes m_lock unnecessary here: decoration and serialization run in parallel
+        // on the calling threads, and only the user-supplied hooks and the storage hand-off
+        // are synchronized.
         if (GetSystem())
         {
             if (m_customDecorator)
             {
+                LOCKGUARD(m_customDecoratorGuard);
+                addEventProperties(event);
                 m_customDecorator->decorate(*(event->source));
             }
 
@@ -712,13 +737,29 @@ namespace MAT_NS_BEGIN
 
                 if (m_dataInspector)
                 {
+                    addEventProperties(event);
                     m_dataInspector->InspectRecord(*(event->source));
                 }
             }
+
+            if (!m_systemSerializesProperties)
+            {
+                addEventProperties(event);
+            }
             GetSystem()->sendEvent(event);
         }
     }
 
+    status_t LogManagerImpl::admitEvent(std::string const& tenantToken, EventLatency latency, EventPersistence persistence, bool mayBlock)
+    {
+        // Like sendEvent, only reached through a live Logger, which keeps the storage alive
+        if (m_offlineStorage)
+        {
+            return m_offlineStorage->AdmitRecord(tenantToken, latency, persistence, mayBlock);
+        }
+        return STATUS_SUCCESS;
+    }
+
     ILogController* LogManagerImpl::GetLogController()
     {
         return this;
@@ -772,8 +813,12 @@ namespace MAT_NS_BEGIN
         if (m_system == nullptr || m_isSystemStarted)
             return m_system;
 
-        m_system->start();
-        m_isSystemStarted = true;
+        LOCKGUARD(m_lock);
+        if (m_system != nullptr && !m_isSystemStarted)
+        {
+            m_system->start();
+            m_isSystemStarted = true;
+        }
         return m_system;
     }
 
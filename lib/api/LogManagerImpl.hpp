@@ -32,6 +32,8 @@
 #include "IDataInspector.hpp"
 #include "offline/LogSessionDataProvider.hpp"
 
+#include <atomic>
+#include <bitset>
 #include <mutex>
 #include <set>
 
@@ -46,8 +48,9 @@ namespace MAT_NS_BEGIN
             m_levelMin(DIAG_LEVEL_DEFAULT_MIN),
             m_levelMax(DIAG_LEVEL_DEFAULT_MAX),
             m_level(DIAG_LEVEL_DEFAULT),
-            m_levelSet({})
+            m_hasLevelSet(false)
         {
+            compile();
         }
 
         /// <summary>
@@ -64,11 +67,7 @@ namespace MAT_NS_BEGIN
         /// <param name="level">Diagnostic level.</param>
         bool IsLevelEnabled(uint8_t level) const
         {
-            if (!m_levelSet.empty())
-            {
-                return m_levelSet.find(level) != m_levelSet.end();
-            }
-            return m_levelMin <= m_levelMax && m_levelMin <= level && level <= m_levelMax;
+            return m_allowedLevels[level];
         }
 
         /// <summary>
@@ -76,7 +75,7 @@ namespace MAT_NS_BEGIN
         /// </summary>
         bool IsLevelFilterEnabled() const
         {
-            return !m_levelSet.empty() || m_levelMin != DIAG_LEVEL_DEFAULT_MIN || m_levelMax != DIAG_LEVEL_DEFAULT_MAX || m_level != DIAG_LEVEL_DEFAULT;
+            return m_filterEnabled;
         }
 
         /// <summary>
@@ -90,6 +89,7 @@ namespace MAT_NS_BEGIN
             m_level = defaultLevel;
             m_levelMin = levelMin;
             m_levelMax = levelMax;
+            compile();
         }
 
         /// <summary>
@@ -100,14 +100,43 @@ namespace MAT_NS_BEGIN
         void SetFilter(uint8_t defaultLevel, const std::set<uint8_t>& allowedLevels)
         {
             m_level = defaultLevel;
-            m_levelSet = allowedLevels;
+            m_hasLevelSet = !allowedLevels.empty();
+            if (m_hasLevelSet)
+            {
+                m_allowedLevels.reset();
+                for (uint8_t level : allowedLevels)
+                {
+                    m_allowedLevels.set(level);
+                }
+            }
+            compile();
         }
 
        private:
+        /// <summary>
+        /// Precompute the per-level lookup so that the per-event check
+        /// is a single bit test. An explicit set of levels takes precedence
+        /// over the [min..max] range.
+        /// </summary>
+        void compile()
+        {
+            if (!m_hasLevelSet)
+            {
+                m_allowedLevels.reset();
+                for (unsigned level = m_levelMin; level <= m_levelMax; level++)
+                {
+                    m_allowedLevels.set(level);
+                }
+            }
+            m_filterEnabled = m_hasLevelSet || m_levelMin != DIAG_LEVEL_DEFAULT_MIN || m_levelMax != DIAG_LEVEL_DEFAULT_MAX || m_level != DIAG_LEVEL_DEFAULT;
+        }
+
         uint8_t m_levelMin;
         uint8_t m_levelMax;
         uint8_t m_level;
-        std::set<uint8_t> m_levelSet;
+        bool m_hasLevelSet;
+        bool m_filterEnabled;
+        std::bitset<256> m_allowedLevels;
     };
 
     class ILogManagerInternal : public ILogManager
@@ -122,11 +151,13 @@ namespace MAT_NS_BEGIN
         std::shared_ptr<IDecoratorModule> m_customDecorator;
 
         virtual void sendEvent(IncomingEventContextPtr const& event) = 0;
+        virtual status_t admitEvent(std::string const& tenantToken, EventLatency latency, EventPersistence persistence, bool mayBlock) = 0;
         virtual const ContextFieldsProvider& GetContext() = 0;
         virtual const DiagLevelFilter& GetLevelFilter() = 0;
     };
 
     class Logger;
+    class OfflineStorageHandler;
 
     using LoggerMap = std::map<std::string, std::unique_ptr<Logger>>;
 
@@ -272,6 +303,12 @@ namespace MAT_NS_BEGIN
         /// <param name="event">The event.</param>
         virtual void sendEvent(IncomingEventContextPtr const& event) override;
 
+        /// <summary>
+        /// Applies the ingestion policy to an event before it is decorated and serialized.
+        /// </summary>
+        /// <returns>STATUS_SUCCESS, or STATUS_EBUSY if the event is shed</returns>
+        virtual status_t admitEvent(std::string const& tenantToken, EventLatency latency, EventPersistence persistence, bool mayBlock) override;
+
         void SetLevelFilter(uint8_t defaultLevel, uint8_t levelMin, uint8_t levelMax) override;
 
         void SetLevelFilter(uint8_t defaultLevel, const std::set<uint8_t>& allowedLevels) override;
@@ -324,10 +361,13 @@ namespace MAT_NS_BEGIN
 
         AuthTokensController m_authTokensController;
 
-        std::unique_ptr<IOfflineStorage> m_offlineStorage;
+        std::unique_ptr<OfflineStorageHandler> m_offlineStorage;
         std::unique_ptr<LogSessionDataProvider> m_logSessionDataProvider;
-        bool m_isSystemStarted{};
+        std::atomic<bool> m_isSystemStarted{};
         std::unique_ptr<ITelemetrySystem> m_system;
+        // Whether m_system serializes with BondSerializer, which can write the
+        // properties of an event that the Logger did not add to the record
+        bool m_systemSerializesProperties{};
 
         bool m_alive;
 
@@ -339,6 +379,7 @@ namespace MAT_NS_BEGIN
         DataViewerCollection m_dataViewerCollection;
         std::shared_ptr<IDataInspector> m_dataInspector;
         std::recursive_mutex m_dataInspectorGuard;
+        std::mutex m_customDecoratorGuard;
     };
 
 }
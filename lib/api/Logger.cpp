@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <array>
+#include <memory>
 
 using namespace MAT;
 
@@ -20,47 +21,36 @@ namespace MAT_NS_BEGIN
     {
        public:
         const Logger& m_logger;
+        std::atomic<size_t>& m_calls;
         bool m_active;
 
-        ActiveLoggerCall(ActiveLoggerCall const& source) : m_logger(source.m_logger)
+        ActiveLoggerCall(ActiveLoggerCall const& source) :
+            ActiveLoggerCall(source.m_logger)
         {
-            std::lock_guard<std::mutex> lock(m_logger.m_shutdown_mutex);
-            m_active = m_logger.m_active;
-            if (m_active)
-            {
-                m_logger.m_active_count += 1;
-            }
         }
 
-        /// Record current state on construction; increment active
-        /// count if we are active.
+        /// Count this call in the calling thread's shard, then record
+        /// whether shut-down has started. RecordShutdown() does the same
+        /// in reverse order (both sequentially consistent), so either it
+        /// sees this call or this call sees the shut-down.
         explicit ActiveLoggerCall(const Logger& parent) :
-            m_logger(parent)
+            m_logger(parent),
+            m_calls(parent.m_active_calls[GetThreadShardIndex(Logger::ActiveCallShardCount)].count)
         {
-            std::lock_guard<std::mutex> lock(m_logger.m_shutdown_mutex);
-            m_active = m_logger.m_active;
-            if (m_active)
+            m_calls.fetch_add(1);
+            m_active = !m_logger.m_shutdown.load();
+            if (!m_active)
             {
-                m_logger.m_active_count += 1;
+                leave();
             }
         }
 
-        /// If active, decrement active count, wake any listeners when
-        /// active count reaches zero (usually there are no listeners).
+        /// If active, decrement active count.
         ~ActiveLoggerCall()
         {
             if (m_active)
             {
-                std::lock_guard<std::mutex> lock(m_logger.m_shutdown_mutex);
-
-                if (m_logger.m_active_count > 0)
-                {
-                    m_logger.m_active_count -= 1;
-                    if (m_logger.m_active_count == 0)
-                    {
-                        const_cast<std::condition_variable*>(&m_logger.m_shutdown_condition)->notify_all();
-                    }
-                }
+                leave();
             }
         }
 
@@ -68,6 +58,70 @@ namespace MAT_NS_BEGIN
         {
             return !m_active;
         }
+
+       private:
+        /// Wake RecordShutdown() if it may be waiting for this call.
+        void leave()
+        {
+            m_calls.fetch_sub(1);
+            if (m_logger.m_shutdown.load())
+            {
+                std::lock_guard<std::mutex> lock(m_logger.m_shutdown_mutex);
+                m_logger.m_shutdown_condition.notify_all();
+            }
+        }
+    };
+
+    /// Lends the calling thread's record to one Log* call. The record is
+    /// cleared rather than destroyed when the call ends, so the next event
+    /// on the thread reuses its string and vector buffers. A call that
+    /// re-enters a logger on the same thread, e.g. from a debug listener,
+    /// gets a record of its own.
+    class PooledRecord
+    {
+       public:
+        PooledRecord() :
+            m_shared(!inUse())
+        {
+            if (m_shared)
+            {
+                inUse() = true;
+            }
+            else
+            {
+                m_own.reset(new ::CsProtocol::Record());
+            }
+        }
+
+        ~PooledRecord()
+        {
+            if (m_shared)
+            {
+                Logger::resetRecord(shared());
+                inUse() = false;
+            }
+        }
+
+        ::CsProtocol::Record& operator*() noexcept
+        {
+            return m_shared ? shared() : *m_own;
+        }
+
+       private:
+        static ::CsProtocol::Record& shared()
+        {
+            static thread_local ::CsProtocol::Record record;
+            return record;
+        }
+
+        static bool& inUse()
+        {
+            static thread_local bool busy = false;
+            return busy;
+        }
+
+        bool m_shared;
+        std::unique_ptr<::CsProtocol::Record> m_own;
     };
 
     static NullLogManager nullManager;
@@ -245,8 +299,14 @@ namespace MAT_NS_BEGIN
             return;
         }
 
+        if (!CanEventBeSubmitted(properties))
+        {
+            return;
+        }
+
         EventLatency latency = EventLatency_Normal;
-        ::CsProtocol::Record record;
+        PooledRecord pooled;
+        ::CsProtocol::Record& record = *pooled;
 
         const bool decorated =
             applyCommonDecorators(record, properties, latency) &&
@@ -283,11 +343,26 @@ namespace MAT_NS_BEGIN
     /// </summary>
     /// <param name="properties">The properties.</param>
     void Logger::LogEvent(EventProperties const& properties)
+    {
+        logEvent(properties, true);
+    }
+
+    /// <summary>
+    /// Logs the event without waiting for the "Block" ingestion policy.
+    /// </summary>
+    /// <param name="properties">The properties.</param>
+    /// <returns>Whether the event was accepted, see ILogger::TryLogEvent</returns>
+    status_t Logger::TryLogEvent(EventProperties const& properties)
+    {
+        return logEvent(properties, false);
+    }
+
+    status_t Logger::logEvent(EventProperties const& properties, bool mayBlock)
     {
         ActiveLoggerCall active(*this);
         if (active.LoggerIsDead())
         {
-            return;
+            return STATUS_EFAIL;
         }
 
         // SendAsJSON(properties, m_tenantToken);
@@ -298,7 +373,13 @@ namespace MAT_NS_BEGIN
         if (!CanEventPropertiesBeSent(properties))
         {
             DispatchEvent(DebugEventType::EVT_FILTERED);
-            return;
+            return STATUS_EPERM;
+        }
+
+        const status_t admitted = admitEvent(properties, mayBlock);
+        if (admitted != STATUS_SUCCESS)
+        {
+            return admitted;
         }
 
         EventLatency latency = EventLatency_Normal;
@@ -307,19 +388,27 @@ namespace MAT_NS_BEGIN
             latency = properties.GetLatency();
         }
 
-        ::CsProtocol::Record record;
+        PooledRecord pooled;
+        ::CsProtocol::Record& record = *pooled;
 
-        if (!applyCommonDecorators(record, properties, latency))
+        // Unless a listener gets to see the record below, the custom properties are
+        // serialized straight from EventProperties instead of being converted into
+        // the record first. LogManagerImpl::sendEvent still adds them to the record
+        // when a decorator module or data inspector needs them.
+        const bool deferProperties = !DebugEventSource::HasListeners(DebugEventType::EVT_LOG_EVENT);
+
+        if (!applyCommonDecorators(record, properties, latency, deferProperties))
         {
             LOG_ERROR("Failed to log %s event %s/%s: invalid arguments provided",
                       "custom",
                       tenantTokenToId(m_tenantToken).c_str(),
                       properties.GetName().empty() ? "<unnamed>" : properties.GetName().c_str());
-            return;
+            return STATUS_EFAIL;
         }
 
-        submit(record, properties);
+        submit(record, properties, deferProperties);
         DispatchEvent(DebugEvent(DebugEventType::EVT_LOG_EVENT, size_t(latency), size_t(0), static_cast<void*>(&record), sizeof(record)));
+        return STATUS_SUCCESS;
     }
 
     /// <summary>
@@ -353,8 +442,14 @@ namespace MAT_NS_BEGIN
             return;
         }
 
+        if (!CanEventBeSubmitted(properties))
+        {
+            return;
+        }
+
         EventLatency latency = EventLatency_Normal;
-        ::CsProtocol::Record record;
+        PooledRecord pooled;
+        ::CsProtocol::Record& record = *pooled;
 
         const bool decorated =
             applyCommonDecorators(record, properties, latency) &&
@@ -404,8 +499,14 @@ namespace MAT_NS_BEGIN
             return;
         }
 
+        if (!CanEventBeSubmitted(properties))
+        {
+            return;
+        }
+
         EventLatency latency = EventLatency_Normal;
-        ::CsProtocol::Record record;
+        PooledRecord pooled;
+        ::CsProtocol::Record& record = *pooled;
 
         const bool decorated =
             applyCommonDecorators(record, properties, latency) &&
@@ -458,8 +559,14 @@ namespace MAT_NS_BEGIN
             return;
         }
 
+        if (!CanEventBeSubmitted(properties))
+        {
+            return;
+        }
+
         EventLatency latency = EventLatency_Normal;
-        ::CsProtocol::Record record;
+        PooledRecord pooled;
+        ::CsProtocol::Record& record = *pooled;
 
         const bool decorated =
             applyCommonDecorators(record, properties, latency) &&
@@ -481,8 +588,9 @@ namespace MAT_NS_BEGIN
     /// <param name="record">The record.</param>
     /// <param name="properties">The properties.</param>
     /// <param name="latency">The latency.</param>
+    /// <param name="deferProperties">Leave the custom properties out of the record, see submit.</param>
     /// <returns></returns>
-    bool Logger::applyCommonDecorators(::CsProtocol::Record& record, EventProperties const& properties, EventLatency& latency)
+    bool Logger::applyCommonDecorators(::CsProtocol::Record& record, EventProperties const& properties, EventLatency& latency, bool deferProperties)
     {
         ActiveLoggerCall active(*this);
         if (active.LoggerIsDead())
@@ -510,10 +618,68 @@ namespace MAT_NS_BEGIN
         }
         record.iKey = m_iKey;
 
-        return m_baseDecorator.decorate(record) && m_semanticContextDecorator.decorate(record) && m_eventPropertiesDecorator.decorate(record, latency, properties);
+        if (!m_baseDecorator.decorate(record) || !m_semanticContextDecorator.decorate(record))
+        {
+            return false;
+        }
+
+        if (deferProperties)
+        {
+            return m_eventPropertiesDecorator.decorateRecord(record, latency, properties);
+        }
+        return m_eventPropertiesDecorator.decorate(record, latency, properties);
     }
 
-    void Logger::submit(::CsProtocol::Record& record, const EventProperties& props)
+    /// <summary>
+    /// Brings a record back to its default state, keeping the capacity
+    /// of its strings and extension vectors for the next event.
+    /// </summary>
+    void Logger::resetRecord(::CsProtocol::Record& record)
+    {
+        record.ver.clear();
+        record.name.clear();
+        record.time = 0;
+        record.popSample = 100;
+        record.iKey.clear();
+        record.flags = 0;
+        record.cV.clear();
+#ifdef HAVE_CS4_FULL
+        record.extIngest.clear();
+#endif
+        record.extProtocol.clear();
+        record.extUser.clear();
+        record.extDevice.clear();
+        record.extOs.clear();
+        record.extApp.clear();
+        record.extUtc.clear();
+#ifdef HAVE_CS4_FULL
+        record.extXbl.clear();
+        record.extJavascript.clear();
+        record.extReceipts.clear();
+#endif
+        record.extNet.clear();
+        record.extSdk.clear();
+        record.extLoc.clear();
+#ifdef HAVE_CS4_FULL
+        record.extCloud.clear();
+        record.extService.clear();
+        record.extCs.clear();
+#endif
+        record.extM365a.clear();
+        record.ext.clear();
+#ifdef HAVE_CS4_FULL
+        record.extMscv.clear();
+        record.extIntWeb.clear();
+        record.extIntService.clear();
+        record.extWeb.clear();
+#endif
+        record.tags.clear();
+        record.baseType.clear();
+        record.baseData.clear();
+        record.data.clear();
+    }
+
+    void Logger::submit(::CsProtocol::Record& record, const EventProperties& props, bool deferProperties)
     {
         ActiveLoggerCall active(*this);
         if (active.LoggerIsDead())
@@ -524,53 +690,22 @@ namespace MAT_NS_BEGIN
         const auto policyBitFlags = props.GetPolicyBitFlags();
         const auto persistence = props.GetPersistence();
         const auto latency = props.GetLatency();
-        auto levelFilter = m_logManager.GetLevelFilter();
-        if (levelFilter.IsLevelFilterEnabled())
-        {
-            const auto& m_props = props.GetProperties();
-            const auto it = m_props.find(COMMONFIELDS_EVENT_LEVEL);
-            //
-            // Level policy:
-            // * get level from the COMMONFIELDS_EVENT_LEVEL property if set
-            // * if not set, then get level from the ILogger instance
-            // * if not set, then get level from the LogManager instance
-            // * if still not set (no default assigned at LogManager scope),
-            // then prefer to drop. This is user error: user set the range
-            // restrition, but didn't specify the defaults.
-            //
-            uint8_t level = (it != m_props.cend()) ? static_cast<uint8_t>(it->second.as_int64) : m_level;
-            if (level == DIAG_LEVEL_DEFAULT)
-            {
-                level = levelFilter.GetDefaultLevel();
-                if (level == DIAG_LEVEL_DEFAULT)
-                {
-                    // If no default level, but restrictions are in effect, then prefer to drop event
-                    LOG_INFO("Event %s/%s dropped: no diagnostic level assigned!",
-                             tenantTokenToId(m_tenantToken).c_str(), record.baseType.c_str());
-                    DispatchEvent(DebugEventType::EVT_FILTERED);
-                    return;
-                }
-            }
-            if (!levelFilter.IsLevelEnabled(level))
-            {
-                DispatchEvent(DebugEventType::EVT_FILTERED);
-                return;
-            }
-        }
-
-        if (latency == EventLatency_Off)
-        {
-            DispatchEvent(DebugEventType::EVT_DROPPED);
-            LOG_INFO("Event %s/%s dropped: calculated latency 0 (Off)",
-                     tenantTokenToId(m_tenantToken).c_str(), record.baseType.c_str());
-            return;
-        }
 
-        // TODO: [MG] - check if optimization is possible in generateUuidString
         IncomingEventContext event(PAL::generateUuidString(), m_tenantToken, latency, persistence, &record);
         event.policyBitFlags = policyBitFlags;
+        if (deferProperties)
+        {
+            event.properties = &props;
+        }
 
         m_logManager.sendEvent(&event);
+
+        // A listener that registered after logEvent checked for one still gets
+        // to see the record, so it needs the properties the event went out with
+        if ((event.properties != nullptr) && DebugEventSource::HasListeners(DebugEventType::EVT_LOG_EVENT))
+        {
+            EventPropertiesDecorator::decorateProperties(record, props);
+        }
     }
 
     void Logger::onSubmitted()
@@ -608,8 +743,14 @@ namespace MAT_NS_BEGIN
             return;
         }
 
+        if (!CanEventBeSubmitted(properties))
+        {
+            return;
+        }
+
         EventLatency latency = EventLatency_Normal;
-        ::CsProtocol::Record record;
+        PooledRecord pooled;
+        ::CsProtocol::Record& record = *pooled;
 
         const bool decorated =
             applyCommonDecorators(record, properties, latency) &&
@@ -664,8 +805,14 @@ namespace MAT_NS_BEGIN
             return;
         }
 
+        if (!CanEventBeSubmitted(properties))
+        {
+            return;
+        }
+
         EventLatency latency = EventLatency_Normal;
-        ::CsProtocol::Record record;
+        PooledRecord pooled;
+        ::CsProtocol::Record& record = *pooled;
 
         const bool decorated =
             applyCommonDecorators(record, properties, latency) &&
@@ -702,8 +849,14 @@ namespace MAT_NS_BEGIN
             return;
         }
 
+        if (!CanEventBeSubmitted(properties))
+        {
+            return;
+        }
+
         EventLatency latency = EventLatency_Normal;
-        ::CsProtocol::Record record;
+        PooledRecord pooled;
+        ::CsProtocol::Record& record = *pooled;
 
         bool decorated =
             applyCommonDecorators(record, properties, latency) &&
@@ -740,8 +893,14 @@ namespace MAT_NS_BEGIN
             return;
         }
 
+        if (!CanEventBeSubmitted(properties))
+        {
+            return;
+        }
+
         EventLatency latency = EventLatency_Normal;
-        ::CsProtocol::Record record;
+        PooledRecord pooled;
+        ::CsProtocol::Record& record = *pooled;
 
         bool decorated =
             applyCommonDecorators(record, properties, latency) &&
@@ -843,8 +1002,14 @@ namespace MAT_NS_BEGIN
         }
         }
 
+        if (!CanEventBeSubmitted(props))
+        {
+            return;
+        }
+
         EventLatency latency = EventLatency_RealTime;
-        ::CsProtocol::Record record;
+        PooledRecord pooled;
+        ::CsProtocol::Record& record = *pooled;
 
         bool decorated = applyCommonDecorators(record, props, latency) &&
                          m_semanticApiDecorators.decorateSessionMessage(record, state, m_sessionId, PAL::formatUtcTimestampMsAsISO8601(sessionFirstTime), sessionSDKUid, sessionDuration);
@@ -935,20 +1100,88 @@ namespace MAT_NS_BEGIN
         return m_filters.CanEventPropertiesBeSent(properties) && m_logManager.GetEventFilters().CanEventPropertiesBeSent(properties);
     }
 
-    void Logger::RecordShutdown()
+    bool Logger::CanEventBeSubmitted(EventProperties const& properties)
     {
-        std::unique_lock<std::mutex> shutdownLock(m_shutdown_mutex);
-        m_active = false;
-        if (m_active_count > 0)
+        return admitEvent(properties, true) == STATUS_SUCCESS;
+    }
+
+    status_t Logger::admitEvent(EventProperties const& properties, bool mayBlock)
+    {
+        ActiveLoggerCall active(*this);
+        if (active.LoggerIsDead())
         {
-            // wait for idle before continuing
-            // as with all condition variables, we hold the lock,
-            // so no thread can decrement m_active_count until
-            // wait() releases (and later reacquires) the lock.
-            m_shutdown_condition.wait(shutdownLock, [this]() {
-                return m_active_count == 0; // we hold the lock for this call
-            });
+            return STATUS_EFAIL;
         }
+
+        // Everything here is decided from the properties alone, so events that
+        // would be dropped are rejected before the record is decorated.
+        const auto levelFilter = m_logManager.GetLevelFilter();
+        if (levelFilter.IsLevelFilterEnabled())
+        {
+            const auto& props = properties.GetProperties();
+            const auto it = props.find(COMMONFIELDS_EVENT_LEVEL);
+            //
+            // Level policy:
+            // * get level from the COMMONFIELDS_EVENT_LEVEL property if set
+            // * if not set, then get level from the ILogger instance
+            // * if not set, then get level from the LogManager instance
+            // * if still not set (no default assigned at LogManager scope),
+            // then prefer to drop. This is user error: user set the range
+            // restrition, but didn't specify the defaults.
+            //
+            uint8_t level = (it != props.cend()) ? static_cast<uint8_t>(it->second.as_int64) : m_level;
+            if (level == DIAG_LEVEL_DEFAULT)
+            {
+                level = levelFilter.GetDefaultLevel();
+                if (level == DIAG_LEVEL_DEFAULT)
+                {
+                    // If no default level, but restrictions are in effect, then prefer to drop event
+                    LOG_INFO("Event %s/%s dropped: no diagnostic level assigned!",
+                             tenantTokenToId(m_tenantToken).c_str(), properties.GetName().c_str());
+                    DispatchEvent(DebugEventType::EVT_FILTERED);
+                    return STATUS_EPERM;
+                }
+            }
+            if (!levelFilter.IsLevelEnabled(level))
+            {
+                DispatchEvent(DebugEventType::EVT_FILTERED);
+                return STATUS_EPERM;
+            }
+        }
+
+        if (properties.GetLatency() == EventLatency_Off)
+        {
+            DispatchEvent(DebugEventType::EVT_DROPPED);
+            LOG_INFO("Event %s/%s dropped: calculated latency 0 (Off)",
+                     tenantTokenToId(m_tenantToken).c_str(), properties.GetName().c_str());
+            return STATUS_EPERM;
+        }
+
+        // Last, as it may evict queued events or wait for a flush to disk.
+        // Events shed here are reported by the storage (EVT_SHED).
+        return m_logManager.admitEvent(m_tenantToken, properties.GetLatency(), properties.GetPersistence(), mayBlock);
+    }
+
+    size_t Logger::getActiveCallCount() const
+    {
+        size_t count = 0;
+        for (auto const& shard : m_active_calls)
+        {
+            count += shard.count.load();
+        }
+        return count;
+    }
+
+    void Logger::RecordShutdown()
+    {
+        m_shutdown.store(true);
+        std::unique_lock<std::mutex> shutdownLock(m_shutdown_mutex);
+        // wait for idle before continuing; calls completing from now on
+        // notify under the lock, so no wakeup is lost between the check
+        // and the wait.
+        m_shutdown_condition.wait(shutdownLock, [this]() {
+            return getActiveCallCount() == 0;
+        });
     }
 }
 MAT_NS_END
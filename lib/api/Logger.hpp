@@ -24,12 +24,15 @@
 
 #include "filter/EventFilterCollection.hpp"
 
+#include <atomic>
+
 namespace MAT_NS_BEGIN
 {
     class BaseDecorator;
     class ILogManagerInternal;
 
     class ActiveLoggerCall;
+    class PooledRecord;
 
     class Logger : public ILogger,
                    public IContextProvider,
@@ -204,6 +207,8 @@ namespace MAT_NS_BEGIN
         virtual IEventFilterCollection const&
         GetEventFilters() const noexcept override;
 
+        virtual status_t TryLogEvent(EventProperties const& properties) override;
+
         virtual std::string GetSource();
 
         virtual ILogManager& GetParent();
@@ -229,14 +234,44 @@ namespace MAT_NS_BEGIN
        protected:
         bool applyCommonDecorators(::CsProtocol::Record& record,
                                    EventProperties const& properties,
-                                   MAT::EventLatency& latency);
+                                   MAT::EventLatency& latency,
+                                   bool deferProperties = false);
 
+        /// <summary>
+        /// Hands the record over to the log manager. With deferProperties, the custom
+        /// properties were left out of the record and are serialized from props.
+        /// </summary>
         virtual void
-        submit(::CsProtocol::Record& record, const EventProperties& props);
+        submit(::CsProtocol::Record& record, const EventProperties& props, bool deferProperties = false);
+
+        /// <summary>
+        /// Clears the record for reuse by the next event on the same thread, see PooledRecord.
+        /// </summary>
+        static void
+        resetRecord(::CsProtocol::Record& record);
 
         bool
         CanEventPropertiesBeSent(EventProperties const& properties) const noexcept;
 
+        /// <summary>
+        /// Applies the diagnostic level filter, drops EventLatency_Off events and
+        /// applies the ingestion policy before any record is built.
+        /// Dispatches EVT_FILTERED / EVT_DROPPED.
+        /// </summary>
+        bool
+        CanEventBeSubmitted(EventProperties const& properties);
+
+        /// <summary>
+        /// Same checks as CanEventBeSubmitted, with the reason an event is not submitted:
+        /// STATUS_EPERM if it is filtered or dropped, STATUS_EBUSY if it is shed at the
+        /// ingestion limit. Only waits for the "Block" ingestion policy if mayBlock is set.
+        /// </summary>
+        status_t
+        admitEvent(EventProperties const& properties, bool mayBlock);
+
+        status_t
+        logEvent(EventProperties const& properties, bool mayBlock);
+
         std::mutex m_lock;
 
         std::string m_tenantToken;
@@ -266,26 +301,36 @@ namespace MAT_NS_BEGIN
         bool m_resetSessionOnEnd;
         EventFilterCollection m_filters;
 
-        /// m_shutdown_mutex protects shut-down state
+        /// Calls into this logger in progress, counted in per-thread
+        /// shards so that threads sharing one logger do not contend on
+        /// a single counter. Shards are padded to separate cache lines.
+        struct ActiveCallShard
+        {
+            std::atomic<size_t> count { 0 };
+            char padding[64 - sizeof(std::atomic<size_t>)];
+        };
+        static constexpr size_t ActiveCallShardCount = 8;
+        mutable ActiveCallShard m_active_calls[ActiveCallShardCount];
+
+        /// m_shutdown is set when we start the shut-down state transition.
+        /// No new calls will start once this is set, so the active calls
+        /// should drain to zero as calls complete.
+        std::atomic<bool> m_shutdown { false };
+
+        /// RecordShutdown() waits on m_shutdown_condition until the active
+        /// calls drain to zero. Calls completing during shutdown notify it
+        /// under m_shutdown_mutex, so the wakeup cannot be missed.
         mutable std::mutex m_shutdown_mutex;
-
-        /// RecordShutdown() uses m_shutdown_condition to wait until
-        /// m_active goes to zero.
         mutable std::condition_variable m_shutdown_condition;
-        /// m_active count records how many calls into this logger
-        /// are in progress. We can only complete the shutdown state
-        /// transition when active_count drains to zero.
-        mutable size_t m_active_count = 0;
-        /// m_active is set to false when we start the shut-down state
-        /// transition. No new calls will start once this is false, so
-        /// m_active_count should decrement to zero as calls complete.
-        mutable bool m_active = true;
+
+        size_t getActiveCallCount() const;
 
         /// ActiveLoggerCall is a stack-allocated class to handle
         /// shut-down state for individual Logger methods: increment
-        /// and decrement m_active_count as needed, record whether
+        /// and decrement m_active_calls as needed, record whether
         /// this method call is in the active or shut-down state.
         friend class ActiveLoggerCall;
+        friend class PooledRecord;
     };
 }
 MAT_NS_END
@@ -4,6 +4,7 @@
 //
 
 #include "BondSerializer.hpp"
+#include "CorrelationVector.hpp"
 #include "utils/StringUtils.hpp"
 #include "utils/Utils.hpp"
 #include "bond/All.hpp"
@@ -13,12 +14,315 @@
 
 namespace MAT_NS_BEGIN {
 
+    // Do not keep the memory of an unusually large event around per thread
+    static const size_t MaxScratchCapacity = 64 * 1024;
+
+    using bond_lite::CompactBinaryProtocolWriter;
+
+    typedef std::map<std::string, EventProperty> EventPropertyMap;
+    typedef std::map<std::string, ::CsProtocol::Value> ValueMap;
+
+    static void writeValueKind(CompactBinaryProtocolWriter& writer, ::CsProtocol::ValueKind kind)
+    {
+        writer.WriteFieldBegin(bond_lite::BT_INT32, 1, nullptr);
+        writer.WriteInt32(static_cast<int32_t>(kind));
+        writer.WriteFieldEnd();
+    }
+
+    static void writeGuid(CompactBinaryProtocolWriter& writer, GUID_t const& guid)
+    {
+        uint8_t bytes[16];
+        guid.to_bytes(bytes);
+        writer.WriteContainerBegin(sizeof(bytes), bond_lite::BT_UINT8);
+        writer.WriteBlob(bytes, sizeof(bytes));
+        writer.WriteContainerEnd();
+    }
+
+    template<typename T, typename TWriteItem>
+    static void writeArray(CompactBinaryProtocolWriter& writer, uint16_t id, uint8_t itemType, std::vector<T> const& items, TWriteItem writeItem)
+    {
+        // Array values are a list holding the one array
+        writer.WriteFieldBegin(bond_lite::BT_LIST, id, nullptr);
+        writer.WriteContainerBegin(1, bond_lite::BT_LIST);
+        writer.WriteContainerBegin(items.size(), itemType);
+        for (auto const& item : items) {
+            writeItem(item);
+        }
+        writer.WriteContainerEnd();
+        writer.WriteContainerEnd();
+        writer.WriteFieldEnd();
+    }
+
+    /// <summary>
+    /// Writes the ::CsProtocol::Value that EventPropertiesDecorator::toValue makes of
+    /// the property, byte for byte as bond_lite::Serialize would write it.
+    /// </summary>
+    static void writeEventProperty(CompactBinaryProtocolWriter& writer, EventProperty const& property)
+    {
+        writer.WriteStructBegin(nullptr, false);
+
+        if (property.piiKind != PiiKind_None) {
+            // Field 2: attributes, a single entry with either the customer content or the PII kind
+            writer.WriteFieldBegin(bond_lite::BT_LIST, 2, nullptr);
+            writer.WriteContainerBegin(1, bond_lite::BT_STRUCT);
+            writer.WriteStructBegin(nullptr, false);
+            uint16_t id = 1;
+            int32_t kind = static_cast<int32_t>(property.piiKind);
+            if (property.piiKind == PiiKind::CustomerContentKind_GenericData) {
+                id = 2;
+                kind = static_cast<int32_t>(::CsProtocol::CustomerContentKind::GenericContent);
+            }
+            writer.WriteFieldBegin(bond_lite::BT_LIST, id, nullptr);
+            writer.WriteContainerBegin(1, bond_lite::BT_STRUCT);
+            writer.WriteStructBegin(nullptr, false);
+            if (kind != 0) {
+                writer.WriteFieldBegin(bond_lite::BT_INT32, 1, nullptr);
+                writer.WriteInt32(kind);
+                writer.WriteFieldEnd();
+            }
+            writer.WriteStructEnd(false);
+            writer.WriteContainerEnd();
+            writer.WriteFieldEnd();
+            writer.WriteStructEnd(false);
+            writer.WriteContainerEnd();
+            writer.WriteFieldEnd();
+
+            std::string value = property.to_string();
+            if (!value.empty()) {
+                writer.WriteFieldBegin(bond_lite::BT_STRING, 3, nullptr);
+                writer.WriteString(value);
+                writer.WriteFieldEnd();
+            }
+            writer.WriteStructEnd(false);
+            return;
+        }
+
+        int64_t longValue = 0;
+        switch (property.type) {
+        case EventProperty::TYPE_INT64:
+            writeValueKind(writer, ::CsProtocol::ValueKind::ValueInt64);
+            longValue = property.as_int64;
+            break;
+
+        case EventProperty::TYPE_DOUBLE:
+            writeValueKind(writer, ::CsProtocol::ValueKind::ValueDouble);
+            if (property.as_double != 0.0) {
+                writer.WriteFieldBegin(bond_lite::BT_DOUBLE, 5, nullptr);
+                writer.WriteDouble(property.as_double);
+                writer.WriteFieldEnd();
+            }
+            break;
+
+        case EventProperty::TYPE_TIME:
+            writeValueKind(writer, ::CsProtocol::ValueKind::ValueDateTime);
+            longValue = static_cast<int64_t>(property.as_time_ticks.ticks);
+            break;
+
+        case EventProperty::TYPE_BOOLEAN:
+            writeValueKind(writer, ::CsProtocol::ValueKind::ValueBool);
+            longValue = property.as_bool;
+            break;
+
+        case EventProperty::TYPE_GUID:
+            writeValueKind(writer, ::CsProtocol::ValueKind::ValueGuid);
+            writer.WriteFieldBegin(bond_lite::BT_LIST, 6, nullptr);
+            writer.WriteContainerBegin(1, bond_lite::BT_LIST);
+            writeGuid(writer, property.as_guid);
+            writer.WriteContainerEnd();
+            writer.WriteFieldEnd();
+            break;
+
+        case EventProperty::TYPE_STRING_ARRAY:
+            writeValueKind(writer, ::CsProtocol::ValueKind::ValueArrayString);
+            writeArray(writer, 10, bond_lite::BT_STRING, *property.as_stringArray,
+                [&writer](std::string const& item) { writer.WriteString(item); });
+            break;
+
+        case EventProperty::TYPE_INT64_ARRAY:
+            writeValueKind(writer, ::CsProtocol::ValueKind::ValueArrayInt64);
+            writeArray(writer, 11, bond_lite::BT_INT64, *property.as_longArray,
+                [&writer](int64_t item) { writer.WriteInt64(item); });
+            break;
+
+        case EventProperty::TYPE_DOUBLE_ARRAY:
+            writeValueKind(writer, ::CsProtocol::ValueKind::ValueArrayDouble);
+            writeArray(writer, 12, bond_lite::BT_DOUBLE, *property.as_doubleArray,
+                [&writer](double item) { writer.WriteDouble(item); });
+            break;
+
+        case EventProperty::TYPE_GUID_ARRAY:
+            writeValueKind(writer, ::CsProtocol::ValueKind::ValueArrayGuid);
+            writeArray(writer, 13, bond_lite::BT_LIST, *property.as_guidArray,
+                [&writer](GUID_t const& item) { writeGuid(writer, item); });
+            break;
+
+        case EventProperty::TYPE_STRING:
+        default:
+        {
+            std::string value = property.to_string();
+            if (!value.empty()) {
+                writer.WriteFieldBegin(bond_lite::BT_STRING, 3, nullptr);
+                writer.WriteString(value);
+                writer.WriteFieldEnd();
+            }
+            break;
+        }
+        }
+
+        if (longValue != 0) {
+            writer.WriteFieldBegin(bond_lite::BT_INT64, 4, nullptr);
+            writer.WriteInt64(longValue);
+            writer.WriteFieldEnd();
+        }
+
+        writer.WriteStructEnd(false);
+    }
+
+    static bool isPartB(EventProperty const& property)
+    {
+        return property.dataCategory == DataCategory_PartB;
+    }
+
+    static bool isPartC(EventPropertyMap::value_type const& item)
+    {
+        // The correlation vector was moved to record.cV by EventPropertiesDecorator::decorateRecord
+        return !isPartB(item.second) && item.first != CorrelationVector::PropertyName;
+    }
+
+    /// <summary>
+    /// Walks the context properties of the record and the Part C properties of the
+    /// event in key order, the event winning on equal keys, like the std::map that
+    /// EventPropertiesDecorator::decorateProperties merges them into.
+    /// </summary>
+    template<typename TContext, typename TEvent>
+    static void mergePartC(ValueMap const& context, EventPropertyMap const& event, TContext onContext, TEvent onEvent)
+    {
+        auto contextIt = context.begin();
+        auto eventIt = event.begin();
+        while (contextIt != context.end() || eventIt != event.end()) {
+            if (eventIt != event.end() && !isPartC(*eventIt)) {
+                ++eventIt;
+            } else if (eventIt == event.end() || (contextIt != context.end() && contextIt->first < eventIt->first)) {
+                onContext(*contextIt);
+                ++contextIt;
+            } else {
+                if (contextIt != context.end() && contextIt->first == eventIt->first) {
+                    ++contextIt;
+                }
+                onEvent(*eventIt);
+                ++eventIt;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Writes the record along with the custom properties of the event, with the same
+    /// output as adding them to the record (EventPropertiesDecorator::decorateProperties)
+    /// and serializing it, without building the intermediate ::CsProtocol::Value maps.
+    /// </summary>
+    static void serializeWithProperties(std::vector<uint8_t>& output, ::CsProtocol::Record& source, EventProperties const& properties)
+    {
+        CompactBinaryProtocolWriter writer(output);
+        EventPropertyMap const& eventProperties = properties.GetProperties();
+
+        // baseData (61) and data (70) are the last two fields of Record. Write the
+        // rest without them, then drop the closing BT_STOP and write them here.
+        std::vector< ::CsProtocol::Data> baseData;
+        std::vector< ::CsProtocol::Data> data;
+        baseData.swap(source.baseData);
+        data.swap(source.data);
+        bond_lite::Serialize(writer, source);
+
+        assert(!output.empty() && output.back() == bond_lite::BT_STOP);
+        output.pop_back();
+
+        size_t partBCount = 0;
+        for (auto const& item : eventProperties) {
+            partBCount += isPartB(item.second) ? 1 : 0;
+        }
+
+        if (!baseData.empty() || partBCount != 0) {
+            writer.WriteFieldBegin(bond_lite::BT_LIST, 61, nullptr);
+            writer.WriteContainerBegin(baseData.size() + (partBCount != 0 ? 1 : 0), bond_lite::BT_STRUCT);
+            for (auto const& item : baseData) {
+                bond_lite::Serialize(writer, item, false);
+            }
+            if (partBCount != 0) {
+                writer.WriteStructBegin(nullptr, false);
+                writer.WriteFieldBegin(bond_lite::BT_MAP, 1, nullptr);
+                writer.WriteMapContainerBegin(partBCount, bond_lite::BT_STRING, bond_lite::BT_STRUCT);
+                for (auto const& item : eventProperties) {
+                    if (isPartB(item.second)) {
+                        writer.WriteString(item.first);
+                        writeEventProperty(writer, item.second);
+                    }
+                }
+                writer.WriteContainerEnd();
+                writer.WriteFieldEnd();
+                writer.WriteStructEnd(false);
+            }
+            writer.WriteContainerEnd();
+            writer.WriteFieldEnd();
+        }
+
+        // EventPropertiesDecorator::decorateRecord always adds data[0]
+        assert(!data.empty());
+        ValueMap const& context = data[0].properties;
+        size_t partCCount = 0;
+        mergePartC(context, eventProperties,
+            [&partCCount](ValueMap::value_type const&) { partCCount++; },
+            [&partCCount](EventPropertyMap::value_type const&) { partCCount++; });
+
+        writer.WriteFieldBegin(bond_lite::BT_LIST, 70, nullptr);
+        writer.WriteContainerBegin(data.size(), bond_lite::BT_STRUCT);
+        writer.WriteStructBegin(nullptr, false);
+        if (partCCount != 0) {
+            writer.WriteFieldBegin(bond_lite::BT_MAP, 1, nullptr);
+            writer.WriteMapContainerBegin(partCCount, bond_lite::BT_STRING, bond_lite::BT_STRUCT);
+            mergePartC(context, eventProperties,
+                [&writer](ValueMap::value_type const& item) {
+                    writer.WriteString(item.first);
+                    bond_lite::Serialize(writer, item.second, false);
+                },
+                [&writer](EventPropertyMap::value_type const& item) {
+                    writer.WriteString(item.first);
+                    writeEventProperty(writer, item.second);
+                });
+            writer.WriteContainerEnd();
+            writer.WriteFieldEnd();
+        }
+        writer.WriteStructEnd(false);
+        for (size_t i = 1; i < data.size(); i++) {
+            bond_lite::Serialize(writer, data[i], false);
+        }
+        writer.WriteContainerEnd();
+        writer.WriteFieldEnd();
+
+        writer.WriteStructEnd(false);
+
+        baseData.swap(source.baseData);
+        data.swap(source.data);
+    }
+
     bool BondSerializer::handleSerialize(IncomingEventContextPtr const& ctx)
     {
         OACR_USE_PTR(this);
         {
-            bond_lite::CompactBinaryProtocolWriter writer(ctx->record.blob);
-            bond_lite::Serialize(writer, *ctx->source);
+            // Serialize into a per-thread scratch buffer that keeps its capacity
+            // between events, so the writer does not regrow the output vector
+            // byte by byte. The blob itself is then allocated once at its final size.
+            static thread_local std::vector<uint8_t> scratch;
+            scratch.clear();
+            if (ctx->properties != nullptr) {
+                serializeWithProperties(scratch, *ctx->source, *ctx->properties);
+            } else {
+                bond_lite::CompactBinaryProtocolWriter writer(scratch);
+                bond_lite::Serialize(writer, *ctx->source);
+            }
+            ctx->record.blob.assign(scratch.begin(), scratch.end());
+            if (scratch.capacity() > MaxScratchCapacity) {
+                std::vector<uint8_t>().swap(scratch);
+            }
         }
 
         LOG_TRACE("Event %s/%s submitted, priority %u (%s), serialized size %u bytes, ID %s",
@@ -30,4 +334,3 @@ namespace MAT_NS_BEGIN {
     }
 
 } MAT_NS_END
-
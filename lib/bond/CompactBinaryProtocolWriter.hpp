@@ -31,11 +31,21 @@ class CompactBinaryProtocolWriter {
     template<typename T>
     void writeVarint(T value)
     {
-        while (value > 127) {
-            m_output.push_back((value & 127) | 128);
-            value >>= 7;
+        // Most varints (field values, lengths, counts) fit in one byte
+        if (value < 128) {
+            m_output.push_back(static_cast<uint8_t>(value));
+            return;
         }
-        m_output.push_back(value & 127);
+
+        // Encode into a local buffer and append it with a single insert
+        uint8_t buffer[(sizeof(T) * 8 + 6) / 7];
+        size_t size = 0;
+        do {
+            buffer[size++] = static_cast<uint8_t>((value & 127) | 128);
+            value >>= 7;
+        } while (value > 127);
+        buffer[size++] = static_cast<uint8_t>(value);
+        m_output.insert(m_output.end(), buffer, buffer + size);
     }
 
   public:
@@ -151,12 +161,11 @@ class CompactBinaryProtocolWriter {
         if (id <= 5) {
             m_output.push_back(type | ((uint8_t)id << 5));
         } else if (id <= 0xff) {
-            m_output.push_back(type | (6 << 5));
-            m_output.push_back(id & 255);
+            uint8_t const header[] = {static_cast<uint8_t>(type | (6 << 5)), static_cast<uint8_t>(id)};
+            m_output.insert(m_output.end(), header, header + sizeof(header));
         } else {
-            m_output.push_back(type | (7 << 5));
-            m_output.push_back(id & 255);
-            m_output.push_back(id >> 8);
+            uint8_t const header[] = {static_cast<uint8_t>(type | (7 << 5)), static_cast<uint8_t>(id & 255), static_cast<uint8_t>(id >> 8)};
+            m_output.insert(m_output.end(), header, header + sizeof(header));
         }
     }
 
@@ -1524,9 +1524,7 @@ void Serialize(TWriter& writer, ::CsProtocol::Value const& value, bool isBase)
         writer.WriteContainerBegin(value.guidValue.size(), BT_LIST);
         for (auto const& item2 : value.guidValue) {
             writer.WriteContainerBegin(item2.size(), BT_UINT8);
-            for (auto const& item3 : item2) {
-                writer.WriteUInt8(item3);
-            }
+            writer.WriteBlob(item2.data(), item2.size());
             writer.WriteContainerEnd();
         }
         writer.WriteContainerEnd();
@@ -1590,9 +1588,7 @@ void Serialize(TWriter& writer, ::CsProtocol::Value const& value, bool isBase)
             writer.WriteContainerBegin(item2.size(), BT_LIST);
             for (auto const& item3 : item2) {
                 writer.WriteContainerBegin(item3.size(), BT_UINT8);
-                for (auto const& item4 : item3) {
-                    writer.WriteUInt8(item4);
-                }
+                writer.WriteBlob(item3.data(), item3.size());
                 writer.WriteContainerEnd();
             }
             writer.WriteContainerEnd();
@@ -11,12 +11,58 @@
 
 namespace MAT_NS_BEGIN {
 
+    namespace {
+
+        /// <summary>
+        /// Number of listeners registered on any DebugEventSource, per event
+        /// category (the high byte of DebugEventType).
+        /// </summary>
+        std::atomic<unsigned> listenerCounts[32];
+
+        /// <summary>
+        /// One bit per category with a non-zero listener count. Checked before
+        /// anything else so that dispatching an event nobody listens to costs a
+        /// single atomic load, whichever source it goes through or cascades to.
+        /// </summary>
+        std::atomic<uint32_t> listenerMask(0);
+
+        unsigned listenerCategory(unsigned type)
+        {
+            return (type >> 24) & 31;
+        }
+
+        /// <summary>Must be called under the state lock.</summary>
+        void updateListenerCount(unsigned type, size_t added, size_t removed)
+        {
+            unsigned category = listenerCategory(type);
+            listenerCounts[category] += static_cast<unsigned>(added);
+            listenerCounts[category] -= static_cast<unsigned>(removed);
+
+            uint32_t bit = uint32_t { 1 } << category;
+            if (listenerCounts[category] != 0)
+                listenerMask.fetch_or(bit);
+            else
+                listenerMask.fetch_and(~bit);
+        }
+    }
+
+    DebugEventSource::~DebugEventSource()
+    {
+        // Static sources may outlive the state lock, so don't take it here. The
+        // mask bits of the released categories are refreshed by the next change.
+        for (auto const& registered : listeners)
+        {
+            listenerCounts[listenerCategory(registered.first)] -= static_cast<unsigned>(registered.second.size());
+        }
+    }
+
     /// <summary>Add event listener for specific debug event type.</summary>
     void DebugEventSource::AddEventListener(DebugEventType type, DebugEventListener &listener)
     {
         DE_LOCKGUARD(stateLock());
         auto &v = listeners[type];
         v.push_back(&listener);
+        updateListenerCount(type, 1, 0);
     }
 
     /// <summary>Remove previously added debug event listener for specific type.</summary>
@@ -29,23 +75,36 @@ namespace MAT_NS_BEGIN {
 
         auto &registeredListeners = (*registeredTypes).second;
         auto it = std::remove(registeredListeners.begin(), registeredListeners.end(), &listener);
+        updateListenerCount(type, 0, static_cast<size_t>(registeredListeners.end() - it));
         registeredListeners.erase(it, registeredListeners.end());
     }
 
+    /// <summary>Whether any source may have a listener for the event type.</summary>
+    bool DebugEventSource::HasListeners(DebugEventType type)
+    {
+        return (listenerMask.load(std::memory_order_relaxed) & (uint32_t { 1 } << listenerCategory(type))) != 0;
+    }
+
     /// <summary>Microsoft Telemetry SDK invokes this method to dispatch event to client callback</summary>
     bool DebugEventSource::DispatchEvent(DebugEvent evt)
     {
-        seq++;
-        evt.seq = seq;
-        evt.ts = PAL::getUtcSystemTime();
-        bool dispatched = false;
+        if (!HasListeners(evt.type))
+        {
+            // No source has a listener for this kind of event
+            return false;
+        }
 
+        bool dispatched = false;
         {
             DE_LOCKGUARD(stateLock());
-            if (listeners.size()) {
-                // Events filter handlers list
-                auto &v = listeners[evt.type];
-                for (auto listener : v) {
+            seq++;
+            evt.seq = seq;
+            evt.ts = PAL::getUtcSystemTime();
+
+            // Events filter handlers list
+            auto registered = listeners.find(evt.type);
+            if (registered != listeners.end()) {
+                for (auto listener : registered->second) {
                     listener->OnDebugEvent(evt);
                     dispatched = true;
                 }
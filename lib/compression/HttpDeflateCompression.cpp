@@ -14,7 +14,11 @@
 namespace MAT_NS_BEGIN {
 
     HttpDeflateCompression::HttpDeflateCompression(IRuntimeConfig& runtimeConfig)
-        : m_config(runtimeConfig)
+        : m_config(runtimeConfig),
+          m_windowBits(0),
+          m_stream(nullptr),
+          m_level(0),
+          m_strategy(0)
     {
         // Plain "deflate": negative -MAX_WBITS argument which makes zlib use "raw deflate"
         // without zlib header, as required by IIS.
@@ -26,6 +30,43 @@ namespace MAT_NS_BEGIN {
 
     HttpDeflateCompression::~HttpDeflateCompression()
     {
+#ifdef HAVE_MAT_ZLIB
+        if (m_stream != nullptr) {
+            deflateEnd(m_stream);
+            delete m_stream;
+        }
+#endif
+    }
+
+    bool HttpDeflateCompression::prepareStream(int level, int strategy)
+    {
+#ifdef HAVE_MAT_ZLIB
+        if (m_stream != nullptr) {
+            if (level == m_level && strategy == m_strategy) {
+                return deflateReset(m_stream) == Z_OK;
+            }
+            // Tuning changed at runtime, start over with the new parameters
+            deflateEnd(m_stream);
+        } else {
+            m_stream = new z_stream();
+        }
+
+        memset(m_stream, 0, sizeof(*m_stream));
+        int result = deflateInit2(m_stream, level, Z_DEFLATED, m_windowBits, 8 /*DEF_MEM_LEVEL*/, strategy);
+        if (result != Z_OK) {
+            LOG_WARN("HTTP request compressing failed, error=%u/%u (%s)", 1, result, m_stream->msg);
+            delete m_stream;
+            m_stream = nullptr;
+            return false;
+        }
+        m_level = level;
+        m_strategy = strategy;
+        return true;
+#else
+        UNREFERENCED_PARAMETER(level);
+        UNREFERENCED_PARAMETER(strategy);
+        return false;
+#endif
     }
 
     bool HttpDeflateCompression::handleCompress(EventsUploadContextPtr const& ctx)
@@ -36,56 +77,34 @@ namespace MAT_NS_BEGIN {
             return true;
         }
 
-        // Using a slightly adapted in-place compression technique as suggested
-        // by Mark Adler himself: http://stackoverflow.com/a/12412863/3543211
+        int level = m_config[CFG_MAP_HTTP][CFG_INT_HTTP_COMPRESSION_LEVEL];
+        int strategy = m_config[CFG_MAP_HTTP][CFG_INT_HTTP_COMPRESSION_STRATEGY];
 
-        z_stream stream;
-        memset(&stream, 0, sizeof(stream));
-
-        int result = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, m_windowBits, 8 /*DEF_MEM_LEVEL*/, Z_DEFAULT_STRATEGY);
-        if (result != Z_OK) {
-            LOG_WARN("HTTP request compressing failed, error=%u/%u (%s)", 1, result, stream.msg);
+        LOCKGUARD(m_lock);
+        if (!prepareStream(level, strategy)) {
             compressionFailed(ctx);
             return false;
         }
 
-        stream.avail_in = static_cast<uInt>(ctx->body.size());
-        ctx->body.resize(deflateBound(&stream, stream.avail_in));
-        stream.next_in = ctx->body.data();
-
-        std::vector<uint8_t> temp(32);
-        stream.next_out = temp.data();
-        stream.avail_out = static_cast<uInt>(temp.size());
-
-        result = deflate(&stream, Z_FINISH);
-        if (result == Z_OK || result == Z_STREAM_END) {
-            std::copy(temp.cbegin(), temp.cbegin() + stream.total_out, ctx->body.begin());
-            stream.next_out = ctx->body.data() + stream.total_out;
-            stream.avail_out = static_cast<uInt>(ctx->body.size()) - static_cast<uInt>(stream.total_out);
-        }
-        if (result == Z_OK) {
-            result = deflate(&stream, Z_FINISH);
-            if (result == Z_OK) {
-                // The output shall never catch up with the input. Mark says in the
-                // Stack Overflow reference above that this should happen only for
-                // incompressible data longer than 20 MB, i.e. virtually never for
-                // telemetry events in Bond. But better make it 100% safe here.
-                temp.assign(ctx->body.cbegin() + stream.total_in, ctx->body.cbegin() + stream.total_in + stream.avail_in);
-                stream.next_in = temp.data();
-                stream.avail_in = static_cast<uInt>(temp.size());
-                result = deflate(&stream, Z_FINISH);
-            }
-        }
-
-        deflateEnd(&stream);
+        // deflateBound() is large enough for a single Z_FINISH call to
+        // complete, so compress straight into the pooled buffer.
+        m_stream->next_in = ctx->body.data();
+        m_stream->avail_in = static_cast<uInt>(ctx->body.size());
+        m_buffer.resize(deflateBound(m_stream, m_stream->avail_in));
+        m_stream->next_out = m_buffer.data();
+        m_stream->avail_out = static_cast<uInt>(m_buffer.size());
 
+        int result = deflate(m_stream, Z_FINISH);
         if (result != Z_STREAM_END) {
-            LOG_WARN("HTTP request compressing failed, error=%u/%u (%s)", 2, result, stream.msg);
+            LOG_WARN("HTTP request compressing failed, error=%u/%u (%s)", 2, result, m_stream->msg);
             compressionFailed(ctx);
             return false;
         }
 
-        ctx->body.resize(stream.total_out);
+        m_buffer.resize(m_stream->total_out);
+        ctx->body.swap(m_buffer);
+        // Keep the old body's allocation as the next output buffer
+        m_buffer.clear();
         ctx->compressed = true;
 #endif
         return true;
@@ -93,4 +112,3 @@ namespace MAT_NS_BEGIN {
 
 
 } MAT_NS_END
-
@@ -9,6 +9,11 @@
 #include "system/Route.hpp"
 #include "system/Contexts.hpp"
 
+#include <mutex>
+#include <vector>
+
+struct z_stream_s;
+
 namespace MAT_NS_BEGIN {
 
 
@@ -19,11 +24,21 @@ namespace MAT_NS_BEGIN {
 
     protected:
         bool handleCompress(EventsUploadContextPtr const& ctx);
+        bool prepareStream(int level, int strategy);
 
     protected:
         IRuntimeConfig& m_config;
         int m_windowBits;
 
+        // Deflate state is allocated once and reset between packages, the
+        // compressed output goes to a pooled buffer which is then swapped
+        // with the package body, so steady-state uploads do not allocate.
+        std::mutex                  m_lock;
+        z_stream_s*                 m_stream;
+        int                         m_level;
+        int                         m_strategy;
+        std::vector<uint8_t>        m_buffer;
+
     public:
         RouteSource<EventsUploadContextPtr const&>                              compressionFailed;
         RoutePassThrough<HttpDeflateCompression, EventsUploadContextPtr const&> compress{ this, &HttpDeflateCompression::handleCompress };
@@ -7,6 +7,11 @@
 #pragma once
 #include "api/IRuntimeConfig.hpp"
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 namespace MAT_NS_BEGIN
 {
     static ILogConfiguration defaultRuntimeConfig{
@@ -14,11 +19,17 @@ namespace MAT_NS_BEGIN
         {CFG_INT_SDK_MODE, SdkModeTypes::SdkModeTypes_CS},
         {CFG_BOOL_ENABLE_ANALYTICS, false},
         {CFG_INT_CACHE_FILE_SIZE, 3145728},
+        {CFG_INT_CACHE_SEGMENT_SIZE, 262144},
         {CFG_INT_RAM_QUEUE_SIZE, 524288},
+        {CFG_INT_INGESTION_LIMIT, 0},
+        {CFG_STR_INGESTION_POLICY, "DropNewest"},
+        {CFG_INT_INGESTION_BLOCK_TIME, 50},
         {CFG_BOOL_ENABLE_MULTITENANT, true},
         {CFG_BOOL_ENABLE_DB_DROP_IF_FULL, false},
+        {CFG_BOOL_ENABLE_DB_COMPRESS, false},
         {CFG_INT_MAX_TEARDOWN_TIME, 1},
         {CFG_INT_MAX_PENDING_REQ, 4},
+        {CFG_INT_IMMEDIATE_UPLOAD_WINDOW_MS, 0},
         {CFG_INT_RAM_QUEUE_BUFFERS, 3},
         {CFG_INT_TRACE_LEVEL_MASK, 0},
         {CFG_BOOL_ENABLE_TRACE, true},
@@ -54,6 +65,8 @@ namespace MAT_NS_BEGIN
 #endif
              ,
              {"contentEncoding", "deflate"},
+             {CFG_INT_HTTP_COMPRESSION_LEVEL, -1},
+             {CFG_INT_HTTP_COMPRESSION_STRATEGY, 0},
              /* Optional parameter to require Microsoft Root CA */
              {CFG_BOOL_HTTP_MS_ROOT_CHECK, false}}},
         {CFG_MAP_TPM,
@@ -80,11 +93,19 @@ namespace MAT_NS_BEGIN
        protected:
         ILogConfiguration& config;
 
+        /// Current snapshot. Replaced snapshots are retired to m_snapshots and
+        /// freed with this object, so readers never hold a dangling pointer.
+        /// They are published only on Configure(), so the list stays short.
+        std::atomic<RuntimeConfigSnapshot const*> m_snapshot { nullptr };
+        std::mutex m_snapshotsLock;
+        std::vector<std::unique_ptr<RuntimeConfigSnapshot const>> m_snapshots;
+
        public:
         RuntimeConfig_Default(ILogConfiguration& customConfig) :
             config(customConfig)
         {
             Variant::merge_map(*customConfig, *defaultRuntimeConfig);
+            UpdateSnapshot();
         };
 
         virtual ~RuntimeConfig_Default()
@@ -179,6 +200,25 @@ namespace MAT_NS_BEGIN
             return config[CFG_INT_MAX_TEARDOWN_TIME];
         }
 
+        virtual RuntimeConfigSnapshot const* GetSnapshot() override
+        {
+            return m_snapshot.load(std::memory_order_acquire);
+        }
+
+        virtual void UpdateSnapshot() override
+        {
+            std::unique_ptr<RuntimeConfigSnapshot> snapshot(new RuntimeConfigSnapshot());
+            snapshot->maxBlobBytes = config[CFG_MAP_TPM][CFG_INT_TPM_MAX_BLOB_BYTES];
+            snapshot->maxPendingRequests = config[CFG_INT_MAX_PENDING_REQ];
+            snapshot->immediateUploadWindowMs = config[CFG_INT_IMMEDIATE_UPLOAD_WINDOW_MS];
+            snapshot->metaStatsTenantToken = GetMetaStatsTenantToken();
+            snapshot->metaStatsSendIntervalSec = GetMetaStatsSendIntervalSec();
+
+            std::lock_guard<std::mutex> lock(m_snapshotsLock);
+            m_snapshot.store(snapshot.get(), std::memory_order_release);
+            m_snapshots.emplace_back(std::move(snapshot));
+        }
+
         virtual const char* GetProviderGroupId() override
         {
             return config[CFG_STR_UTC][CFG_STR_PROVIDER_GROUP_ID];
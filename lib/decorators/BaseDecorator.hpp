@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <string>
+#include <utility>
 
 #include "IDecorator.hpp"
 
@@ -52,7 +53,7 @@ namespace MAT_NS_BEGIN
                 CsProtocol::Value temp;
                 temp.type = CsProtocol::ValueKind::ValueString;
                 temp.stringValue = value;
-                dest[key] = temp;
+                dest[key] = std::move(temp);
             }
         }
 
@@ -63,7 +64,7 @@ namespace MAT_NS_BEGIN
                 CsProtocol::Value temp;
                 temp.type = CsProtocol::ValueKind::ValueString;
                 temp.stringValue = value;
-                dest[key] = temp;
+                dest[key] = std::move(temp);
             }
             else
             {
@@ -83,7 +84,7 @@ namespace MAT_NS_BEGIN
             {
                 temp.longValue = 0;
             }
-            dest[key] = temp;
+            dest[key] = std::move(temp);
         }
 
         void setDateTimeValue(std::map<std::string, CsProtocol::Value>& dest, std::string const& key, int64_t const& value)
@@ -91,7 +92,7 @@ namespace MAT_NS_BEGIN
             CsProtocol::Value temp;
             temp.type = CsProtocol::ValueKind::ValueDateTime;
             temp.longValue = value;
-            dest[key] = temp;
+            dest[key] = std::move(temp);
         }
 
         void setInt64Value(std::map<std::string, CsProtocol::Value>& dest, std::string const& key, int64_t const& value)
@@ -99,7 +100,7 @@ namespace MAT_NS_BEGIN
             CsProtocol::Value temp;
             temp.type = CsProtocol::ValueKind::ValueInt64;
             temp.longValue = value;
-            dest[key] = temp;
+            dest[key] = std::move(temp);
         }
 
         void setDoubleValue(std::map<std::string, CsProtocol::Value>& dest, std::string const& key, double const& value)
@@ -107,7 +108,7 @@ namespace MAT_NS_BEGIN
             CsProtocol::Value temp;
             temp.type = CsProtocol::ValueKind::ValueDouble;
             temp.doubleValue = value;
-            dest[key] = temp;
+            dest[key] = std::move(temp);
         }
 
         struct EnumValueName {
@@ -13,6 +13,7 @@
 #include <algorithm>
 #include <map>
 #include <string>
+#include <utility>
 
 namespace MAT_NS_BEGIN {
 
@@ -87,7 +88,98 @@ namespace MAT_NS_BEGIN {
             record.cV = "";
         }
 
-        bool decorate(::CsProtocol::Record& record, EventLatency& latency, EventProperties const& eventProperties)
+        /// <summary>
+        /// Converts an event property to its Common Schema value. BondSerializer
+        /// writes the same bytes straight from the property (see writeEventProperty
+        /// in BondSerializer.cpp), so both must be changed together.
+        /// </summary>
+        static ::CsProtocol::Value toValue(EventProperty const& v)
+        {
+            CsProtocol::Value temp;
+            if (v.piiKind != PiiKind_None)
+            {
+                CsProtocol::Attributes attrib;
+                if (v.piiKind == PiiKind::CustomerContentKind_GenericData)
+                {  //LOG_TRACE("PIIExtensions: %s=%s (PiiKind=%u)", k.c_str(), v.to_string().c_str(), v.piiKind);
+                    CsProtocol::CustomerContent cc;
+                    cc.Kind = CsProtocol::CustomerContentKind::GenericContent;
+                    attrib.customerContent.push_back(cc);
+                }
+                else
+                { //LOG_TRACE("PIIExtensions: %s=%s (PiiKind=%u)", k.c_str(), v.to_string().c_str(), v.piiKind);
+                    CsProtocol::PII pii;
+                    pii.Kind = static_cast<CsProtocol::PIIKind>(v.piiKind);
+                    attrib.pii.push_back(pii);
+                }
+                temp.attributes.push_back(std::move(attrib));
+                temp.stringValue = v.to_string();
+                return temp;
+            }
+
+            uint8_t guid_bytes[16] = { 0 };
+            switch (v.type)
+            {
+            case EventProperty::TYPE_INT64:
+                temp.type = ::CsProtocol::ValueKind::ValueInt64;
+                temp.longValue = v.as_int64;
+                break;
+            case EventProperty::TYPE_DOUBLE:
+                temp.type = ::CsProtocol::ValueKind::ValueDouble;
+                temp.doubleValue = v.as_double;
+                break;
+            case EventProperty::TYPE_TIME:
+                temp.type = ::CsProtocol::ValueKind::ValueDateTime;
+                temp.longValue = v.as_time_ticks.ticks;
+                break;
+            case EventProperty::TYPE_BOOLEAN:
+                temp.type = ::CsProtocol::ValueKind::ValueBool;
+                temp.longValue = v.as_bool;
+                break;
+            case EventProperty::TYPE_GUID:
+                v.as_guid.to_bytes(guid_bytes);
+                temp.type = ::CsProtocol::ValueKind::ValueGuid;
+                temp.guidValue.emplace_back(guid_bytes, guid_bytes + sizeof(guid_bytes));
+                break;
+            case EventProperty::TYPE_INT64_ARRAY:
+                temp.type = ::CsProtocol::ValueKind::ValueArrayInt64;
+                temp.longArray.push_back(*v.as_longArray);
+                break;
+            case EventProperty::TYPE_DOUBLE_ARRAY:
+                temp.type = ::CsProtocol::ValueKind::ValueArrayDouble;
+                temp.doubleArray.push_back(*v.as_doubleArray);
+                break;
+            case EventProperty::TYPE_STRING_ARRAY:
+                temp.type = ::CsProtocol::ValueKind::ValueArrayString;
+                temp.stringArray.push_back(*v.as_stringArray);
+                break;
+            case EventProperty::TYPE_GUID_ARRAY:
+            {
+                temp.type = ::CsProtocol::ValueKind::ValueArrayGuid;
+                std::vector<std::vector<uint8_t>> values;
+                for (const auto& tempValue : *v.as_guidArray)
+                {
+                    tempValue.to_bytes(guid_bytes);
+                    values.emplace_back(guid_bytes, guid_bytes + sizeof(guid_bytes));
+                }
+                temp.guidArray.push_back(std::move(values));
+                break;
+            }
+            case EventProperty::TYPE_STRING:
+            default:
+                // Convert all unknown types to string
+                temp.stringValue = v.to_string();
+                break;
+            }
+            return temp;
+        }
+
+        /// <summary>
+        /// Validates the event and fills in everything but its custom properties:
+        /// flags, popSample and the correlation vector. Either decorateProperties
+        /// is called afterwards, or the properties are serialized from
+        /// eventProperties directly (see IncomingEventContext::properties).
+        /// </summary>
+        bool decorateRecord(::CsProtocol::Record& record, EventLatency& latency, EventProperties const& eventProperties)
         {
             if (latency == EventLatency_Unspecified)
                 latency = EventLatency_Normal;
@@ -110,8 +202,7 @@ namespace MAT_NS_BEGIN {
 
             if (record.data.size() == 0)
             {
-                ::CsProtocol::Data data;
-                record.data.push_back(data);
+                record.data.emplace_back();
             }
 
             record.popSample = eventProperties.GetPopSample();
@@ -151,9 +242,6 @@ namespace MAT_NS_BEGIN {
             }
             record.flags = flags;
 
-            std::map<std::string, ::CsProtocol::Value>& ext = record.data[0].properties;
-            std::map<std::string, ::CsProtocol::Value> extPartB;
-
             for (auto &kv : eventProperties.GetProperties()) {
 
                 EventRejectedReason isValidPropertyName = validatePropertyName(kv.first);
@@ -165,281 +253,33 @@ namespace MAT_NS_BEGIN {
                     m_owner.DispatchEvent(evt);
                     return false;
                 }
-                const auto &k = kv.first;
-                const auto &v = kv.second;
-                if (v.piiKind != PiiKind_None)
-                {
-                    if (v.piiKind == PiiKind::CustomerContentKind_GenericData)
-                    {  //LOG_TRACE("PIIExtensions: %s=%s (PiiKind=%u)", k.c_str(), v.to_string().c_str(), v.piiKind);
-                        CsProtocol::CustomerContent cc;
-                        cc.Kind = CsProtocol::CustomerContentKind::GenericContent;
-                        CsProtocol::Value temp;
-
-                        CsProtocol::Attributes attrib;
-                        attrib.customerContent.push_back(cc);
-
-                        temp.attributes.push_back(attrib);
-                        temp.stringValue = v.to_string();
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = temp;
-                        }
-                        else
-                        {
-                            ext[k] = temp;
-                        }
-
-                    }
-                    else
-                    { //LOG_TRACE("PIIExtensions: %s=%s (PiiKind=%u)", k.c_str(), v.to_string().c_str(), v.piiKind);
-                        CsProtocol::PII pii;
-                        pii.Kind = static_cast<CsProtocol::PIIKind>(v.piiKind);
-                        CsProtocol::Value temp;
-
-                        CsProtocol::Attributes attrib;
-                        attrib.pii.push_back(pii);
-
-
-                        temp.attributes.push_back(attrib);
-                        temp.stringValue = v.to_string();
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = temp;
-                        }
-                        else
-                        {
-                            ext[k] = temp;
-                        }
-#if 0 /* v2 code */
-                        if (v.piiKind != PiiKind_None)
-                        {
-                            //LOG_TRACE("PIIExtensions: %s=%s (PiiKind=%u)", k.c_str(), v.to_string().c_str(), v.piiKind);
-                            CsProtocol::PII pii;
-                            pii.Kind = static_cast<CsProtocol::PIIKind>(v.piiKind);
-                            pii.RawContent = v.to_string();
-                            // ScrubType = 1 is the O365 scrubber which is the default behavior.
-                            // pii.ScrubType = static_cast<PIIScrubber>(O365);
-                            pii.ScrubType = CsProtocol::O365;
-                            PIIExtensions[k] = pii;
-                            // 4. Send event's Pii context fields as record.PIIExtensions
-                        }
-                        else
-                        {
-                            //LOG_TRACE("PIIExtensions: %s=%s (PiiKind=%u)", k.c_str(), v.to_string().c_str(), v.piiKind);
-                            CsProtocol::CustomerContent cc;
-                            cc.Kind = static_cast<CsProtocol::CustomerContentKind>(v.ccKind);
-                            cc.RawContent = v.to_string();
-                            ccExtensions[k] = cc;
-                            // 4. Send event's Pii context fields as record.PIIExtensions
-#endif
-                    }
-                }
-                else {
-                    std::vector<uint8_t> guid;
-                    uint8_t guid_bytes[16] = { 0 };
-
-                    switch (v.type)
-                    {
-                    case EventProperty::TYPE_STRING:
-                    {
-                        CsProtocol::Value temp;
-                        temp.stringValue = v.to_string();
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = temp;
-                        }
-                        else
-                        {
-                            ext[k] = temp;
-                        }
-                        break;
-                    }
-                    case EventProperty::TYPE_INT64:
-                    {
-                        CsProtocol::Value temp;
-                        temp.type = ::CsProtocol::ValueKind::ValueInt64;
-                        temp.longValue = v.as_int64;
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = temp;
-                        }
-                        else
-                        {
-                            ext[k] = temp;
-                        }
-                        break;
-                    }
-                    case EventProperty::TYPE_DOUBLE:
-                    {
-                        CsProtocol::Value temp;
-                        temp.type = ::CsProtocol::ValueKind::ValueDouble;
-                        temp.doubleValue = v.as_double;
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = temp;
-                        }
-                        else
-                        {
-                            ext[k] = temp;
-                        }
-                        break;
-                    }
-                    case EventProperty::TYPE_TIME:
-                    {
-                        CsProtocol::Value temp;
-                        temp.type = ::CsProtocol::ValueKind::ValueDateTime;
-                        temp.longValue = v.as_time_ticks.ticks;
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = temp;
-                        }
-                        else
-                        {
-                            ext[k] = temp;
-                        }
-                        break;
-                    }
-                    case EventProperty::TYPE_BOOLEAN:
-                    {
-                        CsProtocol::Value temp;
-                        temp.type = ::CsProtocol::ValueKind::ValueBool;
-                        temp.longValue = v.as_bool;
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = temp;
-                        }
-                        else
-                        {
-                            ext[k] = temp;
-                        }
-                        break;
-                    }
-                    case EventProperty::TYPE_GUID:
-                    {
-                        GUID_t temp = v.as_guid;
-                        temp.to_bytes(guid_bytes);
-                        guid = std::vector<uint8_t>(guid_bytes, guid_bytes + sizeof(guid_bytes) / sizeof(guid_bytes[0]));
-
-                        CsProtocol::Value tempValue;
-                        tempValue.type = ::CsProtocol::ValueKind::ValueGuid;
-                        tempValue.guidValue.push_back(guid);
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = tempValue;
-                        }
-                        else
-                        {
-                            ext[k] = tempValue;
-                        }
-                        break;
-                    }
-                    case EventProperty::TYPE_INT64_ARRAY:
-                    {
-                        CsProtocol::Value temp;
-                        temp.type = ::CsProtocol::ValueKind::ValueArrayInt64;
-                        temp.longArray.push_back(*v.as_longArray);
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = temp;
-                        }
-                        else
-                        {
-                            ext[k] = temp;
-                        }
-                        break;
-                    }
-                    case EventProperty::TYPE_DOUBLE_ARRAY:
-                    {
-                        CsProtocol::Value temp;
-                        temp.type = ::CsProtocol::ValueKind::ValueArrayDouble;
-                        temp.doubleArray.push_back(*v.as_doubleArray);
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = temp;
-                        }
-                        else
-                        {
-                            ext[k] = temp;
-                        }
-                        break;
-                    }
-                    case EventProperty::TYPE_STRING_ARRAY:
-                    {
-                        CsProtocol::Value temp;
-                        temp.type = ::CsProtocol::ValueKind::ValueArrayString;
-                        temp.stringArray.push_back(*v.as_stringArray);
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = temp;
-                        }
-                        else
-                        {
-                            ext[k] = temp;
-                        }
-                        break;
-                    }
-                    case EventProperty::TYPE_GUID_ARRAY:
-                    {
-                        CsProtocol::Value temp;
-                        temp.type = ::CsProtocol::ValueKind::ValueArrayGuid;
-
-                        std::vector<std::vector<uint8_t>> values;
-                        for (const auto& tempValue : *v.as_guidArray)
-                        {
-                            tempValue.to_bytes(guid_bytes);
-                            guid = std::vector<uint8_t>(guid_bytes, guid_bytes + sizeof(guid_bytes) / sizeof(guid_bytes[0]));
-                            values.push_back(guid);
-                        }
-                        temp.guidArray.push_back(values);
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = temp;
-                        }
-                        else
-                        {
-                            ext[k] = temp;
-                        }
-                        break;
-                    }
-                    default:
-                    {
-                        // Convert all unknown types to string
-                        CsProtocol::Value temp;
-                        temp.stringValue = v.to_string();
-                        if (v.dataCategory == DataCategory_PartB)
-                        {
-                            extPartB[k] = temp;
-                        }
-                        else
-                        {
-                            ext[k] = temp;
-                        }
-                    }
-                    }
-                }
             }
 
-            if (extPartB.size() > 0)
+            // special case of CorrelationVector value: a Part C property of the event
+            // replaces one set in the context, and neither is sent as a property
+            std::map<std::string, ::CsProtocol::Value>& ext = record.data[0].properties;
+            auto cvProperty = eventProperties.GetProperties().find(CorrelationVector::PropertyName);
+            if (cvProperty != eventProperties.GetProperties().end() && cvProperty->second.dataCategory == DataCategory_PartB)
             {
-                ::CsProtocol::Data partBdata;
-                partBdata.properties = extPartB;
-                record.baseData.push_back(partBdata);
+                cvProperty = eventProperties.GetProperties().end();
             }
-
-            // special case of CorrelationVector value
-            if (ext.count(CorrelationVector::PropertyName) > 0)
+            auto cvIter = ext.find(CorrelationVector::PropertyName);
+            if (cvProperty != eventProperties.GetProperties().end() || cvIter != ext.end())
             {
-                CsProtocol::Value cvValue = ext[CorrelationVector::PropertyName];
+                CsProtocol::Value cvValue = (cvProperty != eventProperties.GetProperties().end()) ? toValue(cvProperty->second) : std::move(cvIter->second);
 
                 if (cvValue.type == ::CsProtocol::ValueKind::ValueString)
                 {
-                    record.cV = cvValue.stringValue;
+                    record.cV = std::move(cvValue.stringValue);
                 }
                 else
                 {
                     LOG_TRACE("CorrelationVector value type is invalid %u", cvValue.type);
                 }
-                ext.erase(CorrelationVector::PropertyName);
+                if (cvIter != ext.end())
+                {
+                    ext.erase(cvIter);
+                }
             }
 
             // scrub if MICROSOFT_EVENTTAG_DROP_PII is set
@@ -451,8 +291,55 @@ namespace MAT_NS_BEGIN {
             return true;
         }
 
+        /// <summary>
+        /// Converts the custom properties of an event that went through decorateRecord:
+        /// Part B properties go to record.baseData, Part C properties to record.data,
+        /// where they replace context properties with the same name.
+        /// </summary>
+        static void decorateProperties(::CsProtocol::Record& record, EventProperties const& eventProperties)
+        {
+            std::map<std::string, ::CsProtocol::Value>& ext = record.data[0].properties;
+            std::map<std::string, ::CsProtocol::Value> extPartB;
+
+            // Properties come in key order, so the position right after the previous
+            // insert is passed as a hint, which makes each insert amortized constant.
+            auto extHint = ext.end();
+            auto extPartBHint = extPartB.end();
+            for (auto &kv : eventProperties.GetProperties()) {
+                const auto &k = kv.first;
+                const auto &v = kv.second;
+                bool partB = (v.dataCategory == DataCategory_PartB);
+                if (!partB && k == CorrelationVector::PropertyName)
+                {
+                    // Already applied to record.cV by decorateRecord
+                    continue;
+                }
+
+                auto& target = partB ? extPartB : ext;
+                auto& hint = partB ? extPartBHint : extHint;
+                hint = target.emplace_hint(hint, k, ::CsProtocol::Value());
+                hint->second = toValue(v);
+                ++hint;
+            }
+
+            if (extPartB.size() > 0)
+            {
+                record.baseData.emplace_back();
+                record.baseData.back().properties = std::move(extPartB);
+            }
+        }
+
+        bool decorate(::CsProtocol::Record& record, EventLatency& latency, EventProperties const& eventProperties)
+        {
+            if (!decorateRecord(record, latency, eventProperties))
+            {
+                return false;
+            }
+            decorateProperties(record, eventProperties);
+            return true;
+        }
+
     };
 
 } MAT_NS_END
 #endif
-
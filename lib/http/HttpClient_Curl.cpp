@@ -85,8 +85,11 @@ namespace MAT_NS_BEGIN {
             response->m_result = HttpResult_OK;
 
             response->m_statusCode = operation.GetResponseCode();
-            if (response->m_statusCode == CURLE_FAILED_INIT) {
-                // There was an error in CURL stack while trying to create request
+            if ((response->m_statusCode == CURLE_FAILED_INIT) ||
+                (response->m_statusCode == CURLE_UNSUPPORTED_PROTOCOL) ||
+                (response->m_statusCode == CURLE_URL_MALFORMAT)) {
+                // There was an error in CURL stack while trying to create request,
+                // or the request URL cannot be used
                 response->m_result = HttpResult_LocalFailure;
             } else if ((CURLE_OK < response->m_statusCode) && (response->m_statusCode <= CURL_LAST)) {
                 if (operation.WasAborted()) {
@@ -0,0 +1,362 @@
+//
+// Copyright (c) 2015-2020 Microsoft Corporation and Contributors.
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "mat/config.h"
+
+// Assume that if we are compiling with MSVC, then we prefer to use Windows HTTP stack,
+// e.g. WinInet.dll or Win 10 HTTP client instead
+#if defined(MATSDK_PAL_CPP11) && !defined(_MSC_VER) && defined(HAVE_MAT_DEFAULT_HTTP_CLIENT)
+
+#include "HttpClient_CurlMulti.hpp"
+#include "utils/Utils.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+// curl_multi_poll / curl_multi_wakeup are available since libcurl 7.68.0.
+// Older versions fall back to a short curl_multi_wait timeout.
+#if LIBCURL_VERSION_NUM >= 0x074400
+#define HAVE_CURL_MULTI_POLL
+#endif
+
+#define CURL_MULTI_POLL_TIMEOUT_MS  1000
+#define CURL_MULTI_WAIT_TIMEOUT_MS  50
+#define CURL_CONN_TIMEOUT_SEC       5L
+
+namespace MAT_NS_BEGIN {
+
+    static std::string NextMultiReqId() {
+        static std::atomic<uint64_t> seq(0);
+        return std::string("MREQ-") + std::to_string(seq.fetch_add(1));
+    }
+
+    HttpClient_CurlMulti::HttpClient_CurlMulti(long maxHostConnections) :
+        m_multi(nullptr),
+        m_stopping(false),
+        m_cancelAll(false)
+    {
+        curl_global_init(CURL_GLOBAL_ALL);
+        m_multi = curl_multi_init();
+        if (m_multi != nullptr)
+        {
+            // Multiplex concurrent uploads over a single HTTP/2 connection when possible
+            curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+            if (maxHostConnections > 0)
+            {
+                curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, maxHostConnections);
+            }
+        }
+        m_thread = std::thread(&HttpClient_CurlMulti::Run, this);
+    }
+
+    HttpClient_CurlMulti::~HttpClient_CurlMulti()
+    {
+        m_stopping = true;
+        Wakeup();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+        for (CURL* easy : m_handlePool)
+        {
+            curl_easy_cleanup(easy);
+        }
+        m_handlePool.clear();
+        if (m_multi != nullptr)
+        {
+            curl_multi_cleanup(m_multi);
+        }
+        curl_global_cleanup();
+    }
+
+    IHttpRequest* HttpClient_CurlMulti::CreateRequest()
+    {
+        return new SimpleHttpRequest(NextMultiReqId());
+    }
+
+    void HttpClient_CurlMulti::SendRequestAsync(IHttpRequest* request, IHttpResponseCallback* callback)
+    {
+        // Note: 'request' is never owned by IHttpClient and gets deleted in EventsUploadContext.clear()
+        std::unique_ptr<Transfer> transfer(new Transfer());
+        transfer->request = static_cast<SimpleHttpRequest*>(request);
+        transfer->callback = callback;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_pending.push_back(std::move(transfer));
+        }
+        Wakeup();
+    }
+
+    void HttpClient_CurlMulti::CancelRequestAsync(std::string const& id)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_cancelled.push_back(id);
+        }
+        Wakeup();
+    }
+
+    void HttpClient_CurlMulti::CancelAllRequests()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_cancelAll = true;
+        }
+        Wakeup();
+    }
+
+    size_t HttpClient_CurlMulti::GetPooledHandleCount()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_handlePool.size();
+    }
+
+    void HttpClient_CurlMulti::Wakeup()
+    {
+#ifdef HAVE_CURL_MULTI_POLL
+        if (m_multi != nullptr)
+        {
+            curl_multi_wakeup(m_multi);
+        }
+#endif
+    }
+
+    CURL* HttpClient_CurlMulti::AcquireHandle()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (!m_handlePool.empty())
+            {
+                CURL* easy = m_handlePool.back();
+                m_handlePool.pop_back();
+                return easy;
+            }
+        }
+        return curl_easy_init();
+    }
+
+    void HttpClient_CurlMulti::ReleaseHandle(CURL* easy)
+    {
+        // Reset options but keep the handle: live connections stay in the multi handle's cache
+        curl_easy_reset(easy);
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_handlePool.push_back(easy);
+    }
+
+    size_t HttpClient_CurlMulti::WriteCallback(char* ptr, size_t size, size_t nmemb, void* userdata)
+    {
+        auto data = static_cast<std::vector<uint8_t>*>(userdata);
+        data->insert(data->end(), ptr, ptr + size * nmemb);
+        return size * nmemb;
+    }
+
+    void HttpClient_CurlMulti::StartTransfer(std::unique_ptr<Transfer> transfer)
+    {
+        SimpleHttpRequest* request = transfer->request;
+        std::string id = request->GetId();
+
+        transfer->easy = (m_multi != nullptr) ? AcquireHandle() : nullptr;
+        CURL* easy = transfer->easy;
+        m_active[id] = std::move(transfer);
+        Transfer* t = m_active[id].get();
+
+        if (easy == nullptr)
+        {
+            FinishTransfer(id, CURLE_FAILED_INIT, false);
+            return;
+        }
+
+        curl_easy_setopt(easy, CURLOPT_URL, request->m_url.c_str());
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, t);
+        curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT, CURL_CONN_TIMEOUT_SEC);
+        curl_easy_setopt(easy, CURLOPT_LOW_SPEED_TIME, 30L);
+        curl_easy_setopt(easy, CURLOPT_LOW_SPEED_LIMIT, 4096L);
+        curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+
+        // Peer and host verification are left to the libcurl defaults (on)
+        for (auto const& kv : request->m_headers)
+        {
+            std::string header = kv.first;
+            header += ": ";
+            header += kv.second;
+            t->headers = curl_slist_append(t->headers, header.c_str());
+        }
+        if (t->headers != nullptr)
+        {
+            curl_easy_setopt(easy, CURLOPT_HTTPHEADER, t->headers);
+        }
+
+        curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, &HttpClient_CurlMulti::WriteCallback);
+        curl_easy_setopt(easy, CURLOPT_HEADERDATA, &t->respHeaders);
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, &HttpClient_CurlMulti::WriteCallback);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, &t->respBody);
+
+        if (request->m_method == "POST")
+        {
+            // The request outlives the transfer, so libcurl may read the body in place
+            curl_easy_setopt(easy, CURLOPT_POST, 1L);
+            curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(request->m_body.size()));
+            curl_easy_setopt(easy, CURLOPT_POSTFIELDS, request->m_body.empty() ? "" : reinterpret_cast<const char*>(request->m_body.data()));
+        }
+        else if (request->m_method != "GET")
+        {
+            LOG_WARN("HTTP request %s: unsupported method %s", id.c_str(), request->m_method.c_str());
+            FinishTransfer(id, CURLE_UNSUPPORTED_PROTOCOL, false);
+            return;
+        }
+
+        if (curl_multi_add_handle(m_multi, easy) != CURLM_OK)
+        {
+            FinishTransfer(id, CURLE_FAILED_INIT, false);
+        }
+    }
+
+    void HttpClient_CurlMulti::FinishTransfer(std::string id, CURLcode code, bool aborted)
+    {
+        auto it = m_active.find(id);
+        if (it == m_active.end())
+        {
+            return;
+        }
+        std::unique_ptr<Transfer> t = std::move(it->second);
+        m_active.erase(it);
+
+        auto response = std::unique_ptr<SimpleHttpResponse>(new SimpleHttpResponse(id));
+        if (aborted)
+        {
+            response->m_result = HttpResult_Aborted;
+        }
+        else if (code == CURLE_OK)
+        {
+            long statusCode = 0;
+            curl_easy_getinfo(t->easy, CURLINFO_RESPONSE_CODE, &statusCode);
+            response->m_result = HttpResult_OK;
+            response->m_statusCode = static_cast<unsigned>(statusCode);
+        }
+        else if ((code == CURLE_FAILED_INIT) || (code == CURLE_UNSUPPORTED_PROTOCOL) ||
+                 (code == CURLE_URL_MALFORMAT) || (code == CURLE_OUT_OF_MEMORY))
+        {
+            // There was an error in CURL stack while trying to create request
+            response->m_result = HttpResult_LocalFailure;
+        }
+        else
+        {
+            response->m_result = HttpResult_NetworkFailure;
+        }
+
+        if (!t->respHeaders.empty())
+        {
+            std::istringstream ss(std::string(t->respHeaders.begin(), t->respHeaders.end()));
+            std::string line;
+            while (std::getline(ss, line, '\n'))
+            {
+                if (!line.empty() && line.back() == '\r')
+                {
+                    line.pop_back();
+                }
+                auto pos = line.find(": ");
+                if (pos != std::string::npos)
+                {
+                    response->m_headers.set(line.substr(0, pos), line.substr(pos + 2));
+                }
+            }
+        }
+        response->m_body = std::move(t->respBody);
+
+        if (t->easy != nullptr)
+        {
+            curl_multi_remove_handle(m_multi, t->easy);
+            ReleaseHandle(t->easy);
+        }
+        curl_slist_free_all(t->headers);
+
+        // 'response' is no longer owned by IHttpClient and gets deleted in EventsUploadContext.clear()
+        t->callback->OnHttpResponse(response.release());
+    }
+
+    void HttpClient_CurlMulti::Run()
+    {
+        while (!m_stopping)
+        {
+            std::vector<std::unique_ptr<Transfer>> pending;
+            std::vector<std::string> cancelled;
+            bool cancelAll;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                pending.swap(m_pending);
+                cancelled.swap(m_cancelled);
+                cancelAll = m_cancelAll;
+                m_cancelAll = false;
+            }
+
+            for (auto& transfer : pending)
+            {
+                StartTransfer(std::move(transfer));
+            }
+
+            if (cancelAll)
+            {
+                for (auto const& kv : m_active)
+                {
+                    cancelled.push_back(kv.first);
+                }
+            }
+            for (auto const& id : cancelled)
+            {
+                LOG_TRACE("HTTP request id=%s being aborted...", id.c_str());
+                FinishTransfer(id, CURLE_ABORTED_BY_CALLBACK, true);
+            }
+
+            if (m_multi == nullptr)
+            {
+                PAL::sleep(CURL_MULTI_WAIT_TIMEOUT_MS);
+                continue;
+            }
+
+            int running = 0;
+            curl_multi_perform(m_multi, &running);
+
+            int remaining = 0;
+            while (CURLMsg* msg = curl_multi_info_read(m_multi, &remaining))
+            {
+                if (msg->msg == CURLMSG_DONE)
+                {
+                    Transfer* t = nullptr;
+                    curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &t);
+                    CURLcode result = msg->data.result;
+                    if (t != nullptr)
+                    {
+                        FinishTransfer(t->request->GetId(), result, false);
+                    }
+                }
+            }
+
+#ifdef HAVE_CURL_MULTI_POLL
+            curl_multi_poll(m_multi, nullptr, 0, CURL_MULTI_POLL_TIMEOUT_MS, nullptr);
+#else
+            curl_multi_wait(m_multi, nullptr, 0, CURL_MULTI_WAIT_TIMEOUT_MS, nullptr);
+#endif
+        }
+
+        // Complete everything still in flight so that callers waiting on callbacks are released
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            for (auto& transfer : m_pending)
+            {
+                std::string id = transfer->request->GetId();
+                m_active[id] = std::move(transfer);
+            }
+            m_pending.clear();
+        }
+        while (!m_active.empty())
+        {
+            FinishTransfer(m_active.begin()->first, CURLE_ABORTED_BY_CALLBACK, true);
+        }
+    }
+
+} MAT_NS_END
+
+#endif
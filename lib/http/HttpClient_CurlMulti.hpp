@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2015-2020 Microsoft Corporation and Contributors.
+// SPDX-License-Identifier: Apache-2.0
+//
+#ifndef HTTPCLIENTCURLMULTI_HPP
+#define HTTPCLIENTCURLMULTI_HPP
+
+#ifdef HAVE_MAT_DEFAULT_HTTP_CLIENT
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <curl/curl.h>
+
+#include "IHttpClient.hpp"
+#include "pal/PAL.hpp"
+
+namespace MAT_NS_BEGIN {
+
+/**
+ * Curl-based HTTP client driving all transfers from a single I/O thread
+ * through one curl_multi handle.
+ *
+ * Unlike HttpClient_Curl, which creates a new easy handle and an async
+ * thread per request, this client keeps a pool of easy handles and lets
+ * the multi handle's connection cache reuse keep-alive connections (and
+ * multiplex over HTTP/2 when the collector supports it). Request bodies
+ * are handed to libcurl in place, without copying.
+ *
+ * Opt in by registering an instance as CFG_MODULE_HTTP_CLIENT:
+ *
+ *     config.AddModule(CFG_MODULE_HTTP_CLIENT, std::make_shared<HttpClient_CurlMulti>());
+ */
+class HttpClient_CurlMulti : public IHttpClient {
+public:
+    /// <param name="maxHostConnections">Limit on concurrent connections per host, 0 for no limit</param>
+    HttpClient_CurlMulti(long maxHostConnections = 4);
+    virtual ~HttpClient_CurlMulti();
+
+    virtual IHttpRequest* CreateRequest() override;
+    virtual void SendRequestAsync(IHttpRequest* request, IHttpResponseCallback* callback) override;
+    virtual void CancelRequestAsync(std::string const& id) override;
+    virtual void CancelAllRequests() override;
+
+    /// <summary>Number of easy handles currently parked in the reuse pool.</summary>
+    size_t GetPooledHandleCount();
+
+protected:
+    struct Transfer
+    {
+        SimpleHttpRequest*     request  = nullptr;
+        IHttpResponseCallback* callback = nullptr;
+        CURL*                  easy     = nullptr;
+        struct curl_slist*     headers  = nullptr;
+        std::vector<uint8_t>   respHeaders;
+        std::vector<uint8_t>   respBody;
+    };
+
+    void Run();
+    void Wakeup();
+    void StartTransfer(std::unique_ptr<Transfer> transfer);
+    void FinishTransfer(std::string id, CURLcode code, bool aborted);
+    CURL* AcquireHandle();
+    void ReleaseHandle(CURL* easy);
+
+    static size_t WriteCallback(char* ptr, size_t size, size_t nmemb, void* userdata);
+
+    CURLM*                                       m_multi;
+    std::thread                                  m_thread;
+    std::atomic<bool>                            m_stopping;
+
+    // Shared between callers and the I/O thread
+    std::mutex                                   m_lock;
+    std::vector<std::unique_ptr<Transfer>>       m_pending;
+    std::vector<std::string>                     m_cancelled;
+    bool                                         m_cancelAll;
+    std::vector<CURL*>                           m_handlePool;
+
+    // Owned by the I/O thread
+    std::map<std::string, std::unique_ptr<Transfer>> m_active;
+};
+
+} MAT_NS_END
+
+#endif // HAVE_MAT_DEFAULT_HTTP_CLIENT
+
+#endif // HTTPCLIENTCURLMULTI_HPP
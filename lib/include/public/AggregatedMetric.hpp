@@ -60,6 +60,12 @@ namespace MAT_NS_BEGIN
             /// </summary>
             ~AggregatedMetric();
 
+            /// <summary>
+            /// An AggregatedMetric owns its aggregation state and cannot be copied.
+            /// </summary>
+            AggregatedMetric(AggregatedMetric const&) = delete;
+            AggregatedMetric& operator=(AggregatedMetric const&) = delete;
+
             /// <summary>
             /// Pushes a single metric value for auto-aggregation.
             /// </summary>
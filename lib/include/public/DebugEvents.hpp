@@ -75,6 +75,8 @@ namespace MAT_NS_BEGIN
         EVT_DROPPED             = 0x03000000,
         /// <summary>Event(s) filtered.</summary>
         EVT_FILTERED            = 0x03000001,
+        /// <summary>Event(s) shed at the ingestion limit.</summary>
+        EVT_SHED                = 0x03000002,
 
         /// <summary>Event(s) sent.</summary>
         EVT_SENT                = 0x04000000,
@@ -205,6 +207,9 @@ namespace MAT_NS_BEGIN
         /// <summary>The DebugEventSource constructor.</summary>
         DebugEventSource() : seq(0) {}
 
+        /// <summary>The DebugEventSource destructor.</summary>
+        virtual ~DebugEventSource();
+
         /// <summary>Adds an event listener for the specified debug event type.</summary>
         virtual void AddEventListener(DebugEventType type, DebugEventListener &listener);
 
@@ -220,6 +225,13 @@ namespace MAT_NS_BEGIN
         /// <summary>Detach cascaded DebugEventSource to forward all events to</summary>
         virtual bool DetachEventSource(DebugEventSource & other);
 
+        /// <summary>
+        /// Whether any DebugEventSource may have a listener for the specified type.
+        /// Types are tracked per category (the high byte of the type), so this can
+        /// also return true when only a listener for a related type is registered.
+        /// </summary>
+        static bool HasListeners(DebugEventType type);
+
     protected:
 #ifndef _MANAGED
         /// <summary>
@@ -39,7 +39,10 @@ namespace MAT_NS_BEGIN
         STATUS_ENOSYS = ENOSYS,
 
         /// <summary>Not supported.</summary>
-        STATUS_ENOTSUP = ENOTSUP
+        STATUS_ENOTSUP = ENOTSUP,
+
+        /// <summary>Busy: the ingestion limit is reached</summary>
+        STATUS_EBUSY = EBUSY
     };
 
     enum DataCategory
@@ -563,6 +566,7 @@ namespace MAT_NS_BEGIN
         DROPPED_REASON_SERVER_DECLINED_5XX,
         DROPPED_REASON_SERVER_DECLINED_OTHER,
         DROPPED_REASON_RETRY_EXCEEDED,
+        DROPPED_REASON_INGESTION_LIMIT,
         DROPPED_REASON_COUNT
     };
 
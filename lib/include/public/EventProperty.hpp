@@ -330,6 +330,11 @@ namespace MAT_NS_BEGIN
         /// </summary>
         EventProperty& operator=(const EventProperty& source);
 
+        /// <summary>
+        /// An EventProperty move assignment operator.
+        /// </summary>
+        EventProperty& operator=(EventProperty&& source);
+
         /// <summary>
         /// An EventProperty assignment operator that takes a string value.
         /// </summary>
@@ -135,11 +135,42 @@ namespace MAT_NS_BEGIN
     /// </summary>
     static constexpr const char* const CFG_INT_CACHE_FILE_SIZE = "cacheFileSizeLimitInBytes";
 
+    /// <summary>
+    /// The offline storage engine: "SQLite" (default) or "SegmentLog".
+    /// </summary>
+    static constexpr const char* const CFG_STR_CACHE_STORAGE_ENGINE = "cacheStorageEngine";
+
+    /// <summary>
+    /// The size in bytes of one segment file of the "SegmentLog" storage engine.
+    /// </summary>
+    static constexpr const char* const CFG_INT_CACHE_SEGMENT_SIZE = "cacheSegmentSizeInBytes";
+
     /// <summary>
     /// The RAM queue size limit in bytes.
     /// </summary>
     static constexpr const char* const CFG_INT_RAM_QUEUE_SIZE = "cacheMemorySizeLimitInBytes";
 
+    /// <summary>
+    /// Number of bytes of events waiting in the RAM queue above which new events
+    /// are shed according to CFG_STR_INGESTION_POLICY. 0 means no limit. Set it
+    /// above CFG_INT_RAM_QUEUE_SIZE, the size at which a flush to disk starts.
+    /// </summary>
+    static constexpr const char* const CFG_INT_INGESTION_LIMIT = "ingestionLimitInBytes";
+
+    /// <summary>
+    /// What to do with an event logged at the ingestion limit: "Block" waits
+    /// for a flush to disk, "DropNewest" sheds the event, "DropOldest" sheds the
+    /// oldest queued events of the lowest latencies and "DropByPersistence"
+    /// sheds queued Normal persistence events to make room for Critical ones.
+    /// </summary>
+    static constexpr const char* const CFG_STR_INGESTION_POLICY = "ingestionPolicy";
+
+    /// <summary>
+    /// The longest time in milliseconds the "Block" ingestion policy waits
+    /// before shedding the event.
+    /// </summary>
+    static constexpr const char* const CFG_INT_INGESTION_BLOCK_TIME = "ingestionBlockTimeInMs";
+
     /// <summary>
     /// The size of the RAM queue buffers, in bytes.
     /// </summary>
@@ -190,6 +221,12 @@ namespace MAT_NS_BEGIN
     /// </summary>
     static constexpr const char* const CFG_INT_MAX_PENDING_REQ = "maxPendingHTTPRequests";
 
+    /// <summary>
+    /// Time window in milliseconds during which Max-latency events are coalesced
+    /// into a single upload. 0 starts a dedicated upload for every such event.
+    /// </summary>
+    static constexpr const char* const CFG_INT_IMMEDIATE_UPLOAD_WINDOW_MS = "immediateUploadWindowMs";
+
     /// <summary>
     /// The maximum package drop on full.
     /// </summary>
@@ -337,6 +374,16 @@ namespace MAT_NS_BEGIN
     /// </summary>
     static constexpr const char* const CFG_BOOL_HTTP_COMPRESSION = "compress";
 
+    /// <summary>
+    /// HTTP configuration: zlib compression level, 0 (none) to 9 (best), -1 for the zlib default
+    /// </summary>
+    static constexpr const char* const CFG_INT_HTTP_COMPRESSION_LEVEL = "compressionLevel";
+
+    /// <summary>
+    /// HTTP configuration: zlib compression strategy (Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE or Z_FIXED)
+    /// </summary>
+    static constexpr const char* const CFG_INT_HTTP_COMPRESSION_STRATEGY = "compressionStrategy";
+
     /// <summary>
     /// TPM configuration map
     /// </summary>
@@ -154,7 +154,18 @@ namespace MAT_NS_BEGIN
         {
         }
 
-        ///
+        /// <summary>
+        /// Applies changes made to the ILogConfiguration of this instance
+        /// after it was created.
+        /// </summary>
+        /// <remarks>
+        /// Settings read on hot paths (e.g. CFG_INT_MAX_PENDING_REQ,
+        /// CFG_INT_IMMEDIATE_UPLOAD_WINDOW_MS, the TPM maximum blob size and
+        /// the stats settings) are cached and keep their previous value until
+        /// this method is called. Earlier releases picked up changes to these
+        /// settings without it, so code that changes them at run time must
+        /// now call Configure() afterwards.
+        /// </remarks>
         virtual void Configure() = 0;
 
         /// Retrieve an ISemanticContext interface through which to specify context information
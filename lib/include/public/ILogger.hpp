@@ -621,6 +621,25 @@ Refer to https://osgwiki.com/wiki/Common_Schema_Event_Overrides for details on t
         /// Get collection of current event filters.
         /// </summary>
         virtual IEventFilterCollection const& GetEventFilters() const noexcept = 0;
+
+        /// <summary>
+        /// Logs a custom event with the specified name and properties
+        /// without waiting when the SDK is saturated.
+        /// </summary>
+        /// <remarks>
+        /// Unlike LogEvent, this method never waits for the "Block" ingestion
+        /// policy (see CFG_STR_INGESTION_POLICY): at the ingestion limit the
+        /// event is shed right away. Loggers that do not implement it
+        /// return STATUS_ENOTSUP.
+        /// </remarks>
+        /// <param name="properties">Properties of this custom event, specified using an EventProperties object.</param>
+        /// <returns>STATUS_SUCCESS if the event was accepted, STATUS_EBUSY if it was shed
+        /// at the ingestion limit, STATUS_EPERM if it was filtered out, STATUS_EFAIL otherwise.</returns>
+        virtual status_t TryLogEvent(EventProperties const& properties)
+        {
+            UNREFERENCED_PARAMETER(properties);
+            return STATUS_ENOTSUP;
+        }
     };
 
 
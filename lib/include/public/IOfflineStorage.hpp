@@ -119,6 +119,16 @@ namespace MAT_NS_BEGIN {
         virtual void OnStorageRecordsRejected(std::map<std::string, size_t> const& numRecords) = 0;
 
         virtual void OnStorageRecordsSaved(size_t numRecords) = 0;
+
+        /// <summary>
+        /// Called when events are shed at the ingestion limit, either instead
+        /// of being stored or by evicting records waiting in the RAM queue
+        /// </summary>
+        /// <param name="numRecords">Number of records shed</param>
+        virtual void OnStorageRecordsShed(std::map<std::string, size_t> const& numRecords)
+        {
+            UNREFERENCED_PARAMETER(numRecords);
+        }
     };
 
     class IOfflineStorage
@@ -168,7 +178,11 @@ namespace MAT_NS_BEGIN {
         /// <remarks>
         /// The offline storage might need to trim the oldest events before
         /// inserting the new one in order to maintain its configured size limit.
-        /// Called from the internal worker thread.
+        /// The id of the stored record is chosen by the storage: it may keep
+        /// <c>record.id</c> (MemoryStorage, SegmentLog) or assign its own key
+        /// (SQLite storage uses the integer row id). Callers pass a unique id
+        /// per record; the result of storing an id that is already present is
+        /// unspecified. Called from the internal worker thread.
         /// </remarks>
         /// <param name="record">Record data to store</param>
         /// <returns>Whether the record was successfully stored</returns>
@@ -202,7 +216,10 @@ namespace MAT_NS_BEGIN {
         /// accepted by the consumer are reserved for the specified amount of time
         /// <paramref name="leaseTimeMs"/> and will not be returned again by this
         /// method until explicitly released or deleted or until their reservation
-        /// period expires. Called from the internal worker thread.
+        /// period expires. The ids of the returned records are the ones to pass
+        /// to <see cref="DeleteRecords"/> and <see cref="ReleaseRecords"/>, and
+        /// they need not match the ids the records were stored with. Called
+        /// from the internal worker thread.
         /// <param name="consumer">Callback functor processing the individual
         /// retrieved records</param>
         /// <param name="leaseTimeMs">Amount of time all acccepted records should
@@ -245,8 +262,9 @@ namespace MAT_NS_BEGIN {
         /// Delete records with specified IDs
         /// </summary>
         /// <remarks>
-        /// IDs of records that are no longer found in the storage are silently
-        /// ignored. Called from the internal worker thread.
+        /// IDs of records that are no longer found in the storage, or that
+        /// were not handed out by this storage, are ignored. Called from the
+        /// internal worker thread.
         /// </remarks>
         /// <param name="ids">Identifiers of records to delete</param>
         virtual void DeleteRecords(std::vector<StorageRecordId> const& ids, HttpHeaders headers, bool& fromMemory) = 0;
@@ -255,8 +273,8 @@ namespace MAT_NS_BEGIN {
         /// Release event records with specified IDs
         /// </summary>
         /// <remarks>
-        /// IDs of events that are no longer found in the storage are silently
-        /// ignored. If <paramref name="incrementRetryCount"/> is set and the retry
+        /// IDs of events that are no longer found in the storage, or that were
+        /// not handed out by this storage, are ignored. If <paramref name="incrementRetryCount"/> is set and the retry
         /// counter of some records reaches the maximum retry count, those events
         /// may be dropped as part of the releasing procedure. Persistent storage
         /// implementations of this interface drop these records. MemoryStorage does not.
@@ -116,6 +116,11 @@ namespace MAT_NS_BEGIN
 
         virtual IEventFilterCollection const& GetEventFilters() const noexcept override { return m_filters; }
 
+        virtual status_t TryLogEvent(EventProperties const & /*properties*/) override
+        {
+            return STATUS_ENOSYS;
+        }
+
         virtual void SetParentContext(ISemanticContext * /*context*/) override {};
 
         virtual void SetLevel(uint8_t /*level*/) override {};
@@ -41,11 +41,14 @@ namespace MAT_NS_BEGIN {
     void MemoryStorage::Shutdown()
     {
         LOCKGUARD(m_reserved_lock);
-        LOCKGUARD(m_records_lock);
 
         for (unsigned latency = EventLatency_Off; (latency <= EventLatency_Max); latency++)
         {
-            size_t numRecords = m_records[latency].size();
+            size_t numRecords;
+            {
+                LOCKGUARD(m_queues[latency].lock);
+                numRecords = m_queues[latency].records.size();
+            }
             if (numRecords)
             {
                 // OfflineStorageHandler high-level wrapper must flush these on graceful shutdown
@@ -78,6 +81,21 @@ namespace MAT_NS_BEGIN {
         return false;
     }
 
+    size_t MemoryStorage::GetRecordSize(StorageRecord const& record)
+    {
+        return sizeof(record) + record.blob.size() + record.id.size() + record.tenantToken.size();
+    }
+
+    /// <summary>
+    /// Removes a record from the RAM queue of its latency, which must be
+    /// locked by the caller, and advances the iterator past it.
+    /// </summary>
+    void MemoryStorage::eraseRecord(RecordQueue& queue, std::deque<StorageRecord>::iterator& it)
+    {
+        m_size -= GetRecordSize(*it);
+        it = queue.records.erase(it);
+    }
+
     /// <summary>
     /// Store one telemetry event record
     /// </summary>
@@ -93,21 +111,45 @@ namespace MAT_NS_BEGIN {
     bool MemoryStorage::StoreRecord(StorageRecord const & record)
     {
         // Don't store events with latency set to off. Logger API already does a similar check.
-        if (record.latency == EventLatency_Off)
+        if ((record.latency <= EventLatency_Off) || (record.latency > EventLatency_Max))
             return false;
 
-        LOCKGUARD(m_records_lock);
-        m_size += record.blob.size() + sizeof(record); // approximate contents size
-
+        RecordQueue& queue = m_queues[record.latency];
+        {
+            LOCKGUARD(queue.lock);
 #ifdef DEBUG_DUPLICATE_ROUTES
-        if (contains(m_records[record.latency], record))
-            LOG_WARN("Vector already contains this element!");
+            if (contains(queue.records, record))
+                LOG_WARN("Queue already contains this element!");
 #endif
-
-        m_records[record.latency].push_back(std::move(record));
+            m_size += GetRecordSize(record);
+            queue.records.push_back(record);
+        }
         return true;
     }
 
+    size_t MemoryStorage::ShedRecords(size_t bytes, EventLatency maxLatency, bool keepCritical, std::map<std::string, size_t>& shedByTenant)
+    {
+        size_t freed = 0;
+        for (int latency = static_cast<int>(EventLatency_Normal); (latency <= static_cast<int>(maxLatency)) && (freed < bytes); latency++)
+        {
+            RecordQueue& queue = m_queues[latency];
+            LOCKGUARD(queue.lock);
+            auto it = queue.records.begin();
+            while ((it != queue.records.end()) && (freed < bytes))
+            {
+                if (keepCritical && (it->persistence == EventPersistence_Critical))
+                {
+                    ++it;
+                    continue;
+                }
+                freed += GetRecordSize(*it);
+                shedByTenant[it->tenantToken]++;
+                eraseRecord(queue, it);
+            }
+        }
+        return freed;
+    }
+
     size_t MemoryStorage::StoreRecords(std::vector<StorageRecord> & records)
     {
         size_t stored = 0;
@@ -120,9 +162,11 @@ namespace MAT_NS_BEGIN {
     }
 
     /// <summary>
-    /// Get records from MemoryStorage.
-    /// Getting records automatically deletes them.
-    /// Reservation is not currently supported.
+    /// Get records from MemoryStorage, highest latency first and in the
+    /// order they were stored within a latency. Released records go back
+    /// in by timestamp, ahead of the newer ones stored while in flight.
+    /// Without a lease time, records the consumer accepts are deleted;
+    /// otherwise they are kept as reserved until deleted or released.
     /// </summary>
     /// <param name="consumer">The consumer.</param>
     /// <param name="leaseTimeMs">The lease time ms.</param>
@@ -144,36 +188,47 @@ namespace MAT_NS_BEGIN {
             minLatency = EventLatency_Off;
 
         LOCKGUARD(m_reserved_lock);
-        LOCKGUARD(m_records_lock);
-        m_lastReadCount = 0;
+        unsigned readCount = 0;
         // Start processing events of critical latency first
         for (int latency = static_cast<int>(EventLatency_Max); (latency >= static_cast<int>(minLatency)) && (maxCount); latency--)
         {
-            while (maxCount && (m_records[latency]).size())
+            RecordQueue& queue = m_queues[latency];
+            LOCKGUARD(queue.lock);
+            while (maxCount && queue.records.size())
             {
-                StorageRecord & record = m_records[latency].back();
+                StorageRecord & record = queue.records.front();
 
-                size_t recordSize = record.blob.size() + sizeof(record);
-                StorageRecord forConsumer(record);
+                size_t recordSize = GetRecordSize(record);
+                bool wantMore;
                 if (leaseTimeMs)
                 {
+                    // Reserved records are kept for a retry, so the consumer gets a copy
+                    StorageRecord forConsumer(record);
                     forConsumer.reservedUntil = PAL::getUtcSystemTimeMs() + leaseTimeMs;
+                    wantMore = consumer(std::move(forConsumer));
+                }
+                else
+                {
+                    // Without a lease the record leaves the storage once accepted.
+                    // A consumer declining it must leave it untouched.
+                    wantMore = consumer(std::move(record));
                 }
-
-                bool wantMore = consumer(std::move(forConsumer)); // move to consumer
                 if (!wantMore) {
+                    m_lastReadCount = readCount;
                     return true;
                 }
 
                 if (leaseTimeMs) {
-                    m_reserved_records[record.id] = std::move(record); // move to reserved
+                    StorageRecordId id = record.id;
+                    m_reserved_records[std::move(id)] = std::move(record); // move to reserved
                 }
-                m_records[latency].pop_back();
-                m_size -= std::min(m_size, recordSize);
+                queue.records.pop_front();
+                m_size -= recordSize;
                 maxCount--;
-                m_lastReadCount++;
+                readCount++;
             }
         }
+        m_lastReadCount = readCount;
         return true;
     }
     
@@ -194,8 +249,7 @@ namespace MAT_NS_BEGIN {
     /// <returns></returns>
     unsigned MemoryStorage::LastReadRecordCount()
     {
-        LOCKGUARD(m_records_lock);
-        return static_cast<unsigned>(m_lastReadCount);
+        return m_lastReadCount;
     }
 
     void MemoryStorage::DeleteAllRecords()
@@ -207,18 +261,17 @@ namespace MAT_NS_BEGIN {
                 m_reserved_records.clear();
             }
         }
+        for (unsigned latency = EventLatency_Off; (latency <= EventLatency_Max); latency++)
         {
-            LOCKGUARD(m_records_lock);
-            for (unsigned latency = EventLatency_Off; (latency <= EventLatency_Max); latency++)
+            RecordQueue& queue = m_queues[latency];
+            LOCKGUARD(queue.lock);
+            for (auto const& record : queue.records)
             {
-                auto& records = m_records[latency];
-                if (records.size()) {
-                    records.clear();
-                }
+                m_size -= GetRecordSize(record);
             }
-            m_size = 0;
-            m_lastReadCount = 0;
+            queue.records.clear();
         }
+        m_lastReadCount = 0;
 
     }
 
@@ -260,24 +313,18 @@ namespace MAT_NS_BEGIN {
         }
 
         // Delete from ram queue, which is a bigger list
+        for (unsigned latency = EventLatency_Off; latency <= EventLatency_Max;  latency++)
         {
-            LOCKGUARD(m_records_lock);
-            for (unsigned latency = EventLatency_Off; latency <= EventLatency_Max;  latency++)
-            {
-                auto& records = m_records[latency];
-                auto it = records.begin();
-                // remove from records all ids that were found in the set
-                while (it != records.end()) {
-                    auto &v = *it;
-                    if (matcher(v, whereFilter))
-                    {
-                        size_t recordSize = v.blob.size() + sizeof(v);
-                        m_size -= std::min(m_size, recordSize);
-                        it = records.erase(it);
-                        continue;
-                    }
-                    ++it;
+            RecordQueue& queue = m_queues[latency];
+            LOCKGUARD(queue.lock);
+            auto it = queue.records.begin();
+            while (it != queue.records.end()) {
+                if (matcher(*it, whereFilter))
+                {
+                    eraseRecord(queue, it);
+                    continue;
                 }
+                ++it;
             }
         }
     }
@@ -293,57 +340,34 @@ namespace MAT_NS_BEGIN {
         UNREFERENCED_PARAMETER(headers);
         UNREFERENCED_PARAMETER(fromMemory);
 
+        // Ids that are not reserved are looked up in the ram queue
+        std::unordered_set<StorageRecordId> idSet;
         {
             // Delete from reserved records (m_reserved_records)
             LOCKGUARD(m_reserved_lock);
-            if (m_reserved_records.size())
+            for (auto const& id : ids)
             {
-                std::unordered_set<StorageRecordId> idSet(ids.begin(), ids.end());
-                auto it = m_reserved_records.begin();
-                while (it != m_reserved_records.end()) {
-                    auto &kv = *it;
-                    if (idSet.count(kv.first))
-                    {
-                        idSet.erase(kv.first);
-                        it = m_reserved_records.erase(it);
-                        continue;
-                    }
-                    ++it;
+                if (m_reserved_records.erase(id) == 0)
+                {
+                    idSet.insert(id);
                 }
-                if (idSet.size() == 0) // done
-                    return;
             }
         }
 
+        // For each latency - delete from current unreserved records
+        for (unsigned latency = EventLatency_Off; (latency <= EventLatency_Max) && idSet.size(); latency++)
         {
-            // Delete from ram queue (m_records[])
-            LOCKGUARD(m_records_lock);
-
-            // convert vector of ids to unordered set
-            std::unordered_set<StorageRecordId> idSet(ids.begin(), ids.end());
-
-            // For each latency - delete from current unreserved records
-            for (unsigned latency = EventLatency_Off; (latency <= EventLatency_Max); latency++)
-            {
-                auto& records = m_records[latency];
-                if (records.size() && idSet.size())
+            RecordQueue& queue = m_queues[latency];
+            LOCKGUARD(queue.lock);
+            auto it = queue.records.begin();
+            while ((it != queue.records.end()) && idSet.size()) {
+                // record id appears once only, so remove from set
+                if (idSet.erase(it->id))
                 {
-                    auto it = records.begin();
-                    // remove from records all ids that were found in the set
-                    while (it != records.end()) {
-                        auto &v = *it;
-                        if (idSet.count(v.id))
-                        {
-                            // record id appears once only, so remove from set
-                            idSet.erase(v.id);
-                            size_t recordSize = v.blob.size() + sizeof(v);
-                            m_size -= std::min(m_size, recordSize);
-                            it = records.erase(it);
-                            continue;
-                        }
-                        ++it;
-                    }
+                    eraseRecord(queue, it);
+                    continue;
                 }
+                ++it;
             }
         }
 
@@ -364,24 +388,19 @@ namespace MAT_NS_BEGIN {
 
         // Move back from reserved records to ram queue
         LOCKGUARD(m_reserved_lock);
-        if (m_reserved_records.size())
+        std::vector<StorageRecord> released;
+        for (auto const& id : ids)
         {
-            std::unordered_set<StorageRecordId> idSet(ids.begin(), ids.end());
-            auto it = m_reserved_records.begin();
-            while (it != m_reserved_records.end()) {
-                auto &kv = *it;
-                if (idSet.count(kv.first))
-                {
-                    if (incrementRetryCount)
-                        kv.second.retryCount++;
-                    StoreRecord(kv.second);
-                    idSet.erase(kv.first);
-                    it = m_reserved_records.erase(it);
-                    continue;
-                }
-                ++it;
+            auto it = m_reserved_records.find(id);
+            if (it != m_reserved_records.end())
+            {
+                if (incrementRetryCount)
+                    it->second.retryCount++;
+                released.push_back(std::move(it->second));
+                m_reserved_records.erase(it);
             }
         }
+        requeueRecords(released);
     }
 
     void MemoryStorage::ReleaseAllRecords()
@@ -391,13 +410,38 @@ namespace MAT_NS_BEGIN {
         LOCKGUARD(m_reserved_lock);
         if (m_reserved_records.size())
         {
-            auto it = m_reserved_records.begin();
-            while (it != m_reserved_records.end())
+            std::vector<StorageRecord> released;
+            released.reserve(m_reserved_records.size());
+            for (auto& kv : m_reserved_records)
             {
-                auto &kv = *it;
-                StoreRecord(kv.second);
-                it = m_reserved_records.erase(it);
+                released.push_back(std::move(kv.second));
             }
+            m_reserved_records.clear();
+            requeueRecords(released);
+        }
+    }
+
+    /// <summary>
+    /// Puts released records back into the RAM queues by timestamp, so that they
+    /// are read again before the records stored while they were in flight, and
+    /// are the first to go when records are shed.
+    /// </summary>
+    void MemoryStorage::requeueRecords(std::vector<StorageRecord>& records)
+    {
+        std::stable_sort(records.begin(), records.end(), [](StorageRecord const& a, StorageRecord const& b) {
+            return a.timestamp < b.timestamp;
+        });
+        for (auto& record : records)
+        {
+            if ((record.latency <= EventLatency_Off) || (record.latency > EventLatency_Max))
+                continue;
+
+            RecordQueue& queue = m_queues[record.latency];
+            LOCKGUARD(queue.lock);
+            auto position = std::upper_bound(queue.records.begin(), queue.records.end(), record.timestamp,
+                [](int64_t timestamp, StorageRecord const& queued) { return timestamp < queued.timestamp; });
+            m_size += GetRecordSize(record);
+            queue.records.insert(position, std::move(record));
         }
     }
 
@@ -446,14 +490,13 @@ namespace MAT_NS_BEGIN {
     /// Get size of the ram DB excluding reserved (in-flight) records.
     /// </summary>
     /// <returns>
-    /// Approximate ram queue size
+    /// Sum of GetRecordSize() of the records in the ram queue
     /// </returns>
     /// <remarks>
     /// Called from the internal worker thread.
     /// </remarks>
     size_t MemoryStorage::GetSize()
     {
-        LOCKGUARD(m_records_lock);
         return m_size;
     }
 
@@ -464,32 +507,67 @@ namespace MAT_NS_BEGIN {
     /// <returns></returns>
     size_t MemoryStorage::GetRecordCount(EventLatency latency) const
     {
-        LOCKGUARD(m_records_lock);
         size_t numRecords = 0;
         if (latency == EventLatency_Unspecified)
         {
             for (unsigned lat = EventLatency_Off; lat <= EventLatency_Max; lat++)
-                numRecords += m_records[lat].size();
+            {
+                LOCKGUARD(m_queues[lat].lock);
+                numRecords += m_queues[lat].records.size();
+            }
         }
-        else
+        else if ((latency >= EventLatency_Off) && (latency <= EventLatency_Max))
         {
-            numRecords = m_records[latency].size();
+            LOCKGUARD(m_queues[latency].lock);
+            numRecords = m_queues[latency].records.size();
         }
         return numRecords;
     }
 
+    /// <summary>
+    /// Takes records out of the ram queue, in the same order as
+    /// GetAndReserveRecords() without a lease.
+    /// </summary>
+    /// <remarks>
+    /// Used by OfflineStorageHandler to flush the ram queue to disk. When all
+    /// records are wanted, each latency queue is swapped with an empty one
+    /// and drained after its lock is released, so StoreRecord() callers do
+    /// not wait for the records to be moved.
+    /// </remarks>
     std::vector<StorageRecord> MemoryStorage::GetRecords(bool shutdown, EventLatency minLatency, unsigned maxCount)
     {
         UNREFERENCED_PARAMETER(shutdown);
-        UNREFERENCED_PARAMETER(minLatency);
-        UNREFERENCED_PARAMETER(maxCount);
 
         std::vector<StorageRecord> records;
-        auto consumer = [&records](StorageRecord&& record) -> bool {
-            records.push_back(std::move(record));
-            return true; // want more
-        };
-        GetAndReserveRecords(consumer, 0, minLatency, maxCount);
+        if (maxCount != 0)
+        {
+            auto consumer = [&records](StorageRecord&& record) -> bool {
+                records.push_back(std::move(record));
+                return true; // want more
+            };
+            GetAndReserveRecords(consumer, 0, minLatency, maxCount);
+            return records;
+        }
+
+        if (minLatency == EventLatency_Unspecified)
+            minLatency = EventLatency_Off;
+
+        for (int latency = static_cast<int>(EventLatency_Max); latency >= static_cast<int>(minLatency); latency--)
+        {
+            std::deque<StorageRecord> taken;
+            {
+                RecordQueue& queue = m_queues[latency];
+                LOCKGUARD(queue.lock);
+                taken.swap(queue.records);
+            }
+            records.reserve(records.size() + taken.size());
+            for (auto& record : taken)
+            {
+                m_size -= GetRecordSize(record);
+                records.push_back(std::move(record));
+            }
+        }
+        m_lastReadCount = static_cast<unsigned>(records.size());
         return records;
     }
     
@@ -16,10 +16,13 @@
 #include "ILogManager.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace MAT_NS_BEGIN {
@@ -75,28 +78,59 @@ namespace MAT_NS_BEGIN {
 
         virtual ~MemoryStorage() override;
 
+        /// <summary>
+        /// Bytes a record is accounted for, both when it is stored and when
+        /// it leaves the RAM queue.
+        /// </summary>
+        static size_t GetRecordSize(StorageRecord const& record);
+
+        /// <summary>
+        /// Evicts the oldest records waiting in the RAM queue, lowest latency
+        /// first, until at least the requested number of bytes is freed.
+        /// </summary>
+        /// <param name="bytes">Number of bytes to free</param>
+        /// <param name="maxLatency">Highest latency of the records to evict</param>
+        /// <param name="keepCritical">Whether Critical persistence records are kept</param>
+        /// <param name="shedByTenant">Counts of the evicted records per tenant token</param>
+        /// <returns>Number of bytes freed</returns>
+        size_t ShedRecords(size_t bytes, EventLatency maxLatency, bool keepCritical, std::map<std::string, size_t>& shedByTenant);
+
     protected:
-        
+
+        /// <summary>
+        /// RAM queue of one latency. Each latency has its own lock, so
+        /// storing events of one latency does not wait for the others, and a
+        /// flush only holds a lock for as long as it takes to swap a queue.
+        /// </summary>
+        struct RecordQueue
+        {
+            mutable std::mutex          lock;
+            std::deque<StorageRecord>   records;
+        };
+
+        void eraseRecord(RecordQueue& queue, std::deque<StorageRecord>::iterator& it);
+
+        void requeueRecords(std::vector<StorageRecord>& records);
+
         IOfflineStorageObserver*    m_observer;
         IRuntimeConfig&             m_config;
         ILogManager&                m_logManager;
 
-        mutable std::mutex          m_records_lock;
-        std::vector<StorageRecord>  m_records[EventLatency_Max+1];
-        
+        RecordQueue                 m_queues[EventLatency_Max+1];
+
         /// <summary>
         /// Contains reserved (aka in-flight) records.
         /// Current storage interface API requires deletion and release by StorageRecordId.
         /// </summary>
         std::mutex                  m_reserved_lock;
-        std::map<StorageRecordId, StorageRecord> m_reserved_records;
+        std::unordered_map<StorageRecordId, StorageRecord> m_reserved_records;
 
-        size_t                      m_size;
+        std::atomic<size_t>         m_size;
 
         MATSDK_LOG_DECL_COMPONENT_CLASS();
 
     private:
-        size_t                      m_lastReadCount;
+        std::atomic<unsigned>       m_lastReadCount;
 
     };
 
@@ -14,6 +14,7 @@
 #else
 #include "offline/OfflineStorage_SQLite.hpp"
 #endif
+#include "offline/OfflineStorage_SegmentLog.hpp"
 
 #include <memory>
 
@@ -27,6 +28,17 @@ namespace MAT_NS_BEGIN
             LOG_TRACE("Creating OfflineStorage from module");
             return std::static_pointer_cast<IOfflineStorage>(std::static_pointer_cast<IOfflineStorageModule>(module));
         }
+        const char* engine = runtimeConfig[CFG_STR_CACHE_STORAGE_ENGINE];
+        if ((engine != nullptr) && (std::string(engine) == "SegmentLog"))
+        {
+            const char* cacheFilePath = runtimeConfig[CFG_STR_CACHE_FILE_PATH];
+            if ((cacheFilePath != nullptr) && (std::string(cacheFilePath) != ":memory:"))
+            {
+                LOG_TRACE("Creating OfflineStorage_SegmentLog");
+                return std::make_shared<OfflineStorage_SegmentLog>(logManager, runtimeConfig);
+            }
+            LOG_WARN("SegmentLog storage needs a cache file path, falling back to the default storage");
+        }
 #ifdef USE_ROOM
         LOG_TRACE("Creating OfflineStorage_Room");
         return std::make_shared<OfflineStorage_Room>(logManager, runtimeConfig);
@@ -26,6 +26,7 @@ namespace MAT_NS_BEGIN {
         m_killSwitchManager(),
         m_clockSkewManager(),
         m_flushPending(false),
+        m_flushGeneration(0),
         m_offlineStorageMemory(nullptr),
         m_offlineStorageDisk(nullptr),
         m_readFromMemory(false),
@@ -33,7 +34,8 @@ namespace MAT_NS_BEGIN {
         m_shutdownStarted(false),
         m_memoryDbSize(0),
         m_queryDbSize(0),
-        m_isStorageFullNotificationSend(false)
+        m_isStorageFullNotificationSend(false),
+        m_ingestionPolicy(IngestionPolicy_DropNewest)
     {
         // TODO: [MG] - OfflineStorage_SQLite.cpp is performing similar checks
         uint32_t percentage = m_config[CFG_INT_RAMCACHE_FULL_PCT];
@@ -47,6 +49,32 @@ namespace MAT_NS_BEGIN {
             // In case if user has specified bad percentage, we stick to 75%
             m_memoryDbSizeNotificationLimit = (DB_FULL_NOTIFICATION_DEFAULT_PERCENTAGE * cacheMemorySizeLimitInBytes) / 100;
         }
+
+        uint32_t ingestionLimitInBytes = m_config[CFG_INT_INGESTION_LIMIT];
+        uint32_t ingestionBlockTimeMs = m_config[CFG_INT_INGESTION_BLOCK_TIME];
+        m_ingestionLimit = ingestionLimitInBytes;
+        m_ingestionBlockTimeMs = ingestionBlockTimeMs;
+        const char* ingestionPolicy = m_config[CFG_STR_INGESTION_POLICY];
+        if (ingestionPolicy != nullptr)
+        {
+            std::string policy(ingestionPolicy);
+            if (policy == "Block")
+            {
+                m_ingestionPolicy = IngestionPolicy_Block;
+            }
+            else if (policy == "DropOldest")
+            {
+                m_ingestionPolicy = IngestionPolicy_DropOldest;
+            }
+            else if (policy == "DropByPersistence")
+            {
+                m_ingestionPolicy = IngestionPolicy_DropByPersistence;
+            }
+            else if (policy != "DropNewest")
+            {
+                LOG_WARN("Unknown ingestion policy \"%s\", using DropNewest", ingestionPolicy);
+            }
+        }
     }
 
     bool OfflineStorageHandler::isKilled(StorageRecord const& record)
@@ -67,6 +95,21 @@ namespace MAT_NS_BEGIN {
         m_flushComplete.wait();
     }
 
+    void OfflineStorageHandler::ScheduleFlush()
+    {
+        if (m_flushLock.try_lock())
+        {
+            if (!m_flushPending)
+            {
+                m_flushPending = true;
+                m_flushComplete.Reset();
+                m_flushHandle = PAL::scheduleTask(&m_taskDispatcher, 0, this, &OfflineStorageHandler::Flush);
+                LOG_INFO("Requested Flush (%p)", m_flushHandle.m_task);
+            }
+            m_flushLock.unlock();
+        }
+    }
+
     OfflineStorageHandler::~OfflineStorageHandler()
     {
         WaitForFlush();
@@ -161,21 +204,14 @@ namespace MAT_NS_BEGIN {
         size_t dbSizeBeforeFlush = m_offlineStorageMemory->GetSize();
         if ((m_offlineStorageMemory) && (dbSizeBeforeFlush > 0) && (m_offlineStorageDisk))
         {
-            // This will block on and then take a lock for the duration of this move, and
-            // StoreRecord() will then block until the move completes.
+            // The ram queue of each latency is swapped out under its lock, so
+            // StoreRecord() only waits for the swap, not for the move to disk.
             auto records = m_offlineStorageMemory->GetRecords(false, EventLatency_Unspecified);
             std::vector<StorageRecordId> ids;
 
-            // TODO: [MG] - consider running the batch in transaction
-            //            if (sqlite)
-            //                sqlite->Execute("BEGIN");
-
+            // Persistent storage commits the whole batch in a single transaction
             size_t totalSaved = m_offlineStorageDisk->StoreRecords(records);
 
-            // TODO: [MG] - consider running the batch in transaction
-            //            if (sqlite)
-            //                sqlite->Execute("END");
-
             // Delete records from reserved on flush
             HttpHeaders dummy;
             bool fromMemory = true;
@@ -196,6 +232,11 @@ namespace MAT_NS_BEGIN {
         m_isStorageFullNotificationSend = false;
 
         // Flush is done, notify the waiters
+        {
+            LOCKGUARD(m_flushGenerationLock);
+            m_flushGeneration++;
+        }
+        m_flushDone.notify_all();
         m_flushComplete.post();
         m_flushPending = false;
     }
@@ -217,27 +258,15 @@ namespace MAT_NS_BEGIN {
         {
             auto memDbSize = m_offlineStorageMemory->GetSize();
             {
-                // During flush, this will block on a mutex while records
-                // are selected and removed from the cache (but will
-                // not block for the subsequent handoff to persistent
-                // storage)
+                // During flush, this only blocks while the ram queue of
+                // the record's latency is being swapped out
                 m_offlineStorageMemory->StoreRecord(record);
             }
 
             // Perform periodic flush to disk
             if (memDbSize > cacheMemorySizeLimitInBytes)
             {
-                if (m_flushLock.try_lock())
-                {
-                    if (!m_flushPending)
-                    {
-                        m_flushPending = true;
-                        m_flushComplete.Reset();
-                        m_flushHandle = PAL::scheduleTask(&m_taskDispatcher, 0, this, &OfflineStorageHandler::Flush);
-                        LOG_INFO("Requested Flush (%p)", m_flushHandle.m_task);
-                    }
-                    m_flushLock.unlock();
-                }
+                ScheduleFlush();
             }
         }
         else
@@ -254,6 +283,105 @@ namespace MAT_NS_BEGIN {
         return true;
     }
 
+    /// <summary>
+    /// Waits up to the ingestion block time for flushes to make room in the RAM queue
+    /// </summary>
+    /// <remarks>
+    /// m_flushComplete stays signalled after a direct Flush() or when a running
+    /// flush makes ScheduleFlush() skip its reset, so the wait is on the flush
+    /// generation instead: only a flush that ends after this call counts.
+    /// </remarks>
+    void OfflineStorageHandler::WaitForFlushedSpace()
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_ingestionBlockTimeMs);
+        while (m_offlineStorageMemory->GetSize() >= m_ingestionLimit)
+        {
+            uint64_t generation;
+            {
+                LOCKGUARD(m_flushGenerationLock);
+                generation = m_flushGeneration;
+            }
+            ScheduleFlush();
+
+            std::unique_lock<std::mutex> lock(m_flushGenerationLock);
+            if (!m_flushDone.wait_until(lock, deadline, [this, generation]() { return m_flushGeneration != generation; }))
+            {
+                break;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Applies the ingestion policy to an event before it is serialized
+    /// </summary>
+    /// <remarks>
+    /// Called from the thread logging the event. Only the RAM queue is
+    /// bounded: its size is checked before the event is added, so each
+    /// producer can take it over the limit by one event at most.
+    /// </remarks>
+    status_t OfflineStorageHandler::AdmitRecord(std::string const& tenantToken, EventLatency latency, EventPersistence persistence, bool mayBlock)
+    {
+        if ((m_ingestionLimit == 0) || (nullptr == m_offlineStorageMemory) || m_shutdownStarted)
+        {
+            return STATUS_SUCCESS;
+        }
+
+        size_t memDbSize = m_offlineStorageMemory->GetSize();
+        if (memDbSize < m_ingestionLimit)
+        {
+            return STATUS_SUCCESS;
+        }
+
+        // The limit is above the flush threshold, so a flush is due anyway
+        ScheduleFlush();
+
+        if (latency == EventLatency_Unspecified)
+        {
+            latency = EventLatency_Normal;
+        }
+        latency = std::min(latency, EventLatency_Max);
+
+        std::map<std::string, size_t> shedRecords;
+        switch (m_ingestionPolicy)
+        {
+        case IngestionPolicy_Block:
+            // TryLogEvent never waits, the event is shed as with DropNewest
+            if (mayBlock)
+            {
+                WaitForFlushedSpace();
+            }
+            break;
+
+        case IngestionPolicy_DropOldest:
+            m_offlineStorageMemory->ShedRecords(memDbSize - m_ingestionLimit + 1, latency, false, shedRecords);
+            break;
+
+        case IngestionPolicy_DropByPersistence:
+            if (persistence == EventPersistence_Critical)
+            {
+                m_offlineStorageMemory->ShedRecords(memDbSize - m_ingestionLimit + 1, EventLatency_Max, true, shedRecords);
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        if (!shedRecords.empty())
+        {
+            OnStorageRecordsShed(shedRecords);
+        }
+        if (m_offlineStorageMemory->GetSize() < m_ingestionLimit)
+        {
+            return STATUS_SUCCESS;
+        }
+
+        LOG_INFO("Event of tenant %s shed: %u bytes queued at the ingestion limit",
+                 tenantTokenToId(tenantToken).c_str(), static_cast<unsigned>(memDbSize));
+        OnStorageRecordsShed({ { tenantToken, 1 } });
+        return STATUS_EBUSY;
+    }
+
     size_t OfflineStorageHandler::StoreRecords(std::vector<StorageRecord>& records)
     {
         size_t stored = 0;
@@ -366,7 +494,7 @@ namespace MAT_NS_BEGIN {
 
     void OfflineStorageHandler::DeleteAllRecords() 
     {
-        for (const auto storagePtr : { m_offlineStorageMemory.get() , m_offlineStorageDisk.get() })
+        for (const auto storagePtr : { static_cast<IOfflineStorage*>(m_offlineStorageMemory.get()), m_offlineStorageDisk.get() })
         {
             if (storagePtr != nullptr)
             {
@@ -389,7 +517,7 @@ namespace MAT_NS_BEGIN {
     /// </remarks>
     void OfflineStorageHandler::DeleteRecords(const std::map<std::string, std::string>& whereFilter)
     {
-        for (const auto storagePtr : {m_offlineStorageMemory.get(), m_offlineStorageDisk.get()})
+        for (const auto storagePtr : { static_cast<IOfflineStorage*>(m_offlineStorageMemory.get()), m_offlineStorageDisk.get() })
         {
             if (storagePtr != nullptr)
             {
@@ -525,6 +653,11 @@ namespace MAT_NS_BEGIN {
         m_observer->OnStorageRecordsRejected(numRecords);
     }
 
+    void OfflineStorageHandler::OnStorageRecordsShed(std::map<std::string, size_t> const& numRecords)
+    {
+        m_observer->OnStorageRecordsShed(numRecords);
+    }
+
     void OfflineStorageHandler::OnStorageRecordsSaved(size_t numRecords)
     {
         m_observer->OnStorageRecordsSaved(numRecords);
@@ -15,14 +15,32 @@
 
 #include <memory>
 #include <atomic>
+#include <condition_variable>
 #include <list>
 #include <string>
 
 #include "KillSwitchManager.hpp"
 #include "ClockSkewManager.hpp"
+#include "MemoryStorage.hpp"
 
 namespace MAT_NS_BEGIN {
 
+    /// <summary>
+    /// What happens to an event logged while the RAM queue is at the
+    /// ingestion limit, see CFG_STR_INGESTION_POLICY.
+    /// </summary>
+    enum IngestionPolicy
+    {
+        /// Wait for a flush to disk, then shed the event if still at the limit
+        IngestionPolicy_Block,
+        /// Shed the event
+        IngestionPolicy_DropNewest,
+        /// Evict the oldest queued events of the lowest latencies, up to the latency of the event
+        IngestionPolicy_DropOldest,
+        /// Shed Normal persistence events, evict queued ones to admit Critical events
+        IngestionPolicy_DropByPersistence
+    };
+
     class OfflineStorageHandler : public IOfflineStorage, public IOfflineStorageObserver
     {
     public:
@@ -33,6 +51,16 @@ namespace MAT_NS_BEGIN {
         virtual void Flush() override;
         virtual bool StoreRecord(StorageRecord const& record) override;
         virtual size_t StoreRecords(std::vector<StorageRecord> & records) override;
+
+        /// <summary>
+        /// Applies the ingestion policy to an event about to be serialized.
+        /// </summary>
+        /// <param name="tenantToken">Tenant token of the event</param>
+        /// <param name="latency">Latency of the event</param>
+        /// <param name="persistence">Persistence of the event</param>
+        /// <param name="mayBlock">Whether the Block policy may wait for a flush</param>
+        /// <returns>STATUS_SUCCESS, or STATUS_EBUSY if the event is shed</returns>
+        virtual status_t AdmitRecord(std::string const& tenantToken, EventLatency latency, EventPersistence persistence, bool mayBlock);
         virtual bool GetAndReserveRecords(std::function<bool(StorageRecord&&)> const& consumer, unsigned leaseTimeMs, EventLatency minLatency = EventLatency_Unspecified, unsigned maxCount = 0) override;
 
         virtual bool IsLastReadFromMemory() override;
@@ -60,6 +88,7 @@ namespace MAT_NS_BEGIN {
         virtual void OnStorageRecordsDropped(std::map<std::string, size_t> const& numRecords) override;
         virtual void OnStorageRecordsRejected(std::map<std::string, size_t> const& numRecords) override;
         virtual void OnStorageRecordsSaved(size_t numRecords) override;
+        virtual void OnStorageRecordsShed(std::map<std::string, size_t> const& numRecords) override;
 
     protected:
         virtual void DeleteRecordsByKeys(const std::list<std::string> & keys);
@@ -80,7 +109,13 @@ namespace MAT_NS_BEGIN {
         PAL::DeferredCallbackHandle            m_flushHandle;
         PAL::Event                             m_flushComplete;
 
-        std::unique_ptr<IOfflineStorage>       m_offlineStorageMemory;
+        // Counts the completed flushes, so that a blocked producer only
+        // wakes up for a flush that ends after it started waiting.
+        std::mutex                             m_flushGenerationLock;
+        std::condition_variable                m_flushDone;
+        uint64_t                               m_flushGeneration;
+
+        std::unique_ptr<MemoryStorage>         m_offlineStorageMemory;
         std::shared_ptr<IOfflineStorage>       m_offlineStorageDisk;
 
         bool                                   m_readFromMemory;
@@ -92,11 +127,17 @@ namespace MAT_NS_BEGIN {
         unsigned                               m_queryDbSize;
         bool                                   m_isStorageFullNotificationSend;
 
+        size_t                                 m_ingestionLimit;
+        IngestionPolicy                        m_ingestionPolicy;
+        unsigned                               m_ingestionBlockTimeMs;
+
     protected:
         MATSDK_LOG_DECL_COMPONENT_CLASS();
 
     private:
         void WaitForFlush();
+        void ScheduleFlush();
+        void WaitForFlushedSpace();
 
     };
 
@@ -9,14 +9,14 @@
 #include "ILogManager.hpp"
 #include "SQLiteWrapper.hpp"
 #include "utils/StringUtils.hpp"
+#include "utils/ZlibUtils.hpp"
 #include <algorithm>
+#include <cstdlib>
 #include <numeric>
 #include <set>
 
 namespace MAT_NS_BEGIN {
 
-    constexpr static size_t kBlockSize = 8192;
-
     class DbTransaction {
         SqliteDB* m_db;
     public:
@@ -41,11 +41,15 @@ namespace MAT_NS_BEGIN {
 
     MATSDK_LOG_INST_COMPONENT_CLASS(OfflineStorage_SQLite, "EventsSDK.Storage", "Events telemetry client - OfflineStorage_SQLite class");
 
-    static int const CURRENT_SCHEMA_VERSION = 1;
+    static int const CURRENT_SCHEMA_VERSION = 2;
 #define TABLE_NAME_EVENTS   "events"
+#define TABLE_NAME_TENANTS  "tenants"
 #define TABLE_NAME_SETTINGS "settings"
 #define TABLE_NAME_PACKAGES "packages"
 
+    // Stored size of a record besides its payload: rowid and tenant id
+    constexpr static size_t kRecordOverhead = 2 * sizeof(int64_t);
+
     bool OfflineStorage_SQLite::isOpen()
     {
         if ((!m_db) || (!m_isOpened))
@@ -76,6 +80,8 @@ namespace MAT_NS_BEGIN {
         uint32_t ramSizeLimit = m_config[CFG_INT_RAM_QUEUE_SIZE];
         m_DbSizeHeapLimit = ramSizeLimit;
 
+        m_compressRecords = m_config[CFG_BOOL_ENABLE_DB_COMPRESS];
+
         const char* skipSqliteInit = m_config["skipSqliteInitAndShutdown"];
         if (skipSqliteInit != nullptr)
         {
@@ -136,17 +142,102 @@ namespace MAT_NS_BEGIN {
             m_db->execute(command.c_str());
     }
 
-    bool OfflineStorage_SQLite::StoreRecord(StorageRecord const& record)
+    bool OfflineStorage_SQLite::isValidRecord(StorageRecord const& record)
     {
-        // TODO: [MG] - this works, but may not play nicely with several LogManager instances
-        // static SqliteStatement sql_insert(*m_db, m_stmtInsertEvent_id_tenant_prio_ts_data);
-
         if (record.id.empty() || record.tenantToken.empty() || static_cast<int>(record.latency) < 0 || record.timestamp <= 0) {
             LOG_ERROR("Failed to store event %s:%s: Invalid parameters",
                 tenantTokenToId(record.tenantToken).c_str(), record.id.c_str());
             m_observer->OnStorageFailed("Invalid parameters");
             return false;
         }
+        return true;
+    }
+
+    int64_t OfflineStorage_SQLite::getTenantIdUnsafe(std::string const& tenantToken)
+    {
+        auto it = m_tenantIds.find(tenantToken);
+        if (it != m_tenantIds.end())
+        {
+            return it->second;
+        }
+
+        int64_t tenantId = 0;
+        if (!SqliteStatement(*m_db, m_stmtInsertTenant_token).execute(tenantToken))
+        {
+            return 0;
+        }
+        SqliteStatement stmt(*m_db, m_stmtSelectTenant_token);
+        if (!stmt.select(tenantToken) || !stmt.getOneValue(tenantId))
+        {
+            return 0;
+        }
+        stmt.reset();
+
+        m_tenantIds[tenantToken] = tenantId;
+        return tenantId;
+    }
+
+    bool OfflineStorage_SQLite::insertRecordUnsafe(StorageRecord const& record)
+    {
+        // The record id is not stored: the row gets a new rowid, which is
+        // what GetAndReserveRecords() hands out as the id of the record. So
+        // storing an id twice keeps two rows, see IOfflineStorage::StoreRecord.
+        int64_t tenantId = getTenantIdUnsafe(record.tenantToken);
+        if (tenantId == 0)
+        {
+            LOG_ERROR("Failed to store event %s:%s: Cannot add tenant",
+                tenantTokenToId(record.tenantToken).c_str(), record.id.c_str());
+            return false;
+        }
+
+        if (m_compressRecords)
+        {
+            // Keep the compressed form only when it is actually smaller
+            std::vector<uint8_t> compressed;
+            if (ZlibUtils::DeflateZlibVector(record.blob, compressed) && compressed.size() < record.blob.size())
+            {
+                if (!SqliteStatement(*m_db, m_stmtInsertEvent_tenant_prio_ts_data).execute(tenantId, static_cast<int>(record.latency), static_cast<int>(record.persistence), record.timestamp, compressed))
+                {
+                    return false;
+                }
+                m_DbSizeEstimate += kRecordOverhead + compressed.size();
+                return true;
+            }
+        }
+
+        if (!SqliteStatement(*m_db, m_stmtInsertEvent_tenant_prio_ts_data).execute(tenantId, static_cast<int>(record.latency), static_cast<int>(record.persistence), record.timestamp, record.blob))
+        {
+            return false;
+        }
+        m_DbSizeEstimate += kRecordOverhead + record.blob.size();
+        return true;
+    }
+
+    void OfflineStorage_SQLite::restoreRecordBlob(std::vector<uint8_t>& blob)
+    {
+        // Serialized records start with a Bond field header and never with a
+        // zlib header, so stored records are recognized regardless of the
+        // current setting. Anything that does not inflate is returned as is.
+        if (!ZlibUtils::IsZlibStream(blob))
+        {
+            return;
+        }
+
+        std::vector<uint8_t> inflated;
+        if (ZlibUtils::InflateZlibVector(blob, inflated))
+        {
+            blob.swap(inflated);
+        }
+    }
+
+    bool OfflineStorage_SQLite::StoreRecord(StorageRecord const& record)
+    {
+        // TODO: [MG] - this works, but may not play nicely with several LogManager instances
+        // static SqliteStatement sql_insert(*m_db, m_stmtInsertEvent_id_tenant_prio_ts_data);
+
+        if (!isValidRecord(record)) {
+            return false;
+        }
 
         if (!m_db) {
             LOG_ERROR("Failed to store event %s:%s: Database is not open",
@@ -166,10 +257,19 @@ namespace MAT_NS_BEGIN {
                 return false;
             }
 #endif
-            SqliteStatement(*m_db, m_stmtInsertEvent_id_tenant_prio_ts_data).execute(record.id, record.tenantToken, static_cast<int>(record.latency), static_cast<int>(record.persistence), record.timestamp, record.blob);
-            m_DbSizeEstimate += record.id.size() + record.tenantToken.size() + record.blob.size();
+            if (!insertRecordUnsafe(record))
+            {
+                m_observer->OnStorageFailed("Database error");
+                return false;
+            }
         }
 
+        checkDbSize();
+        return true;
+    }
+
+    void OfflineStorage_SQLite::checkDbSize()
+    {
         if ((m_DbSizeNotificationLimit != 0) && (m_DbSizeEstimate>m_DbSizeNotificationLimit))
         {
             auto now = PAL::getMonotonicTimeMs();
@@ -199,19 +299,43 @@ namespace MAT_NS_BEGIN {
                 m_resizing = false;
             }
         }
-
-        return true;
-
     }
 
     size_t OfflineStorage_SQLite::StoreRecords(std::vector<StorageRecord> & records)
     {
+        if (records.empty()) {
+            return 0;
+        }
+
+        if (!m_db) {
+            LOG_ERROR("Failed to store %zu events: Database is not open", records.size());
+            m_observer->OnStorageOpenFailed("Database is not open");
+            return 0;
+        }
+
+        // Insert the whole batch in a single transaction: one journal commit
+        // per flush rather than one per record. The size check, which may
+        // need to trim or VACUUM the database, runs after the commit.
         size_t stored = 0;
-        for (auto & i : records) {
-            if (StoreRecord(i)) {
-                ++stored;
+        {
+            LOCKGUARD(m_lock);
+#ifdef ENABLE_LOCKING
+            DbTransaction transaction(m_db.get());
+            if (!transaction.locked)
+            {
+                LOG_ERROR("Failed to store %zu events: Database error", records.size());
+                m_observer->OnStorageFailed("Database error");
+                return 0;
+            }
+#endif
+            for (auto & record : records) {
+                if (isValidRecord(record) && insertRecordUnsafe(record)) {
+                    ++stored;
+                }
             }
         }
+
+        checkDbSize();
         return stored;
     }
 
@@ -284,6 +408,7 @@ namespace MAT_NS_BEGIN {
 
             while (selectStmt.getRow(record.id, record.tenantToken, latency, record.timestamp, record.retryCount, record.reservedUntil, record.blob))
             {
+                restoreRecordBlob(record.blob);
                 if (latency < EventLatency_Off || latency > EventLatency_Max) {
                     record.latency = EventLatency_Normal;
                 }
@@ -313,11 +438,11 @@ namespace MAT_NS_BEGIN {
             LOG_TRACE("Reserving %u event(s) {%s%s} for %u milliseconds",
                 static_cast<unsigned>(consumedIds.size()), consumedIds.front().c_str(), (consumedIds.size() > 1) ? ", ..." : "", leaseTimeMs);
 
-            for (size_t i = 0; i < consumedIds.size(); i += kBlockSize)
+            int64_t reservedUntil = PAL::getUtcSystemTimeMs() + leaseTimeMs;
+            SqliteStatement reserveStmt(*m_db, m_stmtReserveEvents);
+            for (auto const& range : packageIdRanges(consumedIds))
             {
-                auto count = std::min(kBlockSize, consumedIds.size() - i);
-                std::vector<uint8_t> idList = packageIdList(consumedIds.begin() + i, consumedIds.begin() + i + count);
-                if (!SqliteStatement(*m_db, m_stmtReserveEvents).execute(idList, PAL::getUtcSystemTimeMs() + leaseTimeMs))
+                if (!reserveStmt.execute(reservedUntil, range.first, range.second))
                 {
                     LOG_ERROR("Failed to reserve events to send: Database error occurred, recreating database");
                     recreate(207);
@@ -356,6 +481,7 @@ namespace MAT_NS_BEGIN {
                 int latency;
                 while (selectStmt.getRow(record.id, record.tenantToken, latency, record.timestamp, record.retryCount, record.reservedUntil, record.blob))
                 {
+                    restoreRecordBlob(record.blob);
                     record.latency = static_cast<EventLatency>(latency);
                     records.push_back(record);
                 }
@@ -370,6 +496,7 @@ namespace MAT_NS_BEGIN {
                 int latency;
                 while (selectStmt.getRow(record.id, record.tenantToken, latency, record.timestamp, record.retryCount, record.reservedUntil, record.blob))
                 {
+                    restoreRecordBlob(record.blob);
                     record.latency = static_cast<EventLatency>(latency);
                     records.push_back(record);
                 }
@@ -408,13 +535,22 @@ namespace MAT_NS_BEGIN {
                 std::string clause;
                 for (const auto &kv : whereFilter)
                 {
+                    if (!clause.empty())
+                    {
+                        clause += " AND ";
+                    }
+                    if (kv.first == "tenant_token")
+                    {
+                        // Tenant tokens are kept in the tenants dictionary
+                        clause += "tenant_id IN (SELECT tenant_id FROM " TABLE_NAME_TENANTS " WHERE tenant_token='" + kv.second + "')";
+                        continue;
+                    }
                     bool quotes = false;
-                    if ((kv.first == "record_id") ||
-                        (kv.first == "tenant_token"))
+                    if (kv.first == "record_id")
                     {
-                        // string types
+                        // string type, compared with the integer rowid
                         quotes = true;
-                    } 
+                    }
                     else if (
                         // integer types
                         (kv.first == "latency") ||
@@ -423,14 +559,10 @@ namespace MAT_NS_BEGIN {
                     {
                         quotes = false;
                     }
-                    if (!clause.empty())
-                    {
-                        clause += " AND ";
-                    }
                     clause += kv.first;
                     clause += "=";
                     clause += (quotes) ?
-                        ("\"" + kv.second + "\"") :
+                        ("'" + kv.second + "'") :
                         kv.second;
                 }
                 return clause;
@@ -468,11 +600,9 @@ namespace MAT_NS_BEGIN {
 #endif
             LOG_TRACE("Deleting %u sent event(s) {%s%s}...", static_cast<unsigned>(ids.size()), ids.front().c_str(), (ids.size() > 1) ? ", ..." : "");
 
-            for (size_t i = 0; i < ids.size(); i += kBlockSize) {
-                size_t count = std::min(kBlockSize, ids.size() - i);
-                std::vector<uint8_t> idList = packageIdList(ids.begin() + i,
-                                                            ids.begin() + i + count);
-                if (!SqliteStatement(*m_db, m_stmtDeleteEvents_ids).execute(idList)) {
+            SqliteStatement deleteStmt(*m_db, m_stmtDeleteEvents_idRange);
+            for (auto const& range : packageIdRanges(ids)) {
+                if (!deleteStmt.execute(range.first, range.second)) {
                     LOG_ERROR(
                             "Failed to delete %u sent event(s) {%s%s}: Database error occurred, recreating database",
                             static_cast<unsigned>(ids.size()), ids.front().c_str(),
@@ -511,11 +641,10 @@ namespace MAT_NS_BEGIN {
             LOG_TRACE("Releasing %u event(s) {%s%s}, retry count %s...",
                 static_cast<unsigned>(ids.size()), ids.front().c_str(), (ids.size() > 1) ? ", ..." : "", incrementRetryCount ? "+1" : "not changed");
 
-            SqliteStatement releaseStmt(*m_db, m_stmtReleaseEvents_ids_retryCountDelta);
-            for (size_t i = 0; i < ids.size(); i += kBlockSize) {
-                size_t count = std::min(kBlockSize, ids.size() - i);
-                std::vector<uint8_t> idList = packageIdList(ids.begin() + i, ids.begin() + i + count);
-                if (!releaseStmt.execute(idList, incrementRetryCount ? 1 : 0)) {
+            SqliteStatement releaseStmt(*m_db, m_stmtReleaseEvents_idRange_retryCountDelta);
+            unsigned releasedCount = 0;
+            for (auto const& range : packageIdRanges(ids)) {
+                if (!releaseStmt.execute(incrementRetryCount ? 1 : 0, range.first, range.second)) {
                     LOG_ERROR(
                             "Failed to release %u event(s) {%s%s}, retry count %s: Database error occurred, recreating database",
                             static_cast<unsigned>(ids.size()), ids.front().c_str(),
@@ -524,9 +653,10 @@ namespace MAT_NS_BEGIN {
                     recreate(403);
                     return;
                 }
+                releasedCount += releaseStmt.changes();
             }
             LOG_TRACE("Successfully released %u requested event(s), %u were not found anymore",
-                releaseStmt.changes(), static_cast<unsigned>(ids.size()) - releaseStmt.changes());
+                releasedCount, static_cast<unsigned>(ids.size()) - releasedCount);
 
             if (incrementRetryCount)
             {
@@ -712,43 +842,21 @@ namespace MAT_NS_BEGIN {
                     openedDbVersion, CURRENT_SCHEMA_VERSION);
                 return false;
             }
-            if (!SqliteStatement(*m_db,
-                ("PRAGMA user_version=" + toString(CURRENT_SCHEMA_VERSION)).c_str()
-            ).execute()) {
-                return false;
-            }
-        }
-
-        if (!SqliteStatement(*m_db,
-            "CREATE TABLE IF NOT EXISTS " TABLE_NAME_EVENTS " ("
-            "record_id"      " TEXT,"
-            "tenant_token"   " TEXT NOT NULL,"
-            "latency"        " INTEGER,"
-            "persistence"    " INTEGER,"
-            "timestamp"      " INTEGER,"
-            "retry_count"    " INTEGER DEFAULT 0,"
-            "reserved_until" " INTEGER DEFAULT 0,"
-            "payload"        " BLOB"
-            ")"
-        ).execute()) {
-            return false;
         }
 
-        if (!SqliteStatement(*m_db,
-            "CREATE INDEX IF NOT EXISTS k_latency_timestamp ON " TABLE_NAME_EVENTS
-            " (latency DESC, persistence DESC, timestamp ASC)"
-        ).execute()) {
-            return false;
-        }
-
-        if (!SqliteStatement(*m_db,
-            "CREATE TABLE IF NOT EXISTS " TABLE_NAME_SETTINGS " ("
-            "name"  " TEXT,"
-            "value" " TEXT,"
-            " PRIMARY KEY (name))"
-        ).execute()) {
-            return false;
+        {
+#ifdef ENABLE_LOCKING
+            DbTransaction transaction(m_db.get());
+            if (!transaction.locked)
+            {
+                return false;
+            }
+#endif
+            if (!createSchema(openedDbVersion)) {
+                return false;
+            }
         }
+        m_tenantIds.clear();
 
         {
             SqliteStatement stmt(*m_db, "PRAGMA page_size");
@@ -778,7 +886,8 @@ namespace MAT_NS_BEGIN {
             "SELECT count(*) FROM " TABLE_NAME_EVENTS " WHERE latency=?");
 
         PREPARE_SQL(m_stmtPerTenantTrimCount,
-            "SELECT tenant_token FROM " TABLE_NAME_EVENTS " ORDER BY persistence ASC, timestamp ASC LIMIT MAX(1,"
+            "SELECT tenant_token FROM " TABLE_NAME_EVENTS " CROSS JOIN " TABLE_NAME_TENANTS " USING (tenant_id)"
+            " ORDER BY persistence ASC, timestamp ASC LIMIT MAX(1,"
             "(SELECT COUNT(record_id) FROM " TABLE_NAME_EVENTS ")"
             "* ? / 100)");
         PREPARE_SQL(m_stmtTrimEvents_percent,
@@ -790,48 +899,50 @@ namespace MAT_NS_BEGIN {
 
         PREPARE_SQL(m_stmtDeleteEvents_tenants,
                 SQL_SUPPLY_PACKAGED_IDS
-                "DELETE FROM " TABLE_NAME_EVENTS " WHERE tenant_token IN ids");
-        PREPARE_SQL(m_stmtDeleteEvents_ids,
-            SQL_SUPPLY_PACKAGED_IDS
-            "DELETE FROM " TABLE_NAME_EVENTS " WHERE record_id IN ids");
+                "DELETE FROM " TABLE_NAME_EVENTS " WHERE tenant_id IN ("
+                "SELECT tenant_id FROM " TABLE_NAME_TENANTS " WHERE tenant_token IN ids)");
+        PREPARE_SQL(m_stmtDeleteEvents_idRange,
+            "DELETE FROM " TABLE_NAME_EVENTS " WHERE record_id BETWEEN ? AND ?");
         PREPARE_SQL(m_stmtReleaseExpiredEvents,
             "UPDATE " TABLE_NAME_EVENTS
             " SET reserved_until=0, retry_count=retry_count+1"
             " WHERE reserved_until<>0 AND reserved_until<=?");
         PREPARE_SQL(m_stmtSelectEvents,
             "SELECT record_id,tenant_token,latency,timestamp,retry_count,reserved_until,payload"
-            " FROM " TABLE_NAME_EVENTS
+            " FROM " TABLE_NAME_EVENTS " CROSS JOIN " TABLE_NAME_TENANTS " USING (tenant_id)"
             " WHERE latency>=? AND reserved_until=0"
             " ORDER BY latency DESC,persistence DESC, timestamp ASC LIMIT ?");
         PREPARE_SQL(m_stmtSelectEventAtShutdown,
             "SELECT record_id,tenant_token,latency,timestamp,retry_count,reserved_until,payload"
-            " FROM " TABLE_NAME_EVENTS
+            " FROM " TABLE_NAME_EVENTS " CROSS JOIN " TABLE_NAME_TENANTS " USING (tenant_id)"
             " WHERE latency>=?"
             " ORDER BY latency DESC,persistence DESC, timestamp ASC LIMIT ?");
         PREPARE_SQL(m_stmtSelectEventsMinlatency,
             "SELECT record_id,tenant_token,latency,timestamp,retry_count,reserved_until,payload"
-            " FROM " TABLE_NAME_EVENTS
+            " FROM " TABLE_NAME_EVENTS " CROSS JOIN " TABLE_NAME_TENANTS " USING (tenant_id)"
             " WHERE latency=(SELECT MIN(latency) FROM " TABLE_NAME_EVENTS " WHERE reserved_until=0 AND latency>=?) AND reserved_until=0"
             " ORDER BY timestamp ASC LIMIT ?");
 
         PREPARE_SQL(m_stmtReserveEvents,
-            SQL_SUPPLY_PACKAGED_IDS
             "UPDATE " TABLE_NAME_EVENTS
             " SET reserved_until=?"
-            " WHERE record_id IN ids");
-        PREPARE_SQL(m_stmtReleaseEvents_ids_retryCountDelta,
-            SQL_SUPPLY_PACKAGED_IDS
+            " WHERE record_id BETWEEN ? AND ?");
+        PREPARE_SQL(m_stmtReleaseEvents_idRange_retryCountDelta,
             "UPDATE " TABLE_NAME_EVENTS
             " SET reserved_until=0, retry_count=retry_count+?"
-            " WHERE record_id IN ids AND reserved_until>0");
+            " WHERE record_id BETWEEN ? AND ? AND reserved_until>0");
         PREPARE_SQL(m_stmtSelectEventsRetried_maxRetryCount,
-            "SELECT tenant_token FROM " TABLE_NAME_EVENTS
+            "SELECT tenant_token FROM " TABLE_NAME_EVENTS " CROSS JOIN " TABLE_NAME_TENANTS " USING (tenant_id)"
             " WHERE retry_count>?");
         PREPARE_SQL(m_stmtDeleteEventsRetried_maxRetryCount,
             "DELETE FROM " TABLE_NAME_EVENTS
             " WHERE retry_count>?");
-        PREPARE_SQL(m_stmtInsertEvent_id_tenant_prio_ts_data,
-            "REPLACE INTO " TABLE_NAME_EVENTS " (record_id,tenant_token,latency,persistence,timestamp,payload) VALUES (?,?,?,?,?,?)");
+        PREPARE_SQL(m_stmtInsertEvent_tenant_prio_ts_data,
+            "INSERT INTO " TABLE_NAME_EVENTS " (tenant_id,latency,persistence,timestamp,payload) VALUES (?,?,?,?,?)");
+        PREPARE_SQL(m_stmtInsertTenant_token,
+            "INSERT OR IGNORE INTO " TABLE_NAME_TENANTS " (tenant_token) VALUES (?)");
+        PREPARE_SQL(m_stmtSelectTenant_token,
+            "SELECT tenant_id FROM " TABLE_NAME_TENANTS " WHERE tenant_token=?");
         PREPARE_SQL(m_stmtInsertSetting_name_value,
             "REPLACE INTO " TABLE_NAME_SETTINGS " (name,value) VALUES (?,?)");
         PREPARE_SQL(m_stmtDeleteSetting_name,
@@ -849,6 +960,113 @@ namespace MAT_NS_BEGIN {
         return true;
 }
 
+    /// <summary>
+    /// Creates the schema, or upgrades the one of a database created by an
+    /// older SDK, and stamps it with the current version.
+    /// </summary>
+    /// <remarks>
+    /// Schema v2 keys events by their integer rowid and stores tenant tokens
+    /// once, in the tenants table. Record ids are AUTOINCREMENT so that the
+    /// id of a deleted record is never handed out again: a late or replayed
+    /// delete for it must not hit a newer record. Upgrading from v1 carries
+    /// the events over with new ids; reservations held by the previous
+    /// session are dropped.
+    /// </remarks>
+    bool OfflineStorage_SQLite::createSchema(int openedDbVersion)
+    {
+        if (!SqliteStatement(*m_db,
+            "CREATE TABLE IF NOT EXISTS " TABLE_NAME_TENANTS " ("
+            "tenant_id"      " INTEGER PRIMARY KEY,"
+            "tenant_token"   " TEXT NOT NULL UNIQUE"
+            ")"
+        ).execute()) {
+            return false;
+        }
+
+        bool upgradeV1 = (openedDbVersion == 1);
+        if (upgradeV1) {
+            // Its index goes along with the table and is dropped with it
+            if (!SqliteStatement(*m_db, "ALTER TABLE " TABLE_NAME_EVENTS " RENAME TO " TABLE_NAME_EVENTS "_v1").execute()) {
+                return false;
+            }
+        }
+
+        if (!SqliteStatement(*m_db,
+            "CREATE TABLE IF NOT EXISTS " TABLE_NAME_EVENTS " ("
+            "record_id"      " INTEGER PRIMARY KEY AUTOINCREMENT,"
+            "tenant_id"      " INTEGER NOT NULL,"
+            "latency"        " INTEGER,"
+            "persistence"    " INTEGER,"
+            "timestamp"      " INTEGER,"
+            "retry_count"    " INTEGER DEFAULT 0,"
+            "reserved_until" " INTEGER DEFAULT 0,"
+            "payload"        " BLOB"
+            ")"
+        ).execute()) {
+            return false;
+        }
+
+        if (upgradeV1) {
+            if (!SqliteStatement(*m_db,
+                "INSERT OR IGNORE INTO " TABLE_NAME_TENANTS " (tenant_token)"
+                " SELECT DISTINCT tenant_token FROM " TABLE_NAME_EVENTS "_v1"
+            ).execute() ||
+                !SqliteStatement(*m_db,
+                "INSERT INTO " TABLE_NAME_EVENTS " (tenant_id,latency,persistence,timestamp,retry_count,payload)"
+                " SELECT tenant_id,latency,persistence,timestamp,retry_count,payload"
+                " FROM " TABLE_NAME_EVENTS "_v1 JOIN " TABLE_NAME_TENANTS " USING (tenant_token)"
+                " ORDER BY timestamp ASC"
+            ).execute() ||
+                !SqliteStatement(*m_db, "DROP TABLE " TABLE_NAME_EVENTS "_v1").execute()) {
+                return false;
+            }
+        }
+        else {
+            // Tenants are never removed while the SDK runs, drop the unused ones here
+            if (!SqliteStatement(*m_db,
+                "DELETE FROM " TABLE_NAME_TENANTS
+                " WHERE tenant_id NOT IN (SELECT DISTINCT tenant_id FROM " TABLE_NAME_EVENTS ")"
+            ).execute()) {
+                return false;
+            }
+        }
+
+        // Covers the filter of the selection of events to send: only the
+        // rows that are actually returned are read from the table
+        if (!SqliteStatement(*m_db,
+            "CREATE INDEX IF NOT EXISTS k_latency_timestamp ON " TABLE_NAME_EVENTS
+            " (latency DESC, persistence DESC, timestamp ASC, reserved_until)"
+        ).execute()) {
+            return false;
+        }
+
+        // Expired reservations are looked up before every selection
+        if (!SqliteStatement(*m_db,
+            "CREATE INDEX IF NOT EXISTS k_reserved_until ON " TABLE_NAME_EVENTS
+            " (reserved_until) WHERE reserved_until<>0"
+        ).execute()) {
+            return false;
+        }
+
+        if (!SqliteStatement(*m_db,
+            "CREATE TABLE IF NOT EXISTS " TABLE_NAME_SETTINGS " ("
+            "name"  " TEXT,"
+            "value" " TEXT,"
+            " PRIMARY KEY (name))"
+        ).execute()) {
+            return false;
+        }
+
+        if (openedDbVersion != CURRENT_SCHEMA_VERSION) {
+            if (!SqliteStatement(*m_db,
+                ("PRAGMA user_version=" + toString(CURRENT_SCHEMA_VERSION)).c_str()
+            ).execute()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     size_t OfflineStorage_SQLite::GetSize()
     {
         if (!m_db) {
@@ -972,7 +1190,40 @@ namespace MAT_NS_BEGIN {
 
         return result;
     }
-    
+
+    std::vector<std::pair<int64_t, int64_t>> OfflineStorage_SQLite::packageIdRanges(std::vector<StorageRecordId> const& ids) const
+    {
+        std::vector<int64_t> rowIds;
+        rowIds.reserve(ids.size());
+        for (auto const& id : ids)
+        {
+            char* end = nullptr;
+            long long rowId = std::strtoll(id.c_str(), &end, 10);
+            if (id.empty() || *end != '\0')
+            {
+                // Not a rowid, so not an id this storage handed out
+                LOG_WARN("Ignoring invalid record id %s", id.c_str());
+                continue;
+            }
+            rowIds.push_back(static_cast<int64_t>(rowId));
+        }
+        std::sort(rowIds.begin(), rowIds.end());
+
+        std::vector<std::pair<int64_t, int64_t>> ranges;
+        for (int64_t rowId : rowIds)
+        {
+            if (!ranges.empty() && rowId <= ranges.back().second + 1)
+            {
+                ranges.back().second = std::max(ranges.back().second, rowId);
+            }
+            else
+            {
+                ranges.emplace_back(rowId, rowId);
+            }
+        }
+        return ranges;
+    }
+
 } MAT_NS_END
 #endif
 
@@ -16,6 +16,8 @@
 #include <memory>
 #include <atomic>
 #include <mutex>
+#include <unordered_map>
+#include <utility>
 
 #define ENABLE_LOCKING      // Enable DB locking for flush
 
@@ -54,12 +56,24 @@ namespace MAT_NS_BEGIN {
 
     protected:
         bool initializeDatabase();
+        bool createSchema(int openedDbVersion);
         bool recreate(unsigned failureCode);
 
+        bool isValidRecord(StorageRecord const& record);
+        bool insertRecordUnsafe(StorageRecord const& record);
+        int64_t getTenantIdUnsafe(std::string const& tenantToken);
+        void restoreRecordBlob(std::vector<uint8_t>& blob);
+        void checkDbSize();
+
         std::vector<uint8_t> packageIdList(
             std::vector<std::string>::const_iterator const & begin,
             std::vector<std::string>::const_iterator const & end) const;
 
+        /// Record ids are the decimal form of the events table rowid. Parses
+        /// them and folds runs of consecutive ids into [first, last] ranges,
+        /// so a package of events stored one after another is a single range.
+        std::vector<std::pair<int64_t, int64_t>> packageIdRanges(std::vector<StorageRecordId> const& ids) const;
+
         // Debug routine to print record count in the DB
         void printRecordCount();
 
@@ -88,17 +102,19 @@ namespace MAT_NS_BEGIN {
         size_t                      m_stmtGetRecordCountBylatency {};
         size_t                      m_stmtPerTenantTrimCount {};
         size_t                      m_stmtTrimEvents_percent {};
-        size_t                      m_stmtDeleteEvents_ids {};
+        size_t                      m_stmtDeleteEvents_idRange {};
         size_t                      m_stmtReleaseExpiredEvents {};
         size_t                      m_stmtDeleteEvents_tenants {};
         size_t                      m_stmtSelectEvents {};
         size_t                      m_stmtSelectEventAtShutdown {};
         size_t                      m_stmtSelectEventsMinlatency {};
         size_t                      m_stmtReserveEvents {};
-        size_t                      m_stmtReleaseEvents_ids_retryCountDelta {};
+        size_t                      m_stmtReleaseEvents_idRange_retryCountDelta {};
         size_t                      m_stmtDeleteEventsRetried_maxRetryCount {};
         size_t                      m_stmtSelectEventsRetried_maxRetryCount {};
-        size_t                      m_stmtInsertEvent_id_tenant_prio_ts_data {};
+        size_t                      m_stmtInsertEvent_tenant_prio_ts_data {};
+        size_t                      m_stmtInsertTenant_token {};
+        size_t                      m_stmtSelectTenant_token {};
         size_t                      m_stmtInsertSetting_name_value {};
         size_t                      m_stmtDeleteSetting_name {};
         size_t                      m_stmtSelectSetting_name {};
@@ -110,6 +126,8 @@ namespace MAT_NS_BEGIN {
         size_t                      m_DbSizeLimit {};
         std::atomic<size_t>         m_DbSizeEstimate {};
         uint64_t                    m_isStorageFullNotificationSendTime {};
+        bool                        m_compressRecords {};
+        std::unordered_map<std::string, int64_t> m_tenantIds;
 
     protected:
         MATSDK_LOG_DECL_COMPONENT_CLASS();
@@ -0,0 +1,1311 @@
+//
+// Copyright (c) 2015-2020 Microsoft Corporation and Contributors.
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "mat/config.h"
+#ifdef HAVE_MAT_STORAGE
+
+#include "OfflineStorage_SegmentLog.hpp"
+#include "ILogManager.hpp"
+#include "utils/FileUtils.hpp"
+#include "utils/StringUtils.hpp"
+#include "utils/Utils.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace MAT_NS_BEGIN {
+
+    /// <summary>
+    /// Read-write memory mapping of a whole segment file.
+    /// </summary>
+    class SegmentFile
+    {
+    public:
+        ~SegmentFile()
+        {
+            close();
+        }
+
+        /// <summary>
+        /// Map an existing file when <paramref name="capacity"/> is zero,
+        /// otherwise create (or truncate) the file with that size first.
+        /// </summary>
+        bool open(std::string const& path, size_t capacity)
+        {
+#ifdef _WIN32
+            std::wstring path_w = to_utf16_string(path);
+            m_file = ::CreateFileW(path_w.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                (capacity != 0) ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (m_file == INVALID_HANDLE_VALUE)
+            {
+                return false;
+            }
+            LARGE_INTEGER fileSize;
+            if (!::GetFileSizeEx(m_file, &fileSize))
+            {
+                close();
+                return false;
+            }
+            m_size = std::max(static_cast<size_t>(fileSize.QuadPart), capacity);
+            if (m_size == 0)
+            {
+                close();
+                return false;
+            }
+            // A mapping larger than the file extends the file
+            HANDLE mapping = ::CreateFileMappingW(m_file, NULL, PAGE_READWRITE,
+                static_cast<DWORD>(static_cast<uint64_t>(m_size) >> 32), static_cast<DWORD>(m_size & 0xFFFFFFFF), NULL);
+            if (mapping == NULL)
+            {
+                close();
+                return false;
+            }
+            m_data = static_cast<uint8_t*>(::MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, m_size));
+            ::CloseHandle(mapping);
+#else
+            int fd = ::open(path.c_str(), (capacity != 0) ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR, 0600);
+            if (fd < 0)
+            {
+                return false;
+            }
+            struct stat st;
+            if (::fstat(fd, &st) != 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            m_size = std::max(static_cast<size_t>(st.st_size), capacity);
+            if ((m_size == 0) || ((capacity > static_cast<size_t>(st.st_size)) && !allocate(fd, m_size)))
+            {
+                ::close(fd);
+                return false;
+            }
+            void* data = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            // The mapping keeps the file open
+            ::close(fd);
+            m_data = (data != MAP_FAILED) ? static_cast<uint8_t*>(data) : nullptr;
+#endif
+            if (m_data == nullptr)
+            {
+                close();
+                return false;
+            }
+            return true;
+        }
+
+        void flush(bool wait)
+        {
+            if (m_data == nullptr)
+            {
+                return;
+            }
+#ifdef _WIN32
+            ::FlushViewOfFile(m_data, 0);
+            if (wait)
+            {
+                ::FlushFileBuffers(m_file);
+            }
+#else
+            ::msync(m_data, m_size, wait ? MS_SYNC : MS_ASYNC);
+#endif
+        }
+
+        void close()
+        {
+#ifdef _WIN32
+            if (m_data != nullptr)
+            {
+                ::UnmapViewOfFile(m_data);
+            }
+            if (m_file != INVALID_HANDLE_VALUE)
+            {
+                ::CloseHandle(m_file);
+                m_file = INVALID_HANDLE_VALUE;
+            }
+#else
+            if (m_data != nullptr)
+            {
+                ::munmap(m_data, m_size);
+            }
+#endif
+            m_data = nullptr;
+            m_size = 0;
+        }
+
+        uint8_t* data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+    private:
+#ifndef _WIN32
+        /// <summary>
+        /// Give the file <paramref name="size"/> bytes of disk blocks. Records
+        /// are written through the mapping, where running out of disk space on
+        /// a sparse file raises SIGBUS instead of failing a call.
+        /// </summary>
+        static bool allocate(int fd, size_t size)
+        {
+#ifdef __APPLE__
+            fstore_t store = { F_ALLOCATEALL, F_PEOFPOSMODE, 0, static_cast<off_t>(size), 0 };
+            if (::fcntl(fd, F_PREALLOCATE, &store) == -1)
+            {
+                return false;
+            }
+            return ::ftruncate(fd, static_cast<off_t>(size)) == 0;
+#else
+            return ::posix_fallocate(fd, 0, static_cast<off_t>(size)) == 0;
+#endif
+        }
+#endif
+
+#ifdef _WIN32
+        HANDLE   m_file { INVALID_HANDLE_VALUE };
+#endif
+        uint8_t* m_data {};
+        size_t   m_size {};
+    };
+
+    MATSDK_LOG_INST_COMPONENT_CLASS(OfflineStorage_SegmentLog, "EventsSDK.Storage", "Events telemetry client - OfflineStorage_SegmentLog class");
+
+    namespace {
+
+        // Segment file: 8-byte magic, latency (u32), reserved (u32), then frames.
+        // Frame: payload length (u32), CRC-32 of the payload (u32), payload.
+        // The top bit of the length marks a deleted record; it is left out of
+        // the CRC so that deleting is a single byte write to the mapping.
+        // A zero length ends the segment. All integers are little-endian.
+        constexpr char   kSegmentMagic[8] = { '1', 'D', 'S', 'S', 'E', 'G', '0', '1' };
+        constexpr size_t kSegmentHeaderSize = 16;
+        constexpr size_t kFrameHeaderSize = 8;
+        constexpr uint32_t kFrameDeleted = 0x80000000u;
+        constexpr size_t kMinSegmentSize = 4096;
+        constexpr uint8_t kRecordFormat = 1;
+
+        uint32_t crc32(uint8_t const* data, size_t size)
+        {
+            static struct Table
+            {
+                uint32_t values[256];
+                Table()
+                {
+                    for (uint32_t i = 0; i < 256; i++)
+                    {
+                        uint32_t c = i;
+                        for (int k = 0; k < 8; k++)
+                        {
+                            c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+                        }
+                        values[i] = c;
+                    }
+                }
+            } const table;
+
+            uint32_t crc = 0xFFFFFFFFu;
+            for (size_t i = 0; i < size; i++)
+            {
+                crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+            }
+            return crc ^ 0xFFFFFFFFu;
+        }
+
+        void putU16(uint8_t* p, uint16_t value)
+        {
+            p[0] = static_cast<uint8_t>(value);
+            p[1] = static_cast<uint8_t>(value >> 8);
+        }
+
+        void putU32(uint8_t* p, uint32_t value)
+        {
+            for (int i = 0; i < 4; i++)
+            {
+                p[i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+
+        void putU64(uint8_t* p, uint64_t value)
+        {
+            for (int i = 0; i < 8; i++)
+            {
+                p[i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+
+        uint16_t getU16(uint8_t const* p)
+        {
+            return static_cast<uint16_t>(p[0] | (p[1] << 8));
+        }
+
+        uint32_t getU32(uint8_t const* p)
+        {
+            uint32_t value = 0;
+            for (int i = 3; i >= 0; i--)
+            {
+                value = (value << 8) | p[i];
+            }
+            return value;
+        }
+
+        uint64_t getU64(uint8_t const* p)
+        {
+            uint64_t value = 0;
+            for (int i = 7; i >= 0; i--)
+            {
+                value = (value << 8) | p[i];
+            }
+            return value;
+        }
+
+        /// <summary>
+        /// Write a frame with <paramref name="payloadSize"/> bytes already in
+        /// place after its header. The length goes in last and the following
+        /// length slot is cleared, so a scan never runs into stale frames.
+        /// </summary>
+        void sealFrame(uint8_t* frame, size_t payloadSize, uint8_t* end)
+        {
+            putU32(frame + 4, crc32(frame + kFrameHeaderSize, payloadSize));
+            putU32(frame, static_cast<uint32_t>(payloadSize));
+            uint8_t* next = frame + kFrameHeaderSize + payloadSize;
+            if (next + 4 <= end)
+            {
+                putU32(next, 0);
+            }
+        }
+
+        /// <summary>
+        /// Return the payload size of a valid frame at <paramref name="frame"/>,
+        /// or zero at the end of the valid part of the buffer.
+        /// </summary>
+        size_t checkFrame(uint8_t const* frame, uint8_t const* end, bool* deleted = nullptr)
+        {
+            if (end - frame < static_cast<ptrdiff_t>(kFrameHeaderSize))
+            {
+                return 0;
+            }
+            uint32_t length = getU32(frame);
+            size_t payloadSize = length & ~kFrameDeleted;
+            if ((payloadSize == 0) || (payloadSize > static_cast<size_t>(end - frame) - kFrameHeaderSize))
+            {
+                return 0;
+            }
+            if (crc32(frame + kFrameHeaderSize, payloadSize) != getU32(frame + 4))
+            {
+                return 0;
+            }
+            if (deleted != nullptr)
+            {
+                *deleted = (length & kFrameDeleted) != 0;
+            }
+            return payloadSize;
+        }
+
+        /// <summary>
+        /// Set the deleted bit of a sealed frame, in the last byte of its length.
+        /// </summary>
+        void markFrameDeleted(uint8_t* frame)
+        {
+            frame[3] |= static_cast<uint8_t>(kFrameDeleted >> 24);
+        }
+
+    }
+
+    OfflineStorage_SegmentLog::OfflineStorage_SegmentLog(ILogManager& logManager, IRuntimeConfig& runtimeConfig)
+        : m_config(runtimeConfig)
+        , m_logManager(logManager)
+    {
+        m_basePath = (const char *)m_config[CFG_STR_CACHE_FILE_PATH];
+        m_segmentSize = std::max(static_cast<size_t>(static_cast<uint32_t>(m_config[CFG_INT_CACHE_SEGMENT_SIZE])), kMinSegmentSize);
+        m_DbSizeLimit = m_config.GetOfflineStorageMaximumSizeBytes();
+
+        uint32_t percentage = m_config[CFG_INT_STORAGE_FULL_PCT];
+        if ((percentage == 0) || (percentage > 100))
+        {
+            percentage = DB_FULL_NOTIFICATION_DEFAULT_PERCENTAGE; // 75%
+        }
+        m_DbSizeNotificationLimit = (percentage * (uint32_t)m_DbSizeLimit) / 100;
+        m_DbSizeNotificationInterval = m_config[CFG_INT_STORAGE_FULL_CHECK_TIME];
+    }
+
+    OfflineStorage_SegmentLog::~OfflineStorage_SegmentLog()
+    {
+        closeSegmentsUnsafe(false);
+    }
+
+    std::string OfflineStorage_SegmentLog::segmentPath(uint64_t seq) const
+    {
+        return m_basePath + "." + toString(static_cast<unsigned long long>(seq)) + ".seg";
+    }
+
+    void OfflineStorage_SegmentLog::Initialize(IOfflineStorageObserver& observer)
+    {
+        m_observer = &observer;
+
+        LOG_TRACE("Initializing offline storage: %s", m_basePath.c_str());
+        auto startTime = GetUptimeMs();
+        {
+            LOCKGUARD(m_lock);
+            if (readManifest())
+            {
+                for (uint64_t seq = m_firstSeq; seq < m_nextSeq; seq++)
+                {
+                    loadSegmentUnsafe(seq);
+                }
+
+                // Segments emptied before the last shutdown are not needed anymore
+                for (auto& chain : m_segments)
+                {
+                    std::vector<Segment*> empty;
+                    for (auto& segment : chain)
+                    {
+                        if (segment->liveCount == 0)
+                        {
+                            empty.push_back(segment.get());
+                        }
+                    }
+                    for (Segment* segment : empty)
+                    {
+                        releaseSegmentUnsafe(*segment);
+                    }
+                }
+                m_isOpened = writeManifestUnsafe();
+            }
+            if (m_isOpened)
+            {
+                loadSettings();
+            }
+            else
+            {
+                closeSegmentsUnsafe(false);
+            }
+        }
+
+        if (!m_isOpened)
+        {
+            LOG_ERROR("No segment log could be opened at %s", m_basePath.c_str());
+            m_observer->OnStorageOpened("SegmentLog/None");
+            return;
+        }
+
+        LOG_INFO("Storage opened in %lld ms with %zu records", GetUptimeMs() - startTime, m_index.size());
+        m_observer->OnStorageOpened("SegmentLog/Default");
+        ResizeDb();
+    }
+
+    void OfflineStorage_SegmentLog::Shutdown()
+    {
+        LOG_TRACE("Shutting down offline storage %s", m_basePath.c_str());
+        LOCKGUARD(m_lock);
+        for (auto& chain : m_segments)
+        {
+            for (auto& segment : chain)
+            {
+                segment->file->flush(true);
+            }
+        }
+        closeSegmentsUnsafe(false);
+        m_isOpened = false;
+    }
+
+    void OfflineStorage_SegmentLog::Flush()
+    {
+        LOCKGUARD(m_lock);
+        for (auto& chain : m_segments)
+        {
+            for (auto& segment : chain)
+            {
+                // Older segments were flushed when they filled up and are
+                // only written again when one of their records is deleted
+                if (segment->dirty || (segment == chain.back()))
+                {
+                    segment->file->flush(true);
+                    segment->dirty = false;
+                }
+            }
+        }
+    }
+
+    void OfflineStorage_SegmentLog::closeSegmentsUnsafe(bool deleteFiles)
+    {
+        m_index.clear();
+        for (auto& chain : m_segments)
+        {
+            for (auto& segment : chain)
+            {
+                segment->file->close();
+                if (deleteFiles)
+                {
+                    FileDelete(segmentPath(segment->seq).c_str());
+                }
+            }
+            chain.clear();
+        }
+    }
+
+    bool OfflineStorage_SegmentLog::readManifest()
+    {
+        std::string path = m_basePath + ".segments";
+        m_firstSeq = m_nextSeq = 0;
+        if (!FileExists(path.c_str()))
+        {
+            return true;
+        }
+
+        std::string contents = FileGetContents(path.c_str());
+        unsigned long long first = 0;
+        unsigned long long next = 0;
+        if ((sscanf(contents.c_str(), "%llu %llu", &first, &next) != 2) || (first > next))
+        {
+            LOG_WARN("Segment manifest %s is damaged, starting over", path.c_str());
+            return true;
+        }
+        m_firstSeq = first;
+        m_nextSeq = next;
+        return true;
+    }
+
+    bool OfflineStorage_SegmentLog::writeManifestUnsafe()
+    {
+        std::string contents = toString(static_cast<unsigned long long>(m_firstSeq)) + " " + toString(static_cast<unsigned long long>(m_nextSeq)) + "\n";
+        if (!FileWrite((m_basePath + ".segments").c_str(), contents.c_str()))
+        {
+            LOG_ERROR("Failed to write segment manifest for %s", m_basePath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool OfflineStorage_SegmentLog::loadSegmentUnsafe(uint64_t seq)
+    {
+        std::string path = segmentPath(seq);
+        if (!FileExists(path.c_str()))
+        {
+            return false;
+        }
+
+        std::unique_ptr<SegmentFile> file(new SegmentFile());
+        if (!file->open(path, 0))
+        {
+            LOG_WARN("Failed to open segment %s", path.c_str());
+            return false;
+        }
+
+        uint8_t const* data = file->data();
+        uint8_t const* end = data + file->size();
+        uint32_t latency = (file->size() >= kSegmentHeaderSize) ? getU32(data + 8) : 0;
+        if ((file->size() < kSegmentHeaderSize) || (memcmp(data, kSegmentMagic, sizeof(kSegmentMagic)) != 0) || (latency > EventLatency_Max))
+        {
+            LOG_WARN("Segment %s is not valid, deleting it", path.c_str());
+            file->close();
+            FileDelete(path.c_str());
+            return false;
+        }
+
+        std::unique_ptr<Segment> segment(new Segment());
+        segment->seq = seq;
+        segment->latency = static_cast<EventLatency>(latency);
+
+        size_t offset = kSegmentHeaderSize;
+        size_t payloadSize;
+        bool deleted = false;
+        while ((payloadSize = checkFrame(data + offset, end, &deleted)) != 0)
+        {
+            uint8_t const* p = data + offset + kFrameHeaderSize;
+            uint8_t const* payloadEnd = p + payloadSize;
+            if ((payloadSize < 14) || (p[0] != kRecordFormat))
+            {
+                break;
+            }
+
+            Entry entry;
+            entry.segment = segment.get();
+            entry.latency = segment->latency;
+            entry.persistence = static_cast<EventPersistence>(p[2]);
+            entry.timestamp = static_cast<int64_t>(getU64(p + 4));
+            p += 12;
+            size_t idSize = getU16(p);
+            p += 2;
+            if (payloadEnd - p < static_cast<ptrdiff_t>(idSize + 2))
+            {
+                break;
+            }
+            entry.id.assign(reinterpret_cast<char const*>(p), idSize);
+            p += idSize;
+            size_t tokenSize = getU16(p);
+            p += 2;
+            if (payloadEnd - p < static_cast<ptrdiff_t>(tokenSize + 4))
+            {
+                break;
+            }
+            entry.tenantToken.assign(reinterpret_cast<char const*>(p), tokenSize);
+            p += tokenSize;
+            entry.blobSize = getU32(p);
+            p += 4;
+            if (payloadEnd - p != static_cast<ptrdiff_t>(entry.blobSize))
+            {
+                break;
+            }
+            entry.frameOffset = offset;
+            entry.blobOffset = static_cast<size_t>(p - data);
+            offset += kFrameHeaderSize + payloadSize;
+            if (deleted)
+            {
+                continue;
+            }
+
+            segment->entries.push_back(std::move(entry));
+            Entry& stored = segment->entries.back();
+            segment->liveCount++;
+
+            // A later copy of the same record replaces the earlier one
+            auto it = m_index.find(stored.id);
+            Entry* previous = (it != m_index.end()) ? it->second : nullptr;
+            m_index[stored.id] = &stored;
+            if (previous != nullptr)
+            {
+                deleteEntryUnsafe(*previous);
+            }
+        }
+
+        LOG_TRACE("Loaded segment %s: %zu records, %zu bytes", path.c_str(), segment->entries.size(), offset);
+        segment->writeOffset = offset;
+        segment->file = std::move(file);
+        m_segments[latency].push_back(std::move(segment));
+        return true;
+    }
+
+    OfflineStorage_SegmentLog::Segment* OfflineStorage_SegmentLog::createSegmentUnsafe(EventLatency latency, size_t minCapacity)
+    {
+        // Reserve the number in the manifest first: if the file never gets
+        // written, the gap is simply skipped on the next start-up.
+        uint64_t seq = m_nextSeq++;
+        if (!writeManifestUnsafe())
+        {
+            return nullptr;
+        }
+
+        std::string path = segmentPath(seq);
+        std::unique_ptr<SegmentFile> file(new SegmentFile());
+        if (!file->open(path, std::max(m_segmentSize, minCapacity)))
+        {
+            // Most likely the disk is full
+            LOG_ERROR("Failed to create segment %s", path.c_str());
+            file->close();
+            FileDelete(path.c_str());
+            return nullptr;
+        }
+
+        uint8_t* data = file->data();
+        memcpy(data, kSegmentMagic, sizeof(kSegmentMagic));
+        putU32(data + 8, static_cast<uint32_t>(latency));
+        putU32(data + 12, 0);
+        putU32(data + kSegmentHeaderSize, 0);
+
+        std::unique_ptr<Segment> segment(new Segment());
+        segment->seq = seq;
+        segment->latency = latency;
+        segment->file = std::move(file);
+        segment->writeOffset = kSegmentHeaderSize;
+        m_segments[latency].push_back(std::move(segment));
+        return m_segments[latency].back().get();
+    }
+
+    void OfflineStorage_SegmentLog::releaseSegmentUnsafe(Segment& segment)
+    {
+        auto& chain = m_segments[segment.latency];
+        if (&segment == chain.back().get())
+        {
+            // The tail keeps taking new records, start it over instead
+            segment.entries.clear();
+            segment.writeOffset = kSegmentHeaderSize;
+            putU32(segment.file->data() + kSegmentHeaderSize, 0);
+            return;
+        }
+
+        std::string path = segmentPath(segment.seq);
+        chain.erase(std::find_if(chain.begin(), chain.end(), [&segment](std::unique_ptr<Segment> const& item) {
+            return item.get() == &segment;
+        }));
+        FileDelete(path.c_str());
+
+        uint64_t firstSeq = m_nextSeq;
+        for (auto const& item : m_segments)
+        {
+            if (!item.empty())
+            {
+                firstSeq = std::min(firstSeq, item.front()->seq);
+            }
+        }
+        if (firstSeq != m_firstSeq)
+        {
+            m_firstSeq = firstSeq;
+            writeManifestUnsafe();
+        }
+    }
+
+    void OfflineStorage_SegmentLog::deleteEntryUnsafe(Entry& entry)
+    {
+        if (entry.deleted)
+        {
+            return;
+        }
+        entry.deleted = true;
+
+        // Persist the deletion, so that the record is not loaded again
+        Segment* segment = entry.segment;
+        markFrameDeleted(segment->file->data() + entry.frameOffset);
+        segment->dirty = true;
+
+        auto it = m_index.find(entry.id);
+        if ((it != m_index.end()) && (it->second == &entry))
+        {
+            m_index.erase(it);
+        }
+
+        // Releasing the segment destroys the entry as well
+        if (--segment->liveCount == 0)
+        {
+            releaseSegmentUnsafe(*segment);
+        }
+    }
+
+    bool OfflineStorage_SegmentLog::isValidRecord(StorageRecord const& record)
+    {
+        if (record.id.empty() || record.tenantToken.empty() || static_cast<int>(record.latency) < 0 || record.timestamp <= 0 ||
+            record.id.size() > UINT16_MAX || record.tenantToken.size() > UINT16_MAX || record.blob.size() > kFrameDeleted / 2) {
+            LOG_ERROR("Failed to store event %s:%s: Invalid parameters",
+                tenantTokenToId(record.tenantToken).c_str(), record.id.c_str());
+            m_observer->OnStorageFailed("Invalid parameters");
+            return false;
+        }
+        return true;
+    }
+
+    bool OfflineStorage_SegmentLog::appendRecordUnsafe(StorageRecord const& record)
+    {
+        EventLatency latency = std::min(record.latency, EventLatency_Max);
+        size_t payloadSize = 12 + 2 + record.id.size() + 2 + record.tenantToken.size() + 4 + record.blob.size();
+        size_t frameSize = kFrameHeaderSize + payloadSize;
+
+        auto& chain = m_segments[latency];
+        Segment* segment = chain.empty() ? nullptr : chain.back().get();
+        if ((segment == nullptr) || (segment->writeOffset + frameSize > segment->file->size()))
+        {
+            if (segment != nullptr)
+            {
+                // Full segments are never written again
+                segment->file->flush(false);
+            }
+            segment = createSegmentUnsafe(latency, kSegmentHeaderSize + frameSize + 4);
+            if (segment == nullptr)
+            {
+                m_observer->OnStorageFailed("Segment error");
+                return false;
+            }
+        }
+
+        uint8_t* data = segment->file->data();
+        uint8_t* frame = data + segment->writeOffset;
+        uint8_t* p = frame + kFrameHeaderSize;
+        p[0] = kRecordFormat;
+        p[1] = static_cast<uint8_t>(latency);
+        p[2] = static_cast<uint8_t>(record.persistence);
+        p[3] = 0;
+        putU64(p + 4, static_cast<uint64_t>(record.timestamp));
+        p += 12;
+        putU16(p, static_cast<uint16_t>(record.id.size()));
+        memcpy(p + 2, record.id.data(), record.id.size());
+        p += 2 + record.id.size();
+        putU16(p, static_cast<uint16_t>(record.tenantToken.size()));
+        memcpy(p + 2, record.tenantToken.data(), record.tenantToken.size());
+        p += 2 + record.tenantToken.size();
+        putU32(p, static_cast<uint32_t>(record.blob.size()));
+        p += 4;
+        if (!record.blob.empty())
+        {
+            memcpy(p, record.blob.data(), record.blob.size());
+        }
+        sealFrame(frame, payloadSize, data + segment->file->size());
+
+        Entry entry;
+        entry.segment = segment;
+        entry.frameOffset = static_cast<size_t>(frame - data);
+        entry.blobOffset = static_cast<size_t>(p - data);
+        entry.blobSize = record.blob.size();
+        entry.id = record.id;
+        entry.tenantToken = record.tenantToken;
+        entry.latency = latency;
+        entry.persistence = record.persistence;
+        entry.timestamp = record.timestamp;
+        segment->entries.push_back(std::move(entry));
+        segment->writeOffset += frameSize;
+        segment->liveCount++;
+
+        // IOfflineStorage leaves a repeated id unspecified; here the latest copy wins
+        Entry& stored = segment->entries.back();
+        auto it = m_index.find(stored.id);
+        Entry* previous = (it != m_index.end()) ? it->second : nullptr;
+        m_index[stored.id] = &stored;
+        if (previous != nullptr)
+        {
+            deleteEntryUnsafe(*previous);
+        }
+        return true;
+    }
+
+    bool OfflineStorage_SegmentLog::StoreRecord(StorageRecord const& record)
+    {
+        if (!isValidRecord(record)) {
+            return false;
+        }
+
+        {
+            LOCKGUARD(m_lock);
+            if (!m_isOpened) {
+                LOG_ERROR("Failed to store event %s:%s: Storage is not open",
+                    tenantTokenToId(record.tenantToken).c_str(), record.id.c_str());
+                m_observer->OnStorageOpenFailed("Storage is not open");
+                return false;
+            }
+            if (!appendRecordUnsafe(record)) {
+                return false;
+            }
+        }
+
+        checkDbSize();
+        return true;
+    }
+
+    size_t OfflineStorage_SegmentLog::StoreRecords(std::vector<StorageRecord> & records)
+    {
+        if (records.empty()) {
+            return 0;
+        }
+
+        size_t stored = 0;
+        {
+            LOCKGUARD(m_lock);
+            if (!m_isOpened) {
+                LOG_ERROR("Failed to store %zu events: Storage is not open", records.size());
+                m_observer->OnStorageOpenFailed("Storage is not open");
+                return 0;
+            }
+            for (auto & record : records) {
+                if (isValidRecord(record) && appendRecordUnsafe(record)) {
+                    ++stored;
+                }
+            }
+        }
+
+        checkDbSize();
+        return stored;
+    }
+
+    void OfflineStorage_SegmentLog::checkDbSize()
+    {
+        size_t size = GetSize();
+        if ((m_DbSizeNotificationLimit != 0) && (size > m_DbSizeNotificationLimit))
+        {
+            auto now = PAL::getMonotonicTimeMs();
+            if (static_cast<uint64_t>(now - m_isStorageFullNotificationSendTime) > m_DbSizeNotificationInterval)
+            {
+                // Notify the client that the storage is getting full, but only once in DB_FULL_CHECK_TIME_MS
+                m_isStorageFullNotificationSendTime = now;
+                DebugEvent evt;
+                evt.type = DebugEventType::EVT_STORAGE_FULL;
+                evt.param1 = (100 * size) / m_DbSizeLimit;
+                m_logManager.DispatchEvent(evt);
+            }
+        }
+
+        if ((m_DbSizeLimit != 0) && (size > m_DbSizeLimit) && m_config[CFG_BOOL_ENABLE_DB_DROP_IF_FULL])
+        {
+            ResizeDb();
+        }
+    }
+
+    StorageRecord OfflineStorage_SegmentLog::readRecordUnsafe(Entry const& entry) const
+    {
+        uint8_t const* blob = entry.segment->file->data() + entry.blobOffset;
+        return StorageRecord(entry.id, entry.tenantToken, entry.latency, entry.persistence, entry.timestamp,
+            std::vector<uint8_t>(blob, blob + entry.blobSize), entry.retryCount, entry.reservedUntil);
+    }
+
+    std::vector<OfflineStorage_SegmentLog::Entry*> OfflineStorage_SegmentLog::selectEntriesUnsafe(int minLatency, int maxLatency, bool includeReserved, unsigned maxCount) const
+    {
+        std::vector<Entry*> result;
+        for (int latency = maxLatency; latency >= std::max<int>(minLatency, EventLatency_Off); latency--)
+        {
+            for (auto const& segment : m_segments[latency])
+            {
+                for (auto& entry : segment->entries)
+                {
+                    if (entry.deleted || (!includeReserved && entry.reservedUntil != 0))
+                    {
+                        continue;
+                    }
+                    if ((maxCount != 0) && (result.size() >= maxCount))
+                    {
+                        return result;
+                    }
+                    result.push_back(&entry);
+                }
+            }
+        }
+        return result;
+    }
+
+    void OfflineStorage_SegmentLog::releaseExpiredUnsafe(int64_t now)
+    {
+        unsigned released = 0;
+        for (auto const& item : m_index)
+        {
+            Entry& entry = *item.second;
+            if ((entry.reservedUntil != 0) && (entry.reservedUntil <= now))
+            {
+                entry.reservedUntil = 0;
+                entry.retryCount++;
+                released++;
+            }
+        }
+        if (released > 0) {
+            LOG_TRACE("Released %u expired reserved events", released);
+        }
+    }
+
+    bool OfflineStorage_SegmentLog::GetAndReserveRecords(std::function<bool(StorageRecord&&)> const& consumer, unsigned leaseTimeMs, EventLatency minLatency, unsigned maxCount)
+    {
+        m_lastReadCount = 0;
+
+        LOCKGUARD(m_lock);
+        if (!m_isOpened) {
+            LOG_ERROR("Failed to retrieve events to send: Storage is not open");
+            return false;
+        }
+
+        LOG_TRACE("Retrieving max. %u%s events of latency at least %d (%s)",
+            maxCount, (maxCount > 0) ? "" : " (unlimited)", minLatency, latencyToStr(static_cast<EventLatency>(minLatency)));
+
+        int64_t now = PAL::getUtcSystemTimeMs();
+        releaseExpiredUnsafe(now);
+
+        unsigned consumed = 0;
+        for (Entry* entry : selectEntriesUnsafe(minLatency, EventLatency_Max, false, maxCount))
+        {
+            if (!consumer(readRecordUnsafe(*entry)))
+            {
+                break;
+            }
+            entry->reservedUntil = now + leaseTimeMs;
+            consumed++;
+        }
+
+        if (consumed == 0) {
+            return false;
+        }
+
+        LOG_TRACE("Reserved %u event(s) for %u milliseconds", consumed, leaseTimeMs);
+        m_lastReadCount = consumed;
+        return true;
+    }
+
+    bool OfflineStorage_SegmentLog::IsLastReadFromMemory()
+    {
+        return false;
+    }
+
+    unsigned OfflineStorage_SegmentLog::LastReadRecordCount()
+    {
+        return m_lastReadCount;
+    }
+
+    std::vector<StorageRecord> OfflineStorage_SegmentLog::GetRecords(bool shutdown, EventLatency minLatency, unsigned maxCount)
+    {
+        std::vector<StorageRecord> records;
+
+        LOCKGUARD(m_lock);
+        if (!m_isOpened) {
+            return records;
+        }
+
+        std::vector<Entry*> entries;
+        if (shutdown)
+        {
+            entries = selectEntriesUnsafe(minLatency, EventLatency_Max, true, maxCount);
+        }
+        else
+        {
+            // Only the lowest latency that has records available
+            for (int latency = std::max<int>(minLatency, EventLatency_Off); latency <= EventLatency_Max && entries.empty(); latency++)
+            {
+                entries = selectEntriesUnsafe(latency, latency, false, maxCount);
+            }
+        }
+
+        records.reserve(entries.size());
+        for (Entry* entry : entries)
+        {
+            records.push_back(readRecordUnsafe(*entry));
+        }
+        return records;
+    }
+
+    void OfflineStorage_SegmentLog::DeleteAllRecords()
+    {
+        LOCKGUARD(m_lock);
+        closeSegmentsUnsafe(true);
+        m_firstSeq = m_nextSeq;
+        writeManifestUnsafe();
+    }
+
+    void OfflineStorage_SegmentLog::DeleteRecords(const std::map<std::string, std::string> & whereFilter)
+    {
+        LOCKGUARD(m_lock);
+        if (!m_isOpened) {
+            return;
+        }
+
+        for (const auto& kv : whereFilter)
+        {
+            if ((kv.first != "record_id") && (kv.first != "tenant_token") && (kv.first != "latency") &&
+                (kv.first != "persistence") && (kv.first != "retry_count"))
+            {
+                LOG_ERROR("Failed to delete records: unknown column %s", kv.first.c_str());
+                return;
+            }
+        }
+
+        auto matches = [&whereFilter](Entry const& entry)
+        {
+            for (const auto& kv : whereFilter)
+            {
+                std::string value =
+                    (kv.first == "record_id") ? entry.id :
+                    (kv.first == "tenant_token") ? entry.tenantToken :
+                    (kv.first == "latency") ? toString(static_cast<int>(entry.latency)) :
+                    (kv.first == "persistence") ? toString(static_cast<int>(entry.persistence)) :
+                    toString(entry.retryCount);
+                if (value != kv.second)
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+
+        std::vector<Entry*> matched;
+        for (auto const& item : m_index)
+        {
+            if (matches(*item.second))
+            {
+                matched.push_back(item.second);
+            }
+        }
+        for (Entry* entry : matched)
+        {
+            deleteEntryUnsafe(*entry);
+        }
+    }
+
+    void OfflineStorage_SegmentLog::DeleteRecords(std::vector<StorageRecordId> const& ids, HttpHeaders headers, bool& fromMemory)
+    {
+        UNREFERENCED_PARAMETER(fromMemory);
+        UNREFERENCED_PARAMETER(headers);
+
+        if (ids.empty()) {
+            return;
+        }
+
+        LOCKGUARD(m_lock);
+        LOG_TRACE("Deleting %u sent event(s) {%s%s}...", static_cast<unsigned>(ids.size()), ids.front().c_str(), (ids.size() > 1) ? ", ..." : "");
+        for (auto const& id : ids)
+        {
+            auto it = m_index.find(id);
+            if (it != m_index.end())
+            {
+                deleteEntryUnsafe(*it->second);
+            }
+        }
+    }
+
+    void OfflineStorage_SegmentLog::ReleaseRecords(std::vector<StorageRecordId> const& ids, bool incrementRetryCount, HttpHeaders headers, bool& fromMemory)
+    {
+        UNREFERENCED_PARAMETER(fromMemory);
+        UNREFERENCED_PARAMETER(headers);
+
+        if (ids.empty()) {
+            return;
+        }
+
+        LOCKGUARD(m_lock);
+        LOG_TRACE("Releasing %u event(s) {%s%s}, retry count %s...",
+            static_cast<unsigned>(ids.size()), ids.front().c_str(), (ids.size() > 1) ? ", ..." : "", incrementRetryCount ? "+1" : "not changed");
+
+        for (auto const& id : ids)
+        {
+            auto it = m_index.find(id);
+            if ((it != m_index.end()) && (it->second->reservedUntil > 0))
+            {
+                it->second->reservedUntil = 0;
+                it->second->retryCount += incrementRetryCount ? 1 : 0;
+            }
+        }
+
+        if (incrementRetryCount)
+        {
+            int maxRetryCount = static_cast<int>(m_config.GetMaximumRetryCount());
+            std::map<std::string, size_t> deletedData;
+            std::vector<Entry*> retried;
+            for (auto const& item : m_index)
+            {
+                if (item.second->retryCount > maxRetryCount)
+                {
+                    deletedData[item.second->tenantToken]++;
+                    retried.push_back(item.second);
+                }
+            }
+            for (Entry* entry : retried)
+            {
+                deleteEntryUnsafe(*entry);
+            }
+            if (!retried.empty())
+            {
+                LOG_ERROR("Deleted %zu events over maximum retry count %d", retried.size(), maxRetryCount);
+                m_observer->OnStorageRecordsDropped(deletedData);
+            }
+        }
+    }
+
+    void OfflineStorage_SegmentLog::ReleaseAllRecords()
+    {
+        LOCKGUARD(m_lock);
+        for (auto const& item : m_index)
+        {
+            item.second->reservedUntil = 0;
+        }
+    }
+
+    void OfflineStorage_SegmentLog::loadSettings()
+    {
+        m_settings.clear();
+        std::string path = m_basePath + ".settings";
+        if (!FileExists(path.c_str()))
+        {
+            return;
+        }
+
+        std::FILE* file = FileOpen(path.c_str(), "rb");
+        if (file == nullptr)
+        {
+            return;
+        }
+        std::vector<uint8_t> contents;
+        uint8_t buffer[4096];
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            contents.insert(contents.end(), buffer, buffer + read);
+        }
+        FileClose(file);
+
+        // Same framing as the segments: one setting per frame
+        uint8_t const* p = contents.data();
+        uint8_t const* end = p + contents.size();
+        size_t payloadSize;
+        while ((payloadSize = checkFrame(p, end)) != 0)
+        {
+            uint8_t const* payload = p + kFrameHeaderSize;
+            size_t nameSize = (payloadSize >= 2) ? getU16(payload) : payloadSize;
+            if (payloadSize < 2 + nameSize)
+            {
+                break;
+            }
+            m_settings[std::string(reinterpret_cast<char const*>(payload + 2), nameSize)] =
+                std::string(reinterpret_cast<char const*>(payload + 2 + nameSize), payloadSize - 2 - nameSize);
+            p += kFrameHeaderSize + payloadSize;
+        }
+    }
+
+    bool OfflineStorage_SegmentLog::saveSettingsUnsafe()
+    {
+        std::vector<uint8_t> contents;
+        for (auto const& setting : m_settings)
+        {
+            size_t payloadSize = 2 + setting.first.size() + setting.second.size();
+            size_t offset = contents.size();
+            contents.resize(offset + kFrameHeaderSize + payloadSize + 4);
+            uint8_t* frame = contents.data() + offset;
+            putU16(frame + kFrameHeaderSize, static_cast<uint16_t>(setting.first.size()));
+            memcpy(frame + kFrameHeaderSize + 2, setting.first.data(), setting.first.size());
+            memcpy(frame + kFrameHeaderSize + 2 + setting.first.size(), setting.second.data(), setting.second.size());
+            sealFrame(frame, payloadSize, contents.data() + contents.size());
+            contents.resize(offset + kFrameHeaderSize + payloadSize);
+        }
+
+        std::string path = m_basePath + ".settings";
+        std::FILE* file = FileOpen(path.c_str(), "wb");
+        if (file == nullptr)
+        {
+            LOG_ERROR("Failed to write settings to %s", path.c_str());
+            return false;
+        }
+        bool result = contents.empty() || (fwrite(contents.data(), 1, contents.size(), file) == contents.size());
+        result &= (fflush(file) == 0);
+        FileClose(file);
+        return result;
+    }
+
+    bool OfflineStorage_SegmentLog::StoreSetting(std::string const& name, std::string const& value)
+    {
+        if (name.empty() || name.size() > UINT16_MAX) {
+            LOG_ERROR("Failed to set setting \"%s\": Invalid name", name.c_str());
+            return false;
+        }
+
+        LOCKGUARD(m_lock);
+        if (!m_isOpened) {
+            LOG_ERROR("Failed to set setting \"%s\": Storage is not open", name.c_str());
+            return false;
+        }
+        if (value.empty()) {
+            m_settings.erase(name);
+        }
+        else {
+            m_settings[name] = value;
+        }
+        return saveSettingsUnsafe();
+    }
+
+    std::string OfflineStorage_SegmentLog::GetSetting(std::string const& name)
+    {
+        LOCKGUARD(m_lock);
+        auto it = m_settings.find(name);
+        return (it != m_settings.end()) ? it->second : std::string();
+    }
+
+    bool OfflineStorage_SegmentLog::DeleteSetting(std::string const& name)
+    {
+        if (name.empty()) {
+            LOG_ERROR("Failed to delete setting \"%s\": Name cannot be empty", name.c_str());
+            return false;
+        }
+
+        LOCKGUARD(m_lock);
+        if (!m_isOpened) {
+            return false;
+        }
+        if (m_settings.erase(name) == 0) {
+            return true;
+        }
+        return saveSettingsUnsafe();
+    }
+
+    size_t OfflineStorage_SegmentLog::getSizeUnsafe() const
+    {
+        size_t size = 0;
+        for (auto const& chain : m_segments)
+        {
+            for (auto const& segment : chain)
+            {
+                size += segment->writeOffset;
+            }
+        }
+        return size;
+    }
+
+    size_t OfflineStorage_SegmentLog::GetSize()
+    {
+        LOCKGUARD(m_lock);
+        return getSizeUnsafe();
+    }
+
+    size_t OfflineStorage_SegmentLog::GetRecordCount(EventLatency latency) const
+    {
+        LOCKGUARD(m_lock);
+        if (latency == EventLatency_Unspecified)
+        {
+            return m_index.size();
+        }
+
+        size_t count = 0;
+        if ((latency >= EventLatency_Off) && (latency <= EventLatency_Max))
+        {
+            for (auto const& segment : m_segments[latency])
+            {
+                count += segment->liveCount;
+            }
+        }
+        return count;
+    }
+
+    bool OfflineStorage_SegmentLog::ResizeDb()
+    {
+        DroppedMap dropped;
+        size_t eventsDropped = 0;
+        {
+            LOCKGUARD(m_lock);
+            size_t size = getSizeUnsafe();
+            if (!m_isOpened || (size <= m_DbSizeLimit))
+            {
+                return false;
+            }
+
+            // Drop whole segments, oldest first, until a quarter of the data is gone
+            size_t target = size - size / 4;
+            while ((size > target) && !m_index.empty())
+            {
+                Segment* oldest = nullptr;
+                for (auto const& chain : m_segments)
+                {
+                    for (auto const& segment : chain)
+                    {
+                        if ((segment->liveCount != 0) && ((oldest == nullptr) || (segment->seq < oldest->seq)))
+                        {
+                            oldest = segment.get();
+                        }
+                    }
+                }
+                if (oldest == nullptr)
+                {
+                    break;
+                }
+
+                std::vector<Entry*> entries;
+                for (auto& entry : oldest->entries)
+                {
+                    if (!entry.deleted)
+                    {
+                        dropped[entry.tenantToken]++;
+                        entries.push_back(&entry);
+                    }
+                }
+                eventsDropped += entries.size();
+                for (Entry* entry : entries)
+                {
+                    deleteEntryUnsafe(*entry);
+                }
+                size = getSizeUnsafe();
+            }
+        }
+
+        LOG_TRACE("Storage resized, events dropped: %zu", eventsDropped);
+        if (eventsDropped > 0)
+        {
+            m_observer->OnStorageTrimmed(dropped);
+        }
+
+        DebugEvent evt(DebugEventType::EVT_DROPPED);
+        evt.param1 = eventsDropped;
+        evt.size = eventsDropped;
+        m_logManager.DispatchEvent(evt);
+        return true;
+    }
+
+} MAT_NS_END
+#endif
@@ -0,0 +1,152 @@
+#include "mat/config.h"
+#ifdef HAVE_MAT_STORAGE
+//
+// Copyright (c) 2015-2020 Microsoft Corporation and Contributors.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#pragma once
+#include "pal/PAL.hpp"
+#include "IOfflineStorage.hpp"
+
+#include "api/IRuntimeConfig.hpp"
+
+#include "ILogManager.hpp"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace MAT_NS_BEGIN {
+
+    class SegmentFile;
+
+    /// <summary>
+    /// Offline storage kept in append-only, memory-mapped segment files,
+    /// one chain of segments per event latency.
+    /// </summary>
+    /// <remarks>
+    /// Records are appended to the tail segment of their latency, each one
+    /// framed with its length and a CRC-32. A deleted record gets a flag set
+    /// in its frame header, and a segment file is deleted as a whole once all
+    /// of its records are gone. Reservations and retry counts live in an
+    /// in-memory index only. On start-up segments are scanned up to the first
+    /// frame that does not check out, so a torn write loses only the records
+    /// after it. Deletions are written through the mapping: they survive a
+    /// process crash, and an OS crash only if Flush() or Shutdown() ran since.
+    /// </remarks>
+    class OfflineStorage_SegmentLog : public IOfflineStorage
+    {
+    public:
+        OfflineStorage_SegmentLog(ILogManager& logManager, IRuntimeConfig& runtimeConfig);
+
+        virtual ~OfflineStorage_SegmentLog() override;
+        virtual void Initialize(IOfflineStorageObserver& observer) override;
+        virtual void Shutdown() override;
+        virtual void Flush() override;
+        virtual bool StoreRecord(StorageRecord const& record) override;
+        virtual size_t StoreRecords(std::vector<StorageRecord> & records) override;
+        virtual bool GetAndReserveRecords(std::function<bool(StorageRecord&&)> const& consumer, unsigned leaseTimeMs, EventLatency minLatency = EventLatency_Normal, unsigned maxCount = 0) override;
+        virtual bool IsLastReadFromMemory() override;
+        virtual unsigned LastReadRecordCount() override;
+
+        virtual void DeleteRecords(const std::map<std::string, std::string> & whereFilter) override;
+        virtual void DeleteAllRecords() override;
+        virtual void DeleteRecords(std::vector<StorageRecordId> const& ids, HttpHeaders headers, bool& fromMemory) override;
+        virtual void ReleaseRecords(std::vector<StorageRecordId> const& ids, bool incrementRetryCount, HttpHeaders headers, bool& fromMemory) override;
+        virtual void ReleaseAllRecords() override;
+
+        virtual bool StoreSetting(std::string const& name, std::string const& value) override;
+        virtual std::string GetSetting(std::string const& name) override;
+        virtual bool DeleteSetting(std::string const& name) override;
+        virtual size_t GetSize() override;
+        virtual size_t GetRecordCount(EventLatency latency) const override;
+        virtual std::vector<StorageRecord> GetRecords(bool shutdown, EventLatency minLatency = EventLatency_Normal, unsigned maxCount = 0) override;
+        virtual bool ResizeDb() override;
+
+    protected:
+        struct Segment;
+
+        /// <summary>
+        /// Index entry of one stored record. The blob itself stays in the
+        /// mapped segment file and is only copied out when the record is read.
+        /// </summary>
+        struct Entry
+        {
+            Segment*            segment {};
+            size_t              frameOffset {};
+            size_t              blobOffset {};
+            size_t              blobSize {};
+            StorageRecordId     id;
+            std::string         tenantToken;
+            EventLatency        latency { EventLatency_Normal };
+            EventPersistence    persistence { EventPersistence_Normal };
+            int64_t             timestamp {};
+            int                 retryCount {};
+            int64_t             reservedUntil {};
+            bool                deleted {};
+        };
+
+        struct Segment
+        {
+            uint64_t                        seq {};
+            EventLatency                    latency { EventLatency_Normal };
+            std::unique_ptr<SegmentFile>    file;
+            size_t                          writeOffset {};
+            size_t                          liveCount {};
+            bool                            dirty {};
+            std::deque<Entry>               entries;
+        };
+
+        bool isValidRecord(StorageRecord const& record);
+        bool appendRecordUnsafe(StorageRecord const& record);
+        Segment* createSegmentUnsafe(EventLatency latency, size_t minCapacity);
+        bool loadSegmentUnsafe(uint64_t seq);
+        void releaseSegmentUnsafe(Segment& segment);
+        void deleteEntryUnsafe(Entry& entry);
+        void releaseExpiredUnsafe(int64_t now);
+        StorageRecord readRecordUnsafe(Entry const& entry) const;
+        std::vector<Entry*> selectEntriesUnsafe(int minLatency, int maxLatency, bool includeReserved, unsigned maxCount) const;
+        size_t getSizeUnsafe() const;
+        void checkDbSize();
+        void closeSegmentsUnsafe(bool deleteFiles);
+
+        bool readManifest();
+        bool writeManifestUnsafe();
+        void loadSettings();
+        bool saveSettingsUnsafe();
+        std::string segmentPath(uint64_t seq) const;
+
+    protected:
+        mutable std::recursive_mutex    m_lock {};
+        IOfflineStorageObserver*        m_observer {};
+        IRuntimeConfig&                 m_config;
+        ILogManager&                    m_logManager;
+
+        std::string                     m_basePath;
+        size_t                          m_segmentSize {};
+        bool                            m_isOpened {};
+
+        /// Segments in use are numbered [m_firstSeq, m_nextSeq), across all
+        /// latencies. Only this range is kept in the manifest file.
+        uint64_t                        m_firstSeq {};
+        uint64_t                        m_nextSeq {};
+        std::deque<std::unique_ptr<Segment>> m_segments[EventLatency_Max + 1];
+        std::unordered_map<StorageRecordId, Entry*> m_index;
+        std::map<std::string, std::string> m_settings;
+
+        unsigned                        m_lastReadCount {};
+        unsigned                        m_DbSizeNotificationLimit {};
+        uint64_t                        m_DbSizeNotificationInterval {};
+        size_t                          m_DbSizeLimit {};
+        uint64_t                        m_isStorageFullNotificationSendTime {};
+
+    protected:
+        MATSDK_LOG_DECL_COMPONENT_CLASS();
+    };
+
+} MAT_NS_END
+#endif
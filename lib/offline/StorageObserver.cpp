@@ -205,6 +205,26 @@ namespace MAT_NS_BEGIN {
         }
     }
 
+    void StorageObserver::OnStorageRecordsShed(std::map<std::string, size_t> const& numRecords)
+    {
+        StorageNotificationContext ctx;
+        size_t overallCount = 0;
+        for (const auto& records : numRecords)
+        {
+            ctx.countonTenant[records.first] = records.second;
+            overallCount += records.second;
+        }
+        recordsShed(&ctx);
+
+        {
+            DebugEvent evt;
+            evt.type = EVT_SHED;
+            evt.param1 = overallCount;
+            evt.size = overallCount;
+            DispatchEvent(evt);
+        }
+    }
+
     void StorageObserver::OnStorageRecordsSaved(size_t numRecords)
     {
         DebugEvent evt;
@@ -45,6 +45,7 @@ namespace MAT_NS_BEGIN {
         virtual void OnStorageRecordsDropped(std::map<std::string, size_t> const& numRecords) override;
         virtual void OnStorageRecordsRejected(std::map<std::string, size_t> const& numRecords) override;
         virtual void OnStorageRecordsSaved(size_t numRecords) override;
+        virtual void OnStorageRecordsShed(std::map<std::string, size_t> const& numRecords) override;
 
     protected:
         ITelemetrySystem & m_system;
@@ -82,6 +83,7 @@ namespace MAT_NS_BEGIN {
         RouteSource<StorageNotificationContext const*>                          trimmed;
         RouteSource<StorageNotificationContext const*>                          recordsDropped;
         RouteSource<StorageNotificationContext const*>                          recordsRejected;
+        RouteSource<StorageNotificationContext const*>                          recordsShed;
     };
 
 
@@ -37,6 +37,7 @@ size_t BondSplicer::getSizeEstimate() const
 std::vector<uint8_t> BondSplicer::splice() const
 {
     std::vector<uint8_t> output;
+    output.reserve(m_buffer.size());
     bond_lite::CompactBinaryProtocolWriter writer(output);
 
     if (!m_packages.empty()) {
@@ -52,6 +53,34 @@ std::vector<uint8_t> BondSplicer::splice() const
     return output;
 }
 
+bool BondSplicer::isBufferInPackageOrder() const
+{
+    size_t offset = 0;
+    for (PackageInfo const& package : m_packages) {
+        for (Span const& record : package.records) {
+            if (record.offset != offset) {
+                return false;
+            }
+            offset += record.length;
+        }
+    }
+    return offset == m_buffer.size();
+}
+
+std::vector<uint8_t> BondSplicer::spliceAndClear()
+{
+    // When records were added tenant by tenant (the usual case, and always
+    // with a single tenant), the buffer already is the spliced output.
+    std::vector<uint8_t> output;
+    if (isBufferInPackageOrder()) {
+        output.swap(m_buffer);
+    } else {
+        output = splice();
+    }
+    clear();
+    return output;
+}
+
 void BondSplicer::clear()
 {
     // Swap with empty instead of clear() to release memory
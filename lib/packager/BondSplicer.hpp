@@ -18,6 +18,8 @@ namespace MAT_NS_BEGIN {
 class BondSplicer : public ISplicer
 {
   protected:
+    bool isBufferInPackageOrder() const;
+
     std::vector<uint8_t>     m_buffer;
     std::vector<PackageInfo> m_packages;
     size_t                   m_overheadEstimate {};
@@ -32,6 +34,7 @@ class BondSplicer : public ISplicer
 
     size_t getSizeEstimate() const override;
     std::vector<uint8_t> splice() const override;
+    std::vector<uint8_t> spliceAndClear() override;
 
     void clear() override;
 };
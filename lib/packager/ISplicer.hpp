@@ -35,6 +35,12 @@ class ISplicer
     virtual size_t getSizeEstimate() const = 0;
     virtual std::vector<uint8_t> splice() const = 0;
 
+    /// <summary>
+    /// Same as splice() followed by clear(), but may hand the internal buffer
+    /// over to the caller instead of copying it.
+    /// </summary>
+    virtual std::vector<uint8_t> spliceAndClear() = 0;
+
     virtual void clear() = 0;
 };
 
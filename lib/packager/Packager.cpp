@@ -28,6 +28,7 @@ namespace MAT_NS_BEGIN {
             }
             if (ctx->splicer->getSizeEstimate() + record.blob.size() > ctx->maxUploadSize) {
                 wantMore = false;
+                ctx->packageFull = true;
                 if (!ctx->recordIdsAndTenantIds.empty()) {
                     LOG_TRACE("Maximum upload size %u bytes exceeded, not adding the next event (ID %s, size %u bytes)",
                         ctx->maxUploadSize, record.id.c_str(), static_cast<unsigned>(record.blob.size()));
@@ -74,8 +75,7 @@ namespace MAT_NS_BEGIN {
             return;
         }
 
-        ctx->body = ctx->splicer->splice();
-        ctx->splicer->clear();
+        ctx->body = ctx->splicer->spliceAndClear();
 
         packagedEvents(ctx);
     }
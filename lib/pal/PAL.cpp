@@ -12,6 +12,8 @@
 #include <list>
 #include <memory>
 #include <chrono>
+#include <functional>
+#include <random>
 #include <thread>
 
 #include <iostream>
@@ -300,28 +302,35 @@ namespace PAL_NS_BEGIN {
         UNREFERENCED_PARAMETER(hr);
         return MAT::to_string(uuid);
 #else
-        static std::once_flag flag;
-        std::call_once(flag, [](){
-            auto now = std::chrono::high_resolution_clock::now();
-            auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
-            std::srand(static_cast<unsigned int>(std::time(0) ^ nanos));
-        });
-
-        GUID_t uuid;
-        uuid.Data1 = (static_cast<uint16_t>(std::rand()) << 16) | static_cast<uint16_t>(std::rand());
-        uuid.Data2 = static_cast<uint16_t>(std::rand());
-        uuid.Data3 = static_cast<uint16_t>(std::rand());
-        for (size_t i = 0; i < sizeof(uuid.Data4); i++)
-            uuid.Data4[i] = static_cast<uint8_t>(std::rand());
-
-        // TODO: [MG] - replace this sprintf by more robust GUID to string converter
-        char buf[40] = { 0 };
-        sprintf(buf,
-            "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
-            uuid.Data1, uuid.Data2, uuid.Data3,
-            uuid.Data4[0], uuid.Data4[1], uuid.Data4[2], uuid.Data4[3],
-            uuid.Data4[4], uuid.Data4[5], uuid.Data4[6], uuid.Data4[7]);
-        return buf;
+        // Each thread owns its generator, so there is no shared state to
+        // lock (std::rand() is neither thread-safe nor of good quality).
+        static thread_local std::mt19937_64 generator = []() {
+            std::random_device device;
+            auto nanos = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+            std::seed_seq seed{
+                device(), device(), device(), device(),
+                static_cast<unsigned>(nanos), static_cast<unsigned>(static_cast<uint64_t>(nanos) >> 32),
+                static_cast<unsigned>(std::hash<std::thread::id>()(std::this_thread::get_id())) };
+            return std::mt19937_64(seed);
+        }();
+
+        // RFC 4122 version 4 (random) UUID
+        uint64_t hi = (generator() & 0xFFFFFFFFFFFF0FFFull) | 0x0000000000004000ull;
+        uint64_t lo = (generator() & 0x3FFFFFFFFFFFFFFFull) | 0x8000000000000000ull;
+
+        // xxxxxxxx-xxxx-4xxx-yxxx-xxxxxxxxxxxx
+        static const char hexDigits[] = "0123456789abcdef";
+        static const uint8_t offsets[32] = {
+            0, 1, 2, 3, 4, 5, 6, 7, 9, 10, 11, 12, 14, 15, 16, 17,
+            19, 20, 21, 22, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35 };
+        char buf[36];
+        buf[8] = buf[13] = buf[18] = buf[23] = '-';
+        for (unsigned i = 0; i < 16; i++)
+        {
+            buf[offsets[i]] = hexDigits[(hi >> (60 - 4 * i)) & 0xF];
+            buf[offsets[16 + i]] = hexDigits[(lo >> (60 - 4 * i)) & 0xF];
+        }
+        return std::string(buf, sizeof(buf));
 #endif
     }
 #ifdef _MSC_VER
@@ -8,6 +8,9 @@
 
 #if defined(MATSDK_PAL_CPP11) || defined(MATSDK_PAL_WIN32)
 
+#include <map>
+#include <unordered_map>
+
 /* Maximum scheduler interval for SDK is 1 hour required for clamping in case of monotonic clock drift */
 #define MAX_FUTURE_DELTA_MS (60 * 60 * 1000)
 
@@ -32,7 +35,12 @@ namespace PAL_NS_BEGIN {
         std::timed_mutex      m_execution_mutex;
 
         std::list<MAT::Task*> m_queue;
-        std::list<MAT::Task*> m_timerQueue;
+
+        // Timed tasks ordered by TargetTime (FIFO for equal times), plus an
+        // index by task so that Cancel does not scan the whole queue.
+        using TimerQueue = std::multimap<uint64_t, MAT::Task*>;
+        TimerQueue            m_timerQueue;
+        std::unordered_map<MAT::Task*, TimerQueue::iterator> m_timerIndex;
         Event                 m_event;
         MAT::Task*            m_itemInProgress;
         int count = 0;
@@ -77,14 +85,10 @@ namespace PAL_NS_BEGIN {
 
         void Queue(MAT::Task* item) final
         {
-            LOG_INFO("queue item=%p", &item);
+            LOG_TRACE("queue item=%p", item);
             LOCKGUARD(m_lock);
             if (item->Type == MAT::Task::TimedCall) {
-                auto it = m_timerQueue.begin();
-                while (it != m_timerQueue.end() && (*it)->TargetTime < item->TargetTime) {
-                    ++it;
-                }
-                m_timerQueue.insert(it, item);
+                m_timerIndex[item] = m_timerQueue.emplace(item->TargetTime, item);
             }
             else {
                 m_queue.push_back(item);
@@ -152,10 +156,11 @@ namespace PAL_NS_BEGIN {
             }
 
             {
-                auto it = std::find(m_timerQueue.begin(), m_timerQueue.end(), item);
-                if (it != m_timerQueue.end()) {
+                auto it = m_timerIndex.find(item);
+                if (it != m_timerIndex.end()) {
                     // Still in the queue
-                    m_timerQueue.erase(it);
+                    m_timerQueue.erase(it->second);
+                    m_timerIndex.erase(it);
                     delete item;
                 }
             }
@@ -174,6 +179,16 @@ namespace PAL_NS_BEGIN {
         }
 
     protected:
+        // Must be called with m_lock held and a non-empty timer queue
+        MAT::Task* popTimer()
+        {
+            auto it = m_timerQueue.begin();
+            MAT::Task* result = it->second;
+            m_timerIndex.erase(result);
+            m_timerQueue.erase(it);
+            return result;
+        }
+
         static void threadFunc(void* lpThreadParameter)
         {
             uint64_t wakeupCount = 0;
@@ -190,17 +205,15 @@ namespace PAL_NS_BEGIN {
 
                     auto now = getMonotonicTimeMs();
                     if (!self->m_timerQueue.empty()) {
-                        const auto currTargetTime = self->m_timerQueue.front()->TargetTime;
+                        const auto currTargetTime = self->m_timerQueue.begin()->first;
                         if (currTargetTime <= now) {
                             // process the item at the front immediately
-                            item = std::unique_ptr<MAT::Task>(self->m_timerQueue.front());
-                            self->m_timerQueue.pop_front();
+                            item = std::unique_ptr<MAT::Task>(self->popTimer());
                         } else {
                            // timed call in future, we need to resort the items in the queue
                            const auto delta = currTargetTime - now;
                            if (delta > MAX_FUTURE_DELTA_MS) {
-                               const auto itemPtr = self->m_timerQueue.front();
-                               self->m_timerQueue.pop_front();
+                               const auto itemPtr = self->popTimer();
                                itemPtr->TargetTime = now + MAX_FUTURE_DELTA_MS;
                                self->Queue(itemPtr);
                                continue;
@@ -6,6 +6,7 @@
 #include "MetaStats.hpp"
 
 #include <utils/StringUtils.hpp>
+#include <utils/Utils.hpp>
 
 namespace MAT_NS_BEGIN {
 
@@ -118,16 +119,15 @@ namespace MAT_NS_BEGIN {
     }
 
     /// <summary>
-    /// Add count per each HTTP recode code to Record Extension Field
+    /// Add count per each key of a map to Record Extension Field as "prefix_key"
     /// </summary>
     /// <param name="record">telemetry::Record</param>
-    /// <param name="distributionName">prefix of the key name in record extension map</param>
-    /// <param name="distribution">map<unsigned int, unsigned int>, key is the http return code, value is the count</param>
-    /* TODO: consider rewriting this function */
-    static void addCountsPerHttpReturnCodeToRecordFields(::CsProtocol::Record& record, std::string const& prefix,
-        uint_uint_dict_t const& countsPerHttpReturnCodeMap)
+    /// <param name="prefix">prefix of the key name in record extension map</param>
+    /// <param name="counts">map<unsigned int, unsigned int>, only non-zero counts are added</param>
+    static void addCountsToRecordFields(::CsProtocol::Record& record, std::string const& prefix,
+        uint_uint_dict_t const& counts)
     {
-        if (countsPerHttpReturnCodeMap.empty()) {
+        if (counts.empty()) {
             return;
         }
 
@@ -136,11 +136,123 @@ namespace MAT_NS_BEGIN {
             ::CsProtocol::Data data;
             record.data.push_back(data);
         }
-        for (auto const& item : countsPerHttpReturnCodeMap) {
+        for (auto const& item : counts) {
             insertNonZero(record.data[0].properties, prefix + "_" + toString(item.first), item.second);
         }
     }
 
+    /// <summary>
+    /// Add count per each HTTP recode code to Record Extension Field
+    /// </summary>
+    /// <param name="record">telemetry::Record</param>
+    /// <param name="prefix">prefix of the key name in record extension map</param>
+    /// <param name="countsPerHttpReturnCodeMap">map<unsigned int, unsigned int>, key is the http return code, value is the count</param>
+    static void addCountsPerHttpReturnCodeToRecordFields(::CsProtocol::Record& record, std::string const& prefix,
+        uint_uint_dict_t const& countsPerHttpReturnCodeMap)
+    {
+        addCountsToRecordFields(record, prefix, countsPerHttpReturnCodeMap);
+    }
+
+    /// <summary>
+    /// Add a frequency distribution (see initDistributionKeys) to Record Extension Field
+    /// </summary>
+    /// <param name="record">telemetry::Record</param>
+    /// <param name="prefix">prefix of the key name in record extension map</param>
+    /// <param name="distribution">map<unsigned int, unsigned int>, key is the lower bound of a bucket, value is the count</param>
+    static void addDistributionToRecordFields(::CsProtocol::Record& record, std::string const& prefix,
+        uint_uint_dict_t const& distribution)
+    {
+        addCountsToRecordFields(record, prefix, distribution);
+    }
+
+    IncomingRecordStats::IncomingRecordStats()
+    {
+        for (Shard& shard : m_shards)
+        {
+            shard.received = 0;
+            shard.receivedStats = 0;
+            shard.totalSize = 0;
+            shard.minSize = static_cast<unsigned>(~0);
+            shard.maxSize = 0;
+            for (size_t i = 0; i < LatencyCount; i++)
+            {
+                shard.receivedPerLatency[i] = 0;
+                shard.sizePerLatency[i] = 0;
+            }
+            for (auto& count : shard.sizeSpots)
+            {
+                count = 0;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Counts an incoming record in the shard of the calling thread.
+    /// </summary>
+    void IncomingRecordStats::add(unsigned size, EventLatency latency, bool metastats)
+    {
+        Shard& shard = m_shards[GetThreadShardIndex(ShardCount)];
+        shard.received.fetch_add(1, std::memory_order_relaxed);
+        if (metastats)
+        {
+            shard.receivedStats.fetch_add(1, std::memory_order_relaxed);
+        }
+        shard.totalSize.fetch_add(size, std::memory_order_relaxed);
+
+        unsigned current = shard.minSize.load(std::memory_order_relaxed);
+        while (size < current && !shard.minSize.compare_exchange_weak(current, size, std::memory_order_relaxed))
+        {
+        }
+        current = shard.maxSize.load(std::memory_order_relaxed);
+        while (size > current && !shard.maxSize.compare_exchange_weak(current, size, std::memory_order_relaxed))
+        {
+        }
+
+        if (latency >= 0 && static_cast<size_t>(latency) < LatencyCount)
+        {
+            shard.receivedPerLatency[latency].fetch_add(1, std::memory_order_relaxed);
+            shard.sizePerLatency[latency].fetch_add(size, std::memory_order_relaxed);
+        }
+        shard.sizeSpots[getSizeSpot(size)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// <summary>
+    /// Moves the counters of all shards into the given stats and resets the shards.
+    /// </summary>
+    void IncomingRecordStats::drainInto(TelemetryStats& stats)
+    {
+        RecordStats& recordStats = stats.recordStats;
+        for (Shard& shard : m_shards)
+        {
+            recordStats.received += shard.received.exchange(0);
+            recordStats.receivedStats += shard.receivedStats.exchange(0);
+            recordStats.totalRecordsSizeInBytes += shard.totalSize.exchange(0);
+            recordStats.minOfRecordSizeInBytes = std::min<unsigned>(recordStats.minOfRecordSizeInBytes, shard.minSize.exchange(static_cast<unsigned>(~0)));
+            recordStats.maxOfRecordSizeInBytes = std::max<unsigned>(recordStats.maxOfRecordSizeInBytes, shard.maxSize.exchange(0));
+
+            for (size_t i = 0; i < LatencyCount; i++)
+            {
+                unsigned received = shard.receivedPerLatency[i].exchange(0);
+                unsigned size = shard.sizePerLatency[i].exchange(0);
+                if (received != 0 || size != 0)
+                {
+                    RecordStats& recordStatsPerPriority = stats.recordStatsPerLatency[static_cast<EventLatency>(i)];
+                    recordStatsPerPriority.received += received;
+                    recordStatsPerPriority.totalRecordsSizeInBytes += size;
+                }
+            }
+
+            for (unsigned spot = 0; spot < STATS_RECORD_SIZE_TOTAL_SPOTS; spot++)
+            {
+                unsigned count = shard.sizeSpots[spot].exchange(0);
+                if (count != 0)
+                {
+                    recordStats.sizeInKBytesDistribution[getDistributionKey(spot, STATS_RECORD_SIZE_FIRST_IN_KB, STATS_RECORD_SIZE_NEXT_FACTOR)] += count;
+                }
+            }
+        }
+    }
+
     MetaStats::MetaStats(IRuntimeConfig& config)
         :
         m_config(config),
@@ -267,6 +379,7 @@ namespace MAT_NS_BEGIN {
             LatencyStats& rttStats = telemetryStats.rttStats;
             insertNonZero(ext, "rtt_max", rttStats.maxOfLatencyInMilliSecs);
             insertNonZero(ext, "rtt_min", rttStats.minOfLatencyInMilliSecs);
+            addDistributionToRecordFields(record, "rtt_ms", rttStats.latencyDistribution);
         }
 
         // Event stats
@@ -287,6 +400,7 @@ namespace MAT_NS_BEGIN {
         insertNonZero(ext, "drp_ful", recordStats.overflown);
         insertNonZero(ext, "drp_io", recordStats.droppedByReason[DROPPED_REASON_OFFLINE_STORAGE_SAVE_FAILED]);
         insertNonZero(ext, "drp_ret", recordStats.droppedByReason[DROPPED_REASON_RETRY_EXCEEDED]);
+        insertNonZero(ext, "drp_ing", recordStats.droppedByReason[DROPPED_REASON_INGESTION_LIMIT]);
         addCountsPerHttpReturnCodeToRecordFields(record, "drp_HTTP", recordStats.droppedByHTTPCode);
 
         // Event size stats
@@ -296,6 +410,7 @@ namespace MAT_NS_BEGIN {
             insertNonZero(ext, "evt_bytes_max", recordStats.maxOfRecordSizeInBytes);
             insertNonZero(ext, "evt_bytes_min", recordStats.minOfRecordSizeInBytes);
             insertNonZero(ext, "evt_bytes", recordStats.totalRecordsSizeInBytes);
+            addDistributionToRecordFields(record, "evt_kb", recordStats.sizeInKBytesDistribution);
         }
 
         for (const auto &kv : m_latency_pfx)
@@ -395,6 +510,7 @@ namespace MAT_NS_BEGIN {
 
         std::vector< ::CsProtocol::Record> records;
 
+        m_incomingRecordStats.drainInto(m_telemetryStats);
         if (hasStatsDataAvailable() || rollupKind != RollUpKind::ACT_STATS_ROLLUP_KIND_ONGOING) {
             rollup(records, rollupKind);
             resetStats(false);
@@ -416,8 +532,18 @@ namespace MAT_NS_BEGIN {
     /// <param name="metastats">if set to <c>true</c> [metastats].</param>
     void MetaStats::updateOnEventIncoming(std::string const& tenanttoken, unsigned size, EventLatency latency, bool metastats)
     {
-        auto updateRecordStats = [&](RecordStats& recordStats)
+        // Cumulative
+        m_incomingRecordStats.add(size, latency, metastats);
+
+        // Per-tenant
+        if (m_enableTenantStats)
         {
+            TelemetryStats& tenantStats = m_telemetryTenantStats[tenanttoken];
+            if (tenantStats.tenantId.empty())
+            {
+                tenantStats.tenantId = tenanttoken.substr(0, tenanttoken.find('-'));
+            }
+            RecordStats& recordStats = tenantStats.recordStats;
             recordStats.received++;
             if (metastats)
             {
@@ -426,24 +552,12 @@ namespace MAT_NS_BEGIN {
             recordStats.maxOfRecordSizeInBytes = std::max<unsigned>(recordStats.maxOfRecordSizeInBytes, size);
             recordStats.minOfRecordSizeInBytes = std::min<unsigned>(recordStats.minOfRecordSizeInBytes, size);
             recordStats.totalRecordsSizeInBytes += size;
+            recordStats.sizeInKBytesDistribution[getDistributionKey(IncomingRecordStats::getSizeSpot(size), STATS_RECORD_SIZE_FIRST_IN_KB, STATS_RECORD_SIZE_NEXT_FACTOR)]++;
             if (latency >= 0) {
-                RecordStats& recordStatsPerPriority = m_telemetryTenantStats[tenanttoken].recordStatsPerLatency[latency];
+                RecordStats& recordStatsPerPriority = tenantStats.recordStatsPerLatency[latency];
                 recordStatsPerPriority.received++;
                 recordStatsPerPriority.totalRecordsSizeInBytes += size;
             }
-        };
-
-        // Cumulative
-        updateRecordStats(m_telemetryStats.recordStats);
-
-        // Per-tenant
-        if (m_enableTenantStats)
-        {
-            if (m_telemetryTenantStats[tenanttoken].tenantId.empty())
-            {
-                m_telemetryTenantStats[tenanttoken].tenantId = tenanttoken.substr(0, tenanttoken.find('-'));
-            }
-            updateRecordStats(m_telemetryTenantStats[tenanttoken].recordStats);
         }
     }
 
@@ -487,6 +601,8 @@ namespace MAT_NS_BEGIN {
         LatencyStats& rttStats = m_telemetryStats.rttStats;
         rttStats.maxOfLatencyInMilliSecs = std::max<unsigned>(rttStats.maxOfLatencyInMilliSecs, durationMs);
         rttStats.minOfLatencyInMilliSecs = std::min<unsigned>(rttStats.minOfLatencyInMilliSecs, durationMs);
+        unsigned rttSpot = getDistributionSpot(durationMs, m_statsConfig.rtt_first_duration_in_millisecs, m_statsConfig.rtt_next_factor, m_statsConfig.rtt_total_spots);
+        rttStats.latencyDistribution[getDistributionKey(rttSpot, m_statsConfig.rtt_first_duration_in_millisecs, m_statsConfig.rtt_next_factor)]++;
 
         auto updatePackageSent = [&](TelemetryStats& stats)
         {
@@ -12,8 +12,9 @@
 #include "Enums.hpp"
 #include "CsProtocol_types.hpp"
 
-#include <memory>
 #include <algorithm>
+#include <atomic>
+#include <memory>
 
 namespace MAT_NS_BEGIN {
 
@@ -229,7 +230,7 @@ namespace MAT_NS_BEGIN {
         ///<1KB, 1KB~2KB, 2KB~4KB, 4KB~8KB, 8KB~16KB, 16KB~32KB, 32KB~64KB, > 64KB \n
         ///key: min value of each size range \n
         ///value: the number of records with size in given range
-        // uint_uint_dict_t sizeInKBytesDistribution;
+        uint_uint_dict_t sizeInKBytesDistribution;
 
         /// min record size which is dropped in SendAsync
         // unsigned int minOfDroppedRecordSizeInBytes;
@@ -255,6 +256,7 @@ namespace MAT_NS_BEGIN {
 
             droppedByReason.clear();
             rejectedByReason.clear();
+            sizeInKBytesDistribution.clear();
         }
 
         RecordStats()
@@ -346,11 +348,17 @@ namespace MAT_NS_BEGIN {
         /// min latency
         unsigned int minOfLatencyInMilliSecs;
 
+        /// <100ms, 100ms~200ms, 200ms~400ms, 400ms~800ms, 800ms~1600ms, 1600s~3200ms, >3200ms \n
+        /// key: min value of each latency range \n
+        /// value: the number of samples with latency in given range
+        uint_uint_dict_t latencyDistribution;
+
         /// reset all members
         void Reset()
         {
             maxOfLatencyInMilliSecs = static_cast<unsigned int>(0);
             minOfLatencyInMilliSecs = static_cast<unsigned int>(~0);
+            latencyDistribution.clear();
         }
 
         LatencyStats()
@@ -510,7 +518,77 @@ namespace MAT_NS_BEGIN {
         }
     };
 
-    
+    /// <summary>
+    /// Index of the spot holding value in a frequency distribution with spots
+    /// 0, first, first * factor, first * factor^2, ... Values past the last
+    /// spot are counted in the last one.
+    /// </summary>
+    inline unsigned getDistributionSpot(unsigned value, unsigned first, unsigned factor, unsigned totalSpots)
+    {
+        unsigned spot = 0;
+        for (uint64_t key = first; spot + 1 < totalSpots && value >= key; key *= factor) {
+            spot++;
+        }
+        return spot;
+    }
+
+    /// <summary>
+    /// Min value of the given spot in a frequency distribution, used as its key.
+    /// </summary>
+    inline unsigned getDistributionKey(unsigned spot, unsigned first, unsigned factor)
+    {
+        unsigned key = 0;
+        for (unsigned i = 0; i < spot; i++) {
+            key = (key == 0) ? first : (key * factor);
+        }
+        return key;
+    }
+
+    /// <summary>
+    /// Cumulative stats of incoming records, updated without a lock.
+    ///
+    /// Every incoming record goes through here, so updates are spread over a
+    /// few shards by calling thread and every counter is an atomic updated in
+    /// place. The shards are drained into TelemetryStats when a stats event is
+    /// generated. A record racing with the drain may have some of its counters
+    /// reported in the next interval.
+    /// </summary>
+    class IncomingRecordStats
+    {
+    public:
+        IncomingRecordStats();
+
+        void add(unsigned size, EventLatency latency, bool metastats);
+        void drainInto(TelemetryStats& stats);
+
+        /// Spot of the record size distribution holding a record of the given size
+        static unsigned getSizeSpot(unsigned size)
+        {
+            return getDistributionSpot(size / 1024, STATS_RECORD_SIZE_FIRST_IN_KB, STATS_RECORD_SIZE_NEXT_FACTOR, STATS_RECORD_SIZE_TOTAL_SPOTS);
+        }
+
+    protected:
+        static constexpr size_t ShardCount = 8;
+        static constexpr size_t LatencyCount = EventLatency_Max + 1;
+        static constexpr size_t CacheLineSize = 64;
+
+        struct Shard
+        {
+            std::atomic<unsigned> received;
+            std::atomic<unsigned> receivedStats;
+            std::atomic<unsigned> totalSize;
+            std::atomic<unsigned> minSize;
+            std::atomic<unsigned> maxSize;
+            std::atomic<unsigned> receivedPerLatency[LatencyCount];
+            std::atomic<unsigned> sizePerLatency[LatencyCount];
+            std::atomic<unsigned> sizeSpots[STATS_RECORD_SIZE_TOTAL_SPOTS];
+            // Keeps shards written by different threads off the same cache line
+            char padding[CacheLineSize];
+        };
+
+        Shard m_shards[ShardCount];
+    };
+
     /// <summary>
     /// MetaStats class:
     /// * aggregats all per-tenant and overall stats.
@@ -524,6 +602,12 @@ namespace MAT_NS_BEGIN {
 
         std::vector< ::CsProtocol::Record> generateStatsEvent(RollUpKind rollupKind);
 
+        /// <summary>
+        /// Cumulative stats are updated without a lock, so callers need to serialize
+        /// this with the other methods only when per-tenant stats are enabled.
+        /// </summary>
+        bool isTenantStatsEnabled() const { return m_enableTenantStats; }
+
         void updateOnEventIncoming(std::string const& tenanttoken, unsigned size, EventLatency latency, bool metastats);
         void updateOnPostData(unsigned postDataLength, bool metastatsOnly);
         void updateOnPackageSentSucceeded(std::map<std::string, std::string> const& recordIdsAndTenantids, EventLatency eventLatency, unsigned retryFailedTimes, unsigned durationMs, std::vector<unsigned> const& latencyToSendMs, bool metastatsOnly);
@@ -570,6 +654,11 @@ namespace MAT_NS_BEGIN {
         /// </summary>
         TelemetryStats                  m_telemetryStats;
 
+        /// <summary>
+        /// Overall stats of incoming records not yet drained into m_telemetryStats
+        /// </summary>
+        IncomingRecordStats             m_incomingRecordStats;
+
         /// <summary>
         /// Stats Session ID shared between all tenant stats
         /// </summary>
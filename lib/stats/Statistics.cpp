@@ -35,7 +35,7 @@ namespace MAT_NS_BEGIN {
             return;
         }
 
-        m_intervalMs = m_config.GetMetaStatsSendIntervalSec() * 1000;
+        m_intervalMs = m_config.GetSnapshot()->metaStatsSendIntervalSec * 1000;
         if (m_intervalMs != 0)
         {
             if (!m_isScheduled.exchange(true))
@@ -122,10 +122,16 @@ namespace MAT_NS_BEGIN {
 
     bool Statistics::handleOnIncomingEventAccepted(IncomingEventContextPtr const& ctx)
     {
-        bool metastats = (ctx->record.tenantToken == m_config.GetMetaStatsTenantToken());
+        bool metastats = (ctx->record.tenantToken == m_config.GetSnapshot()->metaStatsTenantToken);
+        unsigned size = static_cast<unsigned>(ctx->record.blob.size());
         {
-            LOCKGUARD(m_metaStats_mtx);
-            m_metaStats.updateOnEventIncoming(ctx->record.tenantToken, static_cast<unsigned>(ctx->record.blob.size()), ctx->record.latency, metastats);
+            // Cumulative stats of incoming events are lock-free, per-tenant ones are not
+            std::unique_lock<std::mutex> lock(m_metaStats_mtx, std::defer_lock);
+            if (m_metaStats.isTenantStatsEnabled())
+            {
+                lock.lock();
+            }
+            m_metaStats.updateOnEventIncoming(ctx->record.tenantToken, size, ctx->record.latency, metastats);
         }
         scheduleSend();
 
@@ -158,7 +164,7 @@ namespace MAT_NS_BEGIN {
 
     bool Statistics::handleOnUploadStarted(EventsUploadContextPtr const& ctx)
     {
-        bool metastatsOnly = (ctx->packageIds.count(m_config.GetMetaStatsTenantToken()) == ctx->packageIds.size());
+        bool metastatsOnly = (ctx->packageIds.count(m_config.GetSnapshot()->metaStatsTenantToken) == ctx->packageIds.size());
         {
             LOCKGUARD(m_metaStats_mtx);
             m_metaStats.updateOnPostData(static_cast<unsigned>(ctx->httpRequest->GetSizeEstimate()), metastatsOnly);
@@ -190,7 +196,7 @@ namespace MAT_NS_BEGIN {
             latencyToSendMs.push_back(static_cast<unsigned>(std::max<int64_t>(0, std::min<int64_t>(0xFFFFFFFFu, now - ts))));
         }
 
-        bool metastatsOnly = (ctx->packageIds.count(m_config.GetMetaStatsTenantToken()) == ctx->packageIds.size());
+        bool metastatsOnly = (ctx->packageIds.count(m_config.GetSnapshot()->metaStatsTenantToken) == ctx->packageIds.size());
         {
             LOCKGUARD(m_metaStats_mtx);
             m_metaStats.updateOnPackageSentSucceeded(ctx->recordIdsAndTenantIds, ctx->latency, ctx->maxRetryCountSeen, ctx->durationMs, latencyToSendMs, metastatsOnly);
@@ -272,5 +278,15 @@ namespace MAT_NS_BEGIN {
         return true;
     }
 
+    bool Statistics::handleOnStorageRecordsShed(StorageNotificationContext const* ctx)
+    {
+        {
+            LOCKGUARD(m_metaStats_mtx);
+            m_metaStats.updateOnRecordsDropped(DROPPED_REASON_INGESTION_LIMIT, ctx->countonTenant);
+        }
+        scheduleSend();
+        return true;
+    }
+
 } MAT_NS_END
 
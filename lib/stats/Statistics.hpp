@@ -55,6 +55,7 @@ namespace MAT_NS_BEGIN {
         bool handleOnStorageTrimmed(StorageNotificationContext const* ctx);
         bool handleOnStorageRecordsDropped(StorageNotificationContext const* ctx);
         bool handleOnStorageRecordsRejected(StorageNotificationContext const* ctx);
+        bool handleOnStorageRecordsShed(StorageNotificationContext const* ctx);
 
     protected:
         std::mutex                  m_metaStats_mtx;
@@ -121,6 +122,7 @@ namespace MAT_NS_BEGIN {
         RoutePassThrough<Statistics, StorageNotificationContext const*> onStorageTrimmed{ this, &Statistics::handleOnStorageTrimmed };
         RoutePassThrough<Statistics, StorageNotificationContext const*> onStorageRecordsDropped{ this, &Statistics::handleOnStorageRecordsDropped };
         RoutePassThrough<Statistics, StorageNotificationContext const*> onStorageRecordsRejected{ this, &Statistics::handleOnStorageRecordsRejected };
+        RoutePassThrough<Statistics, StorageNotificationContext const*> onStorageRecordsShed{ this, &Statistics::handleOnStorageRecordsShed };
 
         virtual void OnDebugEvent(DebugEvent &evt) override;
 
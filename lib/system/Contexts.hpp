@@ -4,6 +4,7 @@
 //
 
 #pragma once
+#include "EventProperties.hpp"
 #include "IHttpClient.hpp"
 #include "IOfflineStorage.hpp"
 #include "packager/ISplicer.hpp"
@@ -22,18 +23,23 @@ namespace MAT_NS_BEGIN {
     class IncomingEventContext {
     public:
         ::CsProtocol::Record*  source;
+        // When set, the custom properties of the event have not been added to
+        // source yet: the serializer writes them from here (see Logger::logEvent)
+        EventProperties const* properties;
         StorageRecord          record;
         std::uint64_t          policyBitFlags;
 
     public:
         IncomingEventContext() :
             source(nullptr),
+            properties(nullptr),
             policyBitFlags(0)
         {
         }
 
         IncomingEventContext(std::string const& id, std::string const& tenantToken, EventLatency latency, EventPersistence persistence, ::CsProtocol::Record* source)
             : source(source),
+            properties(nullptr),
             record{ id, tenantToken, latency, persistence },
 	    policyBitFlags(0)
         {
@@ -91,6 +97,7 @@ namespace MAT_NS_BEGIN {
         std::map<std::string, std::string>   recordIdsAndTenantIds;
         std::vector<int64_t>                 recordTimestamps;
         unsigned                             maxRetryCountSeen = 0;
+        bool                                 packageFull = false;
 
         // Encoding
         std::vector<uint8_t>                 body;
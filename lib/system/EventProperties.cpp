@@ -35,9 +35,7 @@ namespace MAT_NS_BEGIN {
     {
         for (auto &kv : properties)
         {
-            auto key = kv.first;
-            auto val = kv.second;
-            m_storage->properties[key] = val;
+            m_storage->setProperty(kv.first, EventProperty(kv.second));
         }
         return (*this);
     }
@@ -119,10 +117,7 @@ namespace MAT_NS_BEGIN {
 
         for (auto &kv : properties)
         {
-            auto key = kv.first;
-            auto val = kv.second;
-
-            m_storage->properties[key] = val;
+            m_storage->setProperty(kv.first, EventProperty(kv.second));
         }
 
         return (*this);
@@ -344,7 +339,7 @@ namespace MAT_NS_BEGIN {
             return;
         }
 
-        m_storage->properties[name] = prop;
+        m_storage->setProperty(name, std::move(prop));
     }
 
     //
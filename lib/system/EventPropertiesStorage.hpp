@@ -5,6 +5,7 @@
 #pragma once
 #include <map>
 #include <string>
+#include <utility>
 
 #include "Enums.hpp"
 #include "EventProperty.hpp"
@@ -69,6 +70,24 @@ namespace MAT_NS_BEGIN {
 
           return *this;
        }
+
+       /// <summary>
+       /// Inserts or overwrites a Part C property. Unlike properties[name] = value,
+       /// this does not construct a default value first and takes over the value's
+       /// buffer instead of copying it.
+       /// </summary>
+       void setProperty(const std::string& name, EventProperty&& value)
+       {
+          auto it = properties.lower_bound(name);
+          if (it != properties.end() && it->first == name)
+          {
+             it->second = std::move(value);
+          }
+          else
+          {
+             properties.emplace_hint(it, name, std::move(value));
+          }
+       }
     };
 
 } MAT_NS_END
@@ -323,14 +323,16 @@ namespace MAT_NS_BEGIN {
     }
 
     /// <summary>
-    /// EventProperty move constructor
+    /// EventProperty move constructor. Takes over the value buffer of the
+    /// source, which is left holding an int64 zero.
     /// </summary>
     /// <param name="source">Right-hand side value of object</param>
     EventProperty::EventProperty(EventProperty&& source) /* noexcept */ :
         type(source.type)
     {
         memcpy((void*)this, (void*)&source, sizeof(EventProperty));
-        copydata(&source);
+        source.type = TYPE_INT64;
+        source.as_int64 = 0;
     }
 
 
@@ -441,6 +443,22 @@ namespace MAT_NS_BEGIN {
         return (*this);
     }
 
+    /// <summary>
+    /// EventProperty move assignment operator. Takes over the value buffer
+    /// of the source, which is left holding an int64 zero.
+    /// </summary>
+    EventProperty& EventProperty::operator=(EventProperty&& source)
+    {
+        if (this != &source)
+        {
+            clear();
+            memcpy((void*)this, (void*)&source, sizeof(EventProperty));
+            source.type = TYPE_INT64;
+            source.as_int64 = 0;
+        }
+        return (*this);
+    }
+
     /// <summary>
     /// EventProperty assignment operator
     /// </summary>
@@ -169,7 +169,7 @@ namespace MAT_NS_BEGIN {
 #ifdef HAVE_MAT_ZLIB
         compression.compress >>
 #endif
-        httpEncoder.encode >> clockSkewDelta.encode >> stats.onUploadStarted >> hcm.sendRequest;
+        httpEncoder.encode >> clockSkewDelta.encode >> stats.onUploadStarted >> tpm.uploadStarted >> hcm.sendRequest;
 
 #ifdef HAVE_MAT_ZLIB
         compression.compressionFailed >> storage.releaseRecords >> stats.onPackagingFailed >> tpm.packagingFailed;
@@ -193,6 +193,7 @@ namespace MAT_NS_BEGIN {
         storage.trimmed >> stats.onStorageTrimmed;
         storage.recordsDropped >> stats.onStorageRecordsDropped;
         storage.recordsRejected >> stats.onStorageRecordsRejected;
+        storage.recordsShed >> stats.onStorageRecordsShed;
     }
 
     TelemetrySystem::~TelemetrySystem()
@@ -213,7 +214,7 @@ namespace MAT_NS_BEGIN {
 
     void TelemetrySystem::handleIncomingEventPrepared(IncomingEventContextPtr const& event)
     {
-        uint32_t maxBlobSize = m_config[CFG_MAP_TPM][CFG_INT_TPM_MAX_BLOB_BYTES];
+        uint32_t maxBlobSize = m_config.GetSnapshot()->maxBlobBytes;
         if (event->record.blob.size() > maxBlobSize)
         {
             DebugEvent evt;
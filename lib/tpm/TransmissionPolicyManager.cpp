@@ -59,6 +59,13 @@ namespace MAT_NS_BEGIN {
         LOCKGUARD(m_backoffMutex);
         if (m_backoff)
             m_backoff->reset();
+        m_isBackoffActive = false;
+    }
+
+    bool TransmissionPolicyManager::isBackoffActive()
+    {
+        LOCKGUARD(m_backoffMutex);
+        return m_isBackoffActive;
     }
 
     std::chrono::milliseconds TransmissionPolicyManager::increaseBackoff()
@@ -72,6 +79,7 @@ namespace MAT_NS_BEGIN {
 
         std::chrono::milliseconds delay{m_backoff->getValue()};
         m_backoff->increase();
+        m_isBackoffActive = true;
         return delay;
     }
 
@@ -89,7 +97,7 @@ namespace MAT_NS_BEGIN {
             LOG_TRACE("Scheduled upload aborted, no upload.");
             return;
         }
-        if (uploadCount() >= static_cast<uint32_t>(m_config[CFG_INT_MAX_PENDING_REQ]) )
+        if (uploadCount() >= m_config.GetSnapshot()->maxPendingRequests )
         {
             LOG_TRACE("Maximum number of HTTP requests reached");
             return;
@@ -147,11 +155,10 @@ namespace MAT_NS_BEGIN {
 
     void TransmissionPolicyManager::uploadAsync(EventLatency latency)
     {
-        m_runningLatency = latency;
-        m_scheduledUploadTime = std::numeric_limits<uint64_t>::max();
-
         {
             LOCKGUARD(m_scheduledUploadMutex);
+            m_runningLatency = latency;
+            m_scheduledUploadTime = std::numeric_limits<uint64_t>::max();
             m_isUploadScheduled = false;  // Allow to schedule another uploadAsync
             if ((m_isPaused) || (m_scheduledUploadAborted))
             {
@@ -180,7 +187,30 @@ namespace MAT_NS_BEGIN {
 #endif
 
         auto ctx = m_system.createEventsUploadContext();
-        ctx->requestedMinLatency = m_runningLatency;
+        ctx->requestedMinLatency = latency;
+        addUpload(ctx);
+        initiateUpload(ctx);
+    }
+
+    void TransmissionPolicyManager::uploadImmediate()
+    {
+        {
+            LOCKGUARD(m_immediateUploadMutex);
+            m_isImmediateUploadScheduled = false;
+            m_immediateUploadBytes = 0;
+        }
+        startImmediateUpload();
+    }
+
+    void TransmissionPolicyManager::startImmediateUpload()
+    {
+        if (m_isPaused || m_scheduledUploadAborted)
+        {
+            LOG_TRACE("Paused or upload aborted, not starting immediate upload.");
+            return;
+        }
+        auto ctx = m_system.createEventsUploadContext();
+        ctx->requestedMinLatency = EventLatency_Max;
         addUpload(ctx);
         initiateUpload(ctx);
     }
@@ -203,6 +233,7 @@ namespace MAT_NS_BEGIN {
         }
     }
 
+    // Caller must hold m_scheduledUploadMutex
     bool TransmissionPolicyManager::updateTimersIfNecessary()
     {
         bool needsUpdate = TransmitProfiles::isTimerUpdateRequired();
@@ -213,6 +244,12 @@ namespace MAT_NS_BEGIN {
         return needsUpdate;
     }
 
+    std::chrono::milliseconds TransmissionPolicyManager::getTimerDelay()
+    {
+        LOCKGUARD(m_scheduledUploadMutex);
+        return m_timerdelay;
+    }
+
     bool TransmissionPolicyManager::handleStart()
     {
         m_isPaused = false;
@@ -245,6 +282,7 @@ namespace MAT_NS_BEGIN {
             m_scheduledUploadAborted = true;
             // Make sure we wait for completion of the upload scheduling task that may be running
             cancelUploadTask();
+            cancelImmediateUploadTask();
         }
 
         // Make sure we wait for all active upload callbacks to finish
@@ -265,6 +303,7 @@ namespace MAT_NS_BEGIN {
      bool TransmissionPolicyManager::handleCleanup()
      {
         cancelUploadTask();
+        cancelImmediateUploadTask();
         // Make sure ongoing uploads are finished.
         while (uploadCount() > 0)
         {
@@ -290,37 +329,75 @@ namespace MAT_NS_BEGIN {
         }
         bool forceTimerRestart = false;
 
-        /* This logic needs to be revised: one event in a dedicated HTTP post is wasteful! */
-        // Initiate upload right away
         if (event->record.latency > EventLatency_RealTime) {
-            auto ctx = m_system.createEventsUploadContext();
-            ctx->requestedMinLatency = event->record.latency;
-            addUpload(ctx);
-            initiateUpload(ctx);
+            unsigned windowMs = m_config.GetSnapshot()->immediateUploadWindowMs;
+            if (windowMs != 0)
+            {
+                // Coalesce a burst of Max-latency events into one upload, but don't
+                // wait for the window to close once they fill a whole package.
+                LOCKGUARD(m_immediateUploadMutex);
+                m_immediateUploadBytes += event->record.blob.size();
+                if (m_immediateUploadBytes < m_config.GetMaximumUploadSizeBytes())
+                {
+                    if (!m_isImmediateUploadScheduled)
+                    {
+                        m_isImmediateUploadScheduled = true;
+                        m_immediateUpload = PAL::scheduleTask(&m_taskDispatcher, windowMs, this, &TransmissionPolicyManager::uploadImmediate);
+                    }
+                    return;
+                }
+                m_immediateUploadBytes = 0;
+                if (m_isImmediateUploadScheduled && m_immediateUpload.Cancel())
+                {
+                    m_isImmediateUploadScheduled = false;
+                }
+            }
+            // Initiate upload right away
+            startImmediateUpload();
             return;
         }
 
         // Schedule async upload if not scheduled yet
         if (!m_isUploadScheduled || TransmitProfiles::isTimerUpdateRequired())
         {
-            if (updateTimersIfNecessary())
+            std::chrono::milliseconds timerDelay;
             {
-                m_timerdelay = std::chrono::milliseconds { m_timers[1] };
-                forceTimerRestart = true;
+                LOCKGUARD(m_scheduledUploadMutex);
+                if (updateTimersIfNecessary())
+                {
+                    m_timerdelay = std::chrono::milliseconds { m_timers[1] };
+                    forceTimerRestart = true;
+                }
+                timerDelay = m_timerdelay;
             }
             EventLatency proposed = calculateNewPriority();
-            if (m_timerdelay.count() >= 0)
+            if (timerDelay.count() >= 0)
             {
-                scheduleUpload(m_timerdelay, proposed, forceTimerRestart);
+                scheduleUpload(timerDelay, proposed, forceTimerRestart);
             }
         }
     }
 
+    bool TransmissionPolicyManager::handleUploadStarted(EventsUploadContextPtr const& ctx)
+    {
+        // A full package means more events are waiting. Retrieve and package the
+        // next batch while this one is on the wire instead of waiting for its
+        // response. scheduleUpload() keeps within CFG_INT_MAX_PENDING_REQ.
+        // Not while backing off: a zero delay would cancel the delayed retry.
+        if (ctx->packageFull && !isBackoffActive())
+        {
+            LOG_TRACE("Package full, scheduling next upload while ctx=%p is sent", ctx.get());
+            scheduleUpload(std::chrono::milliseconds {}, ctx->requestedMinLatency);
+        }
+        return true;
+    }
+
     // We do only Normal if too few values or timers[0] == timers[2]
     // We do only RealTime if timers[0] < 0 (do not transmit)
     // We alternate RealTime and Normal otherwise (timers differ)
     EventLatency TransmissionPolicyManager::calculateNewPriority()
     {
+        LOCKGUARD(m_scheduledUploadMutex);
         updateTimersIfNecessary();
 
         if (m_timers[0] == m_timers[1])
@@ -351,13 +428,13 @@ namespace MAT_NS_BEGIN {
         }
         else
         {
-            finishUpload(ctx, m_timerdelay);
+            finishUpload(ctx, getTimerDelay());
         }
     }
 
     void TransmissionPolicyManager::handlePackagingFailed(EventsUploadContextPtr const& ctx)
     {
-        finishUpload(ctx, m_timerdelay);
+        finishUpload(ctx, getTimerDelay());
     }
 
     void TransmissionPolicyManager::handleEventsUploadSuccessful(EventsUploadContextPtr const& ctx)
@@ -404,6 +481,7 @@ namespace MAT_NS_BEGIN {
     {
         m_isPaused = true;
         cancelUploadTask();
+        cancelImmediateUploadTask();
     }
 
     std::chrono::milliseconds TransmissionPolicyManager::getCancelWaitTime() const noexcept
@@ -425,6 +503,18 @@ namespace MAT_NS_BEGIN {
         return result;
     }
 
+    bool TransmissionPolicyManager::cancelImmediateUploadTask()
+    {
+        bool result = m_immediateUpload.Cancel(getCancelWaitTime().count());
+        if (result)
+        {
+            LOCKGUARD(m_immediateUploadMutex);
+            m_isImmediateUploadScheduled = false;
+            m_immediateUploadBytes = 0;
+        }
+        return result;
+    }
+
     size_t TransmissionPolicyManager::uploadCount() const noexcept
     {
         LOCKGUARD(m_activeUploads_lock);
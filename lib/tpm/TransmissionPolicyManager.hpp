@@ -55,10 +55,14 @@ constexpr const char* const DefaultBackoffConfig = "E,3000,300000,2,1";
         void checkBackoffConfigUpdate();
         void resetBackoff();
         std::chrono::milliseconds increaseBackoff();
+        bool isBackoffActive();
 
         void uploadAsync(EventLatency priority);
+        void uploadImmediate();
+        void startImmediateUpload();
         void finishUpload(EventsUploadContextPtr const& ctx, const std::chrono::milliseconds& nextUpload);
         bool updateTimersIfNecessary();
+        std::chrono::milliseconds getTimerDelay();
 
         bool handleStart();
         bool handlePause();
@@ -67,6 +71,7 @@ constexpr const char* const DefaultBackoffConfig = "E,3000,300000,2,1";
         void handleFinishAllUploads();
 
         void handleEventArrived(IncomingEventContextPtr const& event);
+        bool handleUploadStarted(EventsUploadContextPtr const& ctx);
 
         void handleNothingToUpload(EventsUploadContextPtr const& ctx);
         void handlePackagingFailed(EventsUploadContextPtr const& ctx);
@@ -87,6 +92,7 @@ constexpr const char* const DefaultBackoffConfig = "E,3000,300000,2,1";
         std::recursive_mutex             m_backoffMutex;
         std::string                      m_backoffConfig { DefaultBackoffConfig };
         std::unique_ptr<IBackoff>        m_backoff;
+        bool                             m_isBackoffActive { false };
         DeviceStateHandler               m_deviceStateHandler;
 
         std::atomic<bool>                m_isPaused { true };
@@ -96,6 +102,12 @@ constexpr const char* const DefaultBackoffConfig = "E,3000,300000,2,1";
         PAL::DeferredCallbackHandle      m_scheduledUpload;
         bool                             m_scheduledUploadAborted { false };
 
+        // Max-latency events arriving within CFG_INT_IMMEDIATE_UPLOAD_WINDOW_MS share one upload
+        std::mutex                       m_immediateUploadMutex;
+        PAL::DeferredCallbackHandle      m_immediateUpload;
+        bool                             m_isImmediateUploadScheduled { false };
+        size_t                           m_immediateUploadBytes { 0 };
+
         mutable std::mutex               m_activeUploads_lock;
         std::set<EventsUploadContextPtr> m_activeUploads;
         
@@ -123,6 +135,11 @@ constexpr const char* const DefaultBackoffConfig = "E,3000,300000,2,1";
         /// Cancels pending upload task.
         /// </summary>
         bool cancelUploadTask();
+
+        /// <summary>
+        /// Cancels pending coalesced upload of Max-latency events.
+        /// </summary>
+        bool cancelImmediateUploadTask();
         
         /// <summary>
         /// Calculate the number of pending upload contexts.
@@ -130,6 +147,7 @@ constexpr const char* const DefaultBackoffConfig = "E,3000,300000,2,1";
         /// <returns></returns>
         size_t uploadCount() const noexcept;
 
+        // Timer state below is shared by all logging threads: guarded by m_scheduledUploadMutex
         std::chrono::milliseconds        m_timerdelay { std::chrono::seconds { 2 } };
         EventLatency                     m_runningLatency { EventLatency_RealTime };
         TimerArray                       m_timers;
@@ -145,6 +163,7 @@ constexpr const char* const DefaultBackoffConfig = "E,3000,300000,2,1";
         RouteSink<TransmissionPolicyManager, IncomingEventContextPtr const&> eventArrived{ this, &TransmissionPolicyManager::handleEventArrived };
 
         RouteSource<EventsUploadContextPtr const&>                           initiateUpload;
+        RoutePassThrough<TransmissionPolicyManager, EventsUploadContextPtr const&> uploadStarted{ this, &TransmissionPolicyManager::handleUploadStarted };
         RouteSink<TransmissionPolicyManager, EventsUploadContextPtr const&>  nothingToUpload{ this, &TransmissionPolicyManager::handleNothingToUpload };
         RouteSink<TransmissionPolicyManager, EventsUploadContextPtr const&>  packagingFailed{ this, &TransmissionPolicyManager::handlePackagingFailed };
         RouteSink<TransmissionPolicyManager, EventsUploadContextPtr const&>  eventsUploadSuccessful{ this, &TransmissionPolicyManager::handleEventsUploadSuccessful };
@@ -10,6 +10,7 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <string>
 
 #ifdef _WIN32
@@ -293,5 +294,12 @@ namespace MAT_NS_BEGIN {
         return (unsigned)(!str[h] ? 5381 : ((unsigned long long)hashCode(str, h + 1) * (unsigned)33) ^ str[h]);
     }
 
+    size_t GetThreadShardIndex(size_t shardCount)
+    {
+        static std::atomic<size_t> nextThread(0);
+        static thread_local size_t threadIndex = nextThread.fetch_add(1, std::memory_order_relaxed);
+        return threadIndex % shardCount;
+    }
+
 } MAT_NS_END
 
@@ -95,6 +95,13 @@ namespace MAT_NS_BEGIN {
 
     unsigned hashCode(const char* str, int h = 0);
 
+    /// <summary>
+    /// Index of the calling thread into a set of <paramref name="shardCount"/>
+    /// per-thread shards (e.g. striped counters). Threads are numbered in the
+    /// order they first call this, so concurrent threads mostly get distinct shards.
+    /// </summary>
+    size_t GetThreadShardIndex(size_t shardCount);
+
 } MAT_NS_END
 
 #endif
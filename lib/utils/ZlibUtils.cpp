@@ -62,4 +62,67 @@ namespace MAT_NS_BEGIN
 #endif
     }
 
+    bool ZlibUtils::DeflateZlibVector(const std::vector<uint8_t>& in, std::vector<uint8_t>& out)
+    {
+#ifdef HAVE_MAT_ZLIB
+        uLongf size = compressBound(static_cast<uLong>(in.size()));
+        out.resize(size);
+        if (compress(out.data(), &size, in.data(), static_cast<uLong>(in.size())) != Z_OK)
+        {
+            out.clear();
+            return false;
+        }
+        out.resize(size);
+        return true;
+#else
+        UNREFERENCED_PARAMETER(in);
+        UNREFERENCED_PARAMETER(out);
+        return false;
+#endif
+    }
+
+    bool ZlibUtils::InflateZlibVector(const std::vector<uint8_t>& in, std::vector<uint8_t>& out)
+    {
+#ifdef HAVE_MAT_ZLIB
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (inflateInit(&zs) != Z_OK)
+        {
+            return false;
+        }
+
+        zs.next_in = in.data();
+        zs.avail_in = static_cast<uInt>(in.size());
+        out.resize(std::max<size_t>(in.size() * 4, 256));
+        int ret;
+        do
+        {
+            if (zs.total_out == out.size())
+            {
+                out.resize(out.size() * 2);
+            }
+            zs.next_out = out.data() + zs.total_out;
+            zs.avail_out = static_cast<uInt>(out.size() - zs.total_out);
+            ret = inflate(&zs, Z_NO_FLUSH);
+        } while (ret == Z_OK);
+
+        bool result = (ret == Z_STREAM_END) && (zs.avail_in == 0);
+        out.resize(result ? zs.total_out : 0);
+        inflateEnd(&zs);
+        return result;
+#else
+        UNREFERENCED_PARAMETER(in);
+        UNREFERENCED_PARAMETER(out);
+        return false;
+#endif
+    }
+
+    bool ZlibUtils::IsZlibStream(const std::vector<uint8_t>& data)
+    {
+        // CMF: deflate with a window of at most 32K, FCHECK makes CMF*256+FLG a multiple of 31
+        return data.size() >= 6 &&
+               (data[0] & 0x0f) == 8 && (data[0] >> 4) <= 7 &&
+               ((data[0] << 8) | data[1]) % 31 == 0;
+    }
+
 } MAT_NS_END
@@ -14,6 +14,22 @@ namespace MAT_NS_BEGIN
     {
         public:
             static bool InflateVector(const std::vector<uint8_t>& in, std::vector<uint8_t>& out, bool isGzip);
+
+            /// <summary>
+            /// Compress in into a zlib (RFC 1950) stream, replacing the contents of out.
+            /// </summary>
+            static bool DeflateZlibVector(const std::vector<uint8_t>& in, std::vector<uint8_t>& out);
+
+            /// <summary>
+            /// Decompress a zlib (RFC 1950) stream, replacing the contents of out.
+            /// Fails unless in holds exactly one complete stream.
+            /// </summary>
+            static bool InflateZlibVector(const std::vector<uint8_t>& in, std::vector<uint8_t>& out);
+
+            /// <summary>
+            /// Check whether data starts with a valid zlib (RFC 1950) deflate header.
+            /// </summary>
+            static bool IsZlibStream(const std::vector<uint8_t>& data);
     };
 
 } MAT_NS_END
@@ -25,6 +25,7 @@ class MockIOfflineStorageObserver : public MAT::IOfflineStorageObserver {
     MOCK_METHOD1(OnStorageRecordsDropped, void(std::map<std::string, size_t> const&));
     MOCK_METHOD1(OnStorageRecordsRejected, void(std::map<std::string, size_t> const&));
     MOCK_METHOD1(OnStorageRecordsSaved, void(size_t numRecords));
+    MOCK_METHOD1(OnStorageRecordsShed, void(std::map<std::string, size_t> const&));
 };
 
 #if defined(__clang__)
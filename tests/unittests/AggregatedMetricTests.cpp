@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2015-2020 Microsoft Corporation and Contributors.
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "common/Common.hpp"
+#include "AggregatedMetric.hpp"
+#include "api/Logger.hpp"
+
+#include <thread>
+#include <type_traits>
+
+using namespace testing;
+using namespace MAT;
+using namespace MAT::Models;
+
+class AggregatingLogger : public Logger
+{
+public:
+    AggregatingLogger(ILogManagerInternal& logManager,
+        ContextFieldsProvider& parentContext,
+        IRuntimeConfig& runtimeConfig) noexcept
+        : Logger("", "", "", logManager, parentContext, runtimeConfig) { }
+
+    std::mutex Lock;
+    std::vector<AggregatedMetricData> Metrics;
+    void LogAggregatedMetric(AggregatedMetricData const& metricData, EventProperties const&) override
+    {
+        std::lock_guard<std::mutex> guard(Lock);
+        Metrics.push_back(metricData);
+    }
+};
+
+class AggregatedMetricTests : public ::testing::Test
+{
+public:
+    AggregatedMetricTests() noexcept
+        : logManager(configuration)
+        , runtimeConfig(configuration)
+        , logger(logManager, contextFieldsProvider, runtimeConfig)
+    { }
+
+    ILogConfiguration configuration;
+    LogManagerImpl logManager;
+    ContextFieldsProvider contextFieldsProvider;
+    RuntimeConfig_Default runtimeConfig;
+    AggregatingLogger logger;
+};
+
+// The destructor frees the aggregation state, so a copy would free it twice
+static_assert(!std::is_copy_constructible<AggregatedMetric>::value, "AggregatedMetric must not be copyable");
+static_assert(!std::is_copy_assignable<AggregatedMetric>::value, "AggregatedMetric must not be copy-assignable");
+
+TEST_F(AggregatedMetricTests, Destructor_ReportsPendingValues)
+{
+    {
+        AggregatedMetric metric("Test.Latency", "ms", 0, "instance", "class", "id", EventProperties("Test.Event"), &logger);
+        metric.PushMetric(1.0);
+        metric.PushMetric(3.0);
+        metric.PushMetric(0.0);
+        metric.PushMetric(std::nan(""));
+    }
+
+    ASSERT_THAT(logger.Metrics, SizeIs(1));
+    auto const& data = logger.Metrics[0];
+    EXPECT_THAT(data.name, Eq("Test.Latency"));
+    EXPECT_THAT(data.units, Eq("ms"));
+    EXPECT_THAT(data.instanceName, Eq("instance"));
+    EXPECT_THAT(data.objectClass, Eq("class"));
+    EXPECT_THAT(data.objectId, Eq("id"));
+    EXPECT_THAT(data.count, Eq(3));
+    EXPECT_THAT(data.aggregates.at(AggregateType_Sum), DoubleEq(4.0));
+    EXPECT_THAT(data.aggregates.at(AggregateType_SumOfSquares), DoubleEq(10.0));
+    EXPECT_THAT(data.aggregates.at(AggregateType_Minimum), DoubleEq(0.0));
+    EXPECT_THAT(data.aggregates.at(AggregateType_Maximum), DoubleEq(3.0));
+    // 1.0 is in [2^0, 2^1), 3.0 in [2^1, 2^2), 0.0 in the lowest bucket
+    EXPECT_THAT(data.buckets, ElementsAre(Pair(-16, 1), Pair(1, 1), Pair(2, 1)));
+}
+
+TEST_F(AggregatedMetricTests, NoValues_ReportsNothing)
+{
+    {
+        AggregatedMetric metric("Test.Empty", "ms", 0, EventProperties("Test.Event"), &logger);
+    }
+    EXPECT_THAT(logger.Metrics, IsEmpty());
+}
+
+TEST_F(AggregatedMetricTests, ConcurrentPushes_AreAllCounted)
+{
+    const size_t threadCount = 8;
+    const size_t perThread = 50000;
+    {
+        AggregatedMetric metric("Test.Counter", "count", 0, EventProperties("Test.Event"), &logger);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&metric, t]() {
+                for (size_t i = 0; i < perThread; i++)
+                {
+                    metric.PushMetric(static_cast<double>(t + 1));
+                }
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    ASSERT_THAT(logger.Metrics, SizeIs(1));
+    auto const& data = logger.Metrics[0];
+    EXPECT_THAT(data.count, Eq(static_cast<long>(threadCount * perThread)));
+    EXPECT_THAT(data.aggregates.at(AggregateType_Sum), DoubleEq(perThread * (threadCount * (threadCount + 1) / 2.0)));
+    EXPECT_THAT(data.aggregates.at(AggregateType_Minimum), DoubleEq(1.0));
+    EXPECT_THAT(data.aggregates.at(AggregateType_Maximum), DoubleEq(static_cast<double>(threadCount)));
+    long bucketTotal = 0;
+    for (auto const& bucket : data.buckets)
+    {
+        bucketTotal += bucket.second;
+    }
+    EXPECT_THAT(bucketTotal, Eq(data.count));
+}
+
+TEST_F(AggregatedMetricTests, Interval_ReportsPeriodically)
+{
+    AggregatedMetric metric("Test.Periodic", "ms", 1, EventProperties("Test.Event"), &logger);
+    metric.PushMetric(5.0);
+
+    for (int i = 0; i < 300; i++)
+    {
+        {
+            std::lock_guard<std::mutex> guard(logger.Lock);
+            if (!logger.Metrics.empty())
+            {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::lock_guard<std::mutex> guard(logger.Lock);
+    ASSERT_THAT(logger.Metrics, SizeIs(1));
+    EXPECT_THAT(logger.Metrics[0].count, Eq(1));
+    EXPECT_THAT(logger.Metrics[0].duration, Ge(1000000));
+}
@@ -0,0 +1,324 @@
+//
+// Copyright (c) 2015-2020 Microsoft Corporation and Contributors.
+// SPDX-License-Identifier: Apache-2.0
+//
+
+#include "common/Common.hpp"
+#include "NullObjects.hpp"
+#include "bond/All.hpp"
+#include "bond/BondSerializer.hpp"
+#include "bond/generated/CsProtocol_writers.hpp"
+#include "bond/generated/CsProtocol_readers.hpp"
+#include "decorators/EventPropertiesDecorator.hpp"
+
+using namespace testing;
+using namespace MAT;
+
+class TestBondSerializer : public BondSerializer
+{
+  public:
+    using BondSerializer::handleSerialize;
+};
+
+class BondSerializerTests : public Test
+{
+  protected:
+    static std::vector<uint8_t> serialize(::CsProtocol::Record const& record)
+    {
+        std::vector<uint8_t> blob;
+        bond_lite::CompactBinaryProtocolWriter writer(blob);
+        bond_lite::Serialize(writer, record);
+        return blob;
+    }
+
+    static std::vector<uint8_t> makeGuid(uint8_t seed)
+    {
+        std::vector<uint8_t> guid(16);
+        for (size_t i = 0; i < guid.size(); i++) {
+            guid[i] = static_cast<uint8_t>(seed + i);
+        }
+        return guid;
+    }
+
+    static ::CsProtocol::Record makeRecord()
+    {
+        ::CsProtocol::Record record;
+        record.ver = "3.0";
+        record.name = "Microsoft.Test.Event";
+        record.time = 1234567890123;
+        record.popSample = 42.5;
+        record.iKey = "o:0123456789abcdef";
+        record.flags = 0x81;
+        record.cV = "cv.1.2";
+
+        record.extProtocol.emplace_back();
+        record.extProtocol[0].ticketKeys.push_back({ "ticket1", "ticket2" });
+        record.extProtocol[0].devMake = "Contoso";
+        record.extDevice.emplace_back();
+        record.extDevice[0].localId = "c:device";
+        record.extApp.emplace_back();
+        record.extApp[0].expId = "exp";
+        record.extApp[0].asId = -7;
+        record.tags["tag"] = "value";
+
+        ::CsProtocol::Value str;
+        str.stringValue = "Hello";
+        ::CsProtocol::Attributes attributes;
+        ::CsProtocol::PII pii;
+        pii.Kind = ::CsProtocol::PIIKind::SmtpAddress;
+        attributes.pii.push_back(pii);
+        str.attributes.push_back(attributes);
+
+        ::CsProtocol::Value num;
+        num.type = ::CsProtocol::ValueKind::ValueInt64;
+        num.longValue = -1234567;
+
+        ::CsProtocol::Value dbl;
+        dbl.type = ::CsProtocol::ValueKind::ValueDouble;
+        dbl.doubleValue = 3.25;
+
+        ::CsProtocol::Value guid;
+        guid.type = ::CsProtocol::ValueKind::ValueGuid;
+        guid.guidValue.push_back(makeGuid(0x10));
+
+        ::CsProtocol::Value guids;
+        guids.type = ::CsProtocol::ValueKind::ValueArrayGuid;
+        guids.guidArray.push_back({ makeGuid(0x20), makeGuid(0x30), {} });
+
+        ::CsProtocol::Value strings;
+        strings.type = ::CsProtocol::ValueKind::ValueArrayString;
+        strings.stringArray.push_back({ "a", "", "c" });
+
+        ::CsProtocol::Value longs;
+        longs.type = ::CsProtocol::ValueKind::ValueArrayInt64;
+        longs.longArray.push_back({ 0, -1, INT64_MAX, INT64_MIN });
+
+        record.data.emplace_back();
+        record.data[0].properties["str"] = str;
+        record.data[0].properties["num"] = num;
+        record.data[0].properties["dbl"] = dbl;
+        record.data[0].properties["guid"] = guid;
+        record.data[0].properties["guids"] = guids;
+        record.data[0].properties["strings"] = strings;
+        record.data[0].properties["longs"] = longs;
+
+        record.baseType = "PartB";
+        record.baseData.emplace_back();
+        record.baseData[0].properties["partB"] = num;
+        record.baseData[0].properties["partBGuid"] = guid;
+        return record;
+    }
+
+    /// <summary>
+    /// Decorates the record with the properties and serializes it: either with the
+    /// properties added to the record, or with BondSerializer writing them itself.
+    /// </summary>
+    static std::vector<uint8_t> serializeEvent(EventPropertiesDecorator& decorator, ::CsProtocol::Record& record, EventProperties const& properties, bool deferProperties)
+    {
+        EventLatency latency = EventLatency_Normal;
+        bool decorated = deferProperties ?
+            decorator.decorateRecord(record, latency, properties) :
+            decorator.decorate(record, latency, properties);
+        EXPECT_THAT(decorated, true);
+
+        IncomingEventContext event("id", "token", latency, EventPersistence_Normal, &record);
+        if (deferProperties) {
+            event.properties = &properties;
+        }
+        TestBondSerializer serializer;
+        IncomingEventContextPtr ctx = &event;
+        serializer.handleSerialize(ctx);
+        return event.record.blob;
+    }
+
+    static void expectSameBlobWithDeferredProperties(::CsProtocol::Record const& record, EventProperties const& properties)
+    {
+        // One decorator for both, as it picks the random device id that replaces dropped Pii
+        NullLogManager owner;
+        EventPropertiesDecorator decorator(owner);
+        ::CsProtocol::Record decorated = record;
+        std::vector<uint8_t> expected = serializeEvent(decorator, decorated, properties, false);
+        ::CsProtocol::Record partial = record;
+        std::vector<uint8_t> actual = serializeEvent(decorator, partial, properties, true);
+        EXPECT_THAT(actual, Eq(expected));
+
+        ::CsProtocol::Record decoded;
+        bond_lite::CompactBinaryProtocolReader reader(actual);
+        ASSERT_THAT(bond_lite::Deserialize(reader, decoded), true);
+        EXPECT_THAT(decoded == decorated, true);
+    }
+
+    static EventProperties makeProperties()
+    {
+        GUID_t guid("00010203-0405-0607-0809-0A0B0C0D0E0F");
+        std::vector<int64_t> longs { 0, -1, INT64_MAX };
+        std::vector<int64_t> noLongs;
+        std::vector<double> doubles { 0.0, 1.5, -2.25 };
+        std::vector<std::string> strings { "a", "", "c" };
+        std::vector<GUID_t> guids { guid, GUID_t() };
+
+        EventProperties properties("Test.Event");
+        properties.SetProperty("str", "overrides the context");
+        properties.SetProperty("emptyStr", "");
+        properties.SetProperty("int", int64_t { -5 });
+        properties.SetProperty("zero", int64_t { 0 });
+        properties.SetProperty("double", 2.5);
+        properties.SetProperty("zeroDouble", 0.0);
+        properties.SetProperty("time", time_ticks_t(uint64_t { 637000000000000000 }));
+        properties.SetProperty("true", true);
+        properties.SetProperty("false", false);
+        properties.SetProperty("guid", guid);
+        properties.SetProperty("longs", longs);
+        properties.SetProperty("noLongs", noLongs);
+        properties.SetProperty("doubles", doubles);
+        properties.SetProperty("strings", strings);
+        properties.SetProperty("guids", guids);
+        properties.SetProperty("email", "someone@example.com", PiiKind_Identity);
+        properties.SetProperty("number", int64_t { 42 }, PiiKind_GenericData);
+        properties.SetProperty("content", "some text", CustomerContentKind_GenericData);
+        properties.SetProperty("a.partB", "first", PiiKind_None, DataCategory_PartB);
+        properties.SetProperty("partB", int64_t { 7 }, PiiKind_None, DataCategory_PartB);
+        properties.SetProperty("z.partB", guid, PiiKind_None, DataCategory_PartB);
+        properties.SetProperty(CorrelationVector::PropertyName, "cv.event");
+        return properties;
+    }
+};
+
+TEST_F(BondSerializerTests, GuidValue_IsEncodedAsListOfBytes)
+{
+    ::CsProtocol::Value value;
+    value.type = ::CsProtocol::ValueKind::ValueGuid;
+    value.guidValue.push_back(makeGuid(0xF0));
+
+    std::vector<uint8_t> actual;
+    {
+        bond_lite::CompactBinaryProtocolWriter writer(actual);
+        bond_lite::Serialize(writer, value);
+    }
+
+    // The same field written element by element
+    std::vector<uint8_t> expected;
+    {
+        bond_lite::CompactBinaryProtocolWriter writer(expected);
+        writer.WriteFieldBegin(bond_lite::BT_INT32, 1, nullptr);
+        writer.WriteInt32(::CsProtocol::ValueKind::ValueGuid);
+        writer.WriteFieldEnd();
+        writer.WriteFieldBegin(bond_lite::BT_LIST, 6, nullptr);
+        writer.WriteContainerBegin(1, bond_lite::BT_LIST);
+        writer.WriteContainerBegin(16, bond_lite::BT_UINT8);
+        for (uint8_t byte : value.guidValue[0]) {
+            writer.WriteUInt8(byte);
+        }
+        writer.WriteContainerEnd();
+        writer.WriteContainerEnd();
+        writer.WriteFieldEnd();
+        writer.WriteStructEnd(false);
+    }
+
+    EXPECT_THAT(actual, Eq(expected));
+}
+
+TEST_F(BondSerializerTests, Record_RoundTripsByteIdentical)
+{
+    ::CsProtocol::Record record = makeRecord();
+    std::vector<uint8_t> blob = serialize(record);
+
+    ::CsProtocol::Record decoded;
+    bond_lite::CompactBinaryProtocolReader reader(blob);
+    ASSERT_THAT(bond_lite::Deserialize(reader, decoded), true);
+    EXPECT_THAT(decoded == record, true);
+
+    EXPECT_THAT(serialize(decoded), Eq(blob));
+}
+
+TEST_F(BondSerializerTests, Varint_EncodesBoundariesAndRoundTrips)
+{
+    std::vector<uint8_t> blob;
+    bond_lite::CompactBinaryProtocolWriter writer(blob);
+    writer.WriteUInt32(0);
+    writer.WriteUInt32(127);
+    writer.WriteUInt32(128);
+    writer.WriteUInt32(16384);
+    EXPECT_THAT(blob, ElementsAre(0x00, 0x7f, 0x80, 0x01, 0x80, 0x80, 0x01));
+
+    uint64_t const values[] = { 0, 1, 127, 128, 16383, 16384, UINT32_MAX, uint64_t { UINT32_MAX } + 1, UINT64_MAX };
+    blob.clear();
+    for (uint64_t value : values) {
+        writer.WriteUInt64(value);
+    }
+    writer.WriteInt64(INT64_MIN);
+    writer.WriteUInt16(UINT16_MAX);
+
+    bond_lite::CompactBinaryProtocolReader reader(blob);
+    for (uint64_t value : values) {
+        uint64_t actual = 0;
+        ASSERT_THAT(reader.ReadUInt64(actual), true);
+        EXPECT_THAT(actual, Eq(value));
+    }
+    int64_t signedValue = 0;
+    ASSERT_THAT(reader.ReadInt64(signedValue), true);
+    EXPECT_THAT(signedValue, Eq(INT64_MIN));
+    uint16_t shortValue = 0;
+    ASSERT_THAT(reader.ReadUInt16(shortValue), true);
+    EXPECT_THAT(shortValue, Eq(UINT16_MAX));
+    uint8_t trailing = 0;
+    EXPECT_THAT(reader.ReadUInt8(trailing), false);
+}
+
+TEST_F(BondSerializerTests, FieldBegin_EncodesShortAndLongIds)
+{
+    std::vector<uint8_t> blob;
+    bond_lite::CompactBinaryProtocolWriter writer(blob);
+    writer.WriteFieldBegin(bond_lite::BT_STRING, 5, nullptr);
+    writer.WriteFieldBegin(bond_lite::BT_LIST, 70, nullptr);
+    writer.WriteFieldBegin(bond_lite::BT_INT64, 0x1234, nullptr);
+    EXPECT_THAT(blob, ElementsAre(bond_lite::BT_STRING | (5 << 5),
+                                  bond_lite::BT_LIST | (6 << 5), 70,
+                                  bond_lite::BT_INT64 | (7 << 5), 0x34, 0x12));
+}
+
+TEST_F(BondSerializerTests, DeferredProperties_SerializeByteIdentical)
+{
+    expectSameBlobWithDeferredProperties(makeRecord(), makeProperties());
+}
+
+TEST_F(BondSerializerTests, DeferredProperties_EmptyRecordAndProperties_SerializeByteIdentical)
+{
+    expectSameBlobWithDeferredProperties(::CsProtocol::Record(), EventProperties("Test.Event"));
+
+    EventProperties partBOnly("Test.Event");
+    partBOnly.SetProperty("partB", "value", PiiKind_None, DataCategory_PartB);
+    expectSameBlobWithDeferredProperties(::CsProtocol::Record(), partBOnly);
+}
+
+TEST_F(BondSerializerTests, DeferredProperties_ContextOnlyAndCorrelationVectorCases_SerializeByteIdentical)
+{
+    ::CsProtocol::Record record = makeRecord();
+    record.cV.clear();
+    record.data[0].properties[CorrelationVector::PropertyName].stringValue = "cv.context";
+    expectSameBlobWithDeferredProperties(record, EventProperties("Test.Event"));
+
+    // Not a string: dropped without setting record.cV
+    EventProperties numberCv("Test.Event");
+    numberCv.SetProperty(CorrelationVector::PropertyName, int64_t { 1 });
+    expectSameBlobWithDeferredProperties(record, numberCv);
+
+    // A Part B property of that name is sent as is
+    EventProperties partBCv("Test.Event");
+    partBCv.SetProperty(CorrelationVector::PropertyName, "cv.partB", PiiKind_None, DataCategory_PartB);
+    expectSameBlobWithDeferredProperties(record, partBCv);
+}
+
+TEST_F(BondSerializerTests, DeferredProperties_DropPii_SerializeByteIdentical)
+{
+    // Part A as set up by the context decorators, which dropPiiPartA expects
+    ::CsProtocol::Record record = makeRecord();
+    record.extUser.emplace_back();
+    record.extUser[0].localId = "u:user";
+    record.extSdk.emplace_back();
+    record.extSdk[0].seq = 12;
+
+    EventProperties properties = makeProperties();
+    properties.SetPolicyBitFlags(MICROSOFT_EVENTTAG_DROP_PII | MICROSOFT_EVENTTAG_MARK_PII);
+    expectSameBlobWithDeferredProperties(record, properties);
+}
@@ -17,6 +17,9 @@ class ShadowBondSplicer : protected MAT::BondSplicer
 {
   public:
     using MAT::BondSplicer::addTenantToken;
+    using MAT::BondSplicer::getSizeEstimate;
+    using MAT::BondSplicer::spliceAndClear;
+    using MAT::BondSplicer::isBufferInPackageOrder;
 
     void addRecord(size_t dataPackageIndex, ::CsProtocol::Record& record)
     {
@@ -143,3 +146,40 @@ TEST_F(BondSplicerTests, splice_TwoDataPackagesWithOneNonEmptyRecordEach_SizeTwe
 
    EXPECT_THAT(bs.splice().size(), size_t { 20 });
 }
+
+TEST_F(BondSplicerTests, spliceAndClear_RecordsInPackageOrder_HandsOverBuffer)
+{
+   ::CsProtocol::Record r;
+   r.name = std::string { "Record1" };
+   ::CsProtocol::Record r2;
+   r2.name = std::string { "Record2" };
+   auto firstTokenIndex = bs.addTenantToken("tenant1");
+   bs.addRecord(firstTokenIndex, r);
+   bs.addRecord(firstTokenIndex, r2);
+   auto secondTokenIndex = bs.addTenantToken("tenant2");
+   bs.addRecord(secondTokenIndex, r);
+
+   EXPECT_THAT(bs.isBufferInPackageOrder(), true);
+   std::vector<uint8_t> expected = bs.splice();
+   EXPECT_THAT(bs.spliceAndClear(), Eq(expected));
+   EXPECT_THAT(bs.splice(), IsEmpty());
+   EXPECT_THAT(bs.getSizeEstimate(), Eq(size_t { 8 }));
+}
+
+TEST_F(BondSplicerTests, spliceAndClear_InterleavedPackages_SameAsSplice)
+{
+   ::CsProtocol::Record r;
+   r.name = std::string { "Record1" };
+   ::CsProtocol::Record r2;
+   r2.name = std::string { "Record2" };
+   auto firstTokenIndex = bs.addTenantToken("tenant1");
+   auto secondTokenIndex = bs.addTenantToken("tenant2");
+   bs.addRecord(secondTokenIndex, r2);
+   bs.addRecord(firstTokenIndex, r);
+
+   EXPECT_THAT(bs.isBufferInPackageOrder(), false);
+   std::vector<uint8_t> expected = bs.splice();
+   ASSERT_THAT(expected.size(), size_t { 20 });
+   EXPECT_THAT(bs.spliceAndClear(), Eq(expected));
+   EXPECT_THAT(bs.splice(), IsEmpty());
+}
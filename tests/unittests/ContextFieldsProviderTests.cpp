@@ -133,6 +133,63 @@ TEST(ContextFieldsProviderTests, UsesPalValues)
     EXPECT_THAT(record.extOs[0].ver, Not(IsEmpty()));
 }
 
+TEST(ContextFieldsProviderTests, ReflectsChangesAfterFirstEvent)
+{
+    ContextFieldsProvider ctx(nullptr);
+    ctx.SetAppId("appId");
+    ctx.SetDeviceId("{deviceId}");
+    ctx.SetCustomField("custom", "first");
+
+    ::CsProtocol::Record record;
+    ctx.writeToRecord(record);
+    EXPECT_THAT(record.extApp[0].id, Eq("appId"));
+    EXPECT_THAT(record.extApp[0].name, Eq("appId"));
+    EXPECT_THAT(record.extDevice[0].localId, Eq("c:deviceId"));
+    EXPECT_THAT(record.data[0].properties["custom"].stringValue, Eq("first"));
+    EXPECT_THAT(record.extProtocol, SizeIs(1));
+
+    ctx.SetAppId("appId2");
+    ctx.SetCommonField(COMMONFIELDS_APP_NAME, "appName");
+    ctx.SetCustomField("custom", "second");
+    ctx.SetCustomField("number", EventProperty(int64_t { 42 }));
+    ctx.SetTicket(TicketType_MSA_Device, "ticket");
+    ctx.GetCustomFields()["direct"] = EventProperty("direct");
+
+    ::CsProtocol::Record record1;
+    ctx.writeToRecord(record1);
+    EXPECT_THAT(record1.extApp[0].id, Eq("appId2"));
+    EXPECT_THAT(record1.extApp[0].name, Eq("appName"));
+    EXPECT_THAT(record1.extDevice[0].localId, Eq("c:deviceId"));
+    EXPECT_THAT(record1.data[0].properties["custom"].stringValue, Eq("second"));
+    EXPECT_THAT(record1.data[0].properties["number"].longValue, Eq(42));
+    EXPECT_THAT(record1.data[0].properties["direct"].stringValue, Eq("direct"));
+    ASSERT_THAT(record1.extProtocol, SizeIs(2));
+    EXPECT_THAT(record1.extProtocol[1].ticketKeys[0], ElementsAre("ticket"));
+
+    ::CsProtocol::Record record2;
+    ctx.writeToRecord(record2, true);
+    EXPECT_THAT(record2.extApp[0].id, Eq("appId2"));
+    EXPECT_THAT(record2.data[0].properties.count("custom"), Eq(0u));
+}
+
+TEST(ContextFieldsProviderTests, ReflectsWritesThroughFieldReference)
+{
+    ContextFieldsProvider ctx;
+    auto& fields = ctx.GetCustomFields();
+    fields["direct"] = EventProperty("first");
+
+    ::CsProtocol::Record record;
+    ctx.writeToRecord(record);
+    EXPECT_THAT(record.data[0].properties["direct"].stringValue, Eq("first"));
+
+    // Written after the template was built, through the reference kept above
+    fields["direct"] = EventProperty("second");
+
+    ::CsProtocol::Record record1;
+    ctx.writeToRecord(record1);
+    EXPECT_THAT(record1.data[0].properties["direct"].stringValue, Eq("second"));
+}
+
 class TestContextFieldsProvider : public ContextFieldsProvider
 {
 public:
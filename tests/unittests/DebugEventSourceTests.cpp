@@ -218,3 +218,37 @@ TEST(DebugEventSourceTests, DispatchEvent_OneEventToCascadedAndToSource_Listener
 }
 
 
+
+TEST(DebugEventSourceTests, DispatchEvent_NoListenerForType_SkipsDispatch)
+{
+   TestDebugEventSource source;
+   TestDebugEventListener listener;
+   source.AddEventListener(EVT_NET_CHANGED, listener);
+   EXPECT_FALSE(source.DispatchEvent(DebugEvent { EVT_TICKET_EXPIRED }));
+   EXPECT_EQ(source.seq, uint64_t { 0 });
+   EXPECT_TRUE(source.DispatchEvent(DebugEvent { EVT_NET_CHANGED }));
+   EXPECT_EQ(source.seq, uint64_t { 1 });
+
+   source.RemoveEventListener(EVT_NET_CHANGED, listener);
+   EXPECT_FALSE(source.DispatchEvent(DebugEvent { EVT_NET_CHANGED }));
+   EXPECT_EQ(source.seq, uint64_t { 1 });
+}
+
+TEST(DebugEventSourceTests, DispatchEvent_ListenerOnlyOnCascaded_ListenerSeesEvent)
+{
+   TestDebugEventSource source;
+   TestDebugEventSource cascadedSource;
+   TestDebugEventListener listener;
+   size_t count {};
+   listener.OnDebugEventOverride = [&count](DebugEvent&) noexcept { count++; };
+   source.AttachEventSource(cascadedSource);
+   cascadedSource.AddEventListener(EVT_REJECTED, listener);
+
+   source.DispatchEvent(DebugEvent { EVT_REJECTED });
+   EXPECT_EQ(count, size_t { 1 });
+
+   cascadedSource.RemoveEventListener(EVT_REJECTED, listener);
+   source.DispatchEvent(DebugEvent { EVT_REJECTED });
+   EXPECT_EQ(count, size_t { 1 });
+   EXPECT_EQ(source.seq, uint64_t { 1 });
+}
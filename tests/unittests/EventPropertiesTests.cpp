@@ -241,3 +241,29 @@ TEST(EventPropertiesTests, TryGetLevel_ValueSetBySetLevel_ReturnsTrueAndCorrectV
     EXPECT_TRUE(std::get<0>(result));
     EXPECT_EQ(std::get<1>(result), 42);
 }
+
+TEST(EventPropertiesTests, SetProperty_OverwritesExistingValue)
+{
+    EventProperties ep("test");
+    ep.SetProperty("key", "first");
+    ep.SetProperty("key", static_cast<int64_t>(42), PiiKind_None, DataCategory_PartB);
+    ep += std::map<std::string, EventProperty>{ { "other", EventProperty("value") } };
+    EXPECT_THAT(ep.GetProperties(), SizeIs(3));
+    EXPECT_THAT(ep.GetProperties(), Contains(Pair("key", EventProperty(static_cast<int64_t>(42)))));
+    EXPECT_THAT(ep.GetProperties().at("key").dataCategory, DataCategory_PartB);
+    EXPECT_THAT(ep.GetProperties(), Contains(Pair("other", EventProperty("value"))));
+}
+
+TEST(EventPropertiesTests, EventPropertyMove_TakesOverValue)
+{
+    EventProperty source("a string value", PiiKind_GenericData);
+    EventProperty moved(std::move(source));
+    EXPECT_THAT(moved, Eq(EventProperty("a string value", PiiKind_GenericData)));
+    EXPECT_THAT(source.type, EventProperty::TYPE_INT64);
+
+    std::vector<std::string> values{ "a", "b" };
+    EventProperty assigned(values);
+    assigned = std::move(moved);
+    EXPECT_THAT(assigned, Eq(EventProperty("a string value", PiiKind_GenericData)));
+    EXPECT_THAT(moved.type, EventProperty::TYPE_INT64);
+}
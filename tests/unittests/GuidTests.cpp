@@ -4,9 +4,15 @@
 //
 
 #include "common/Common.hpp"
+#include "utils/StringUtils.hpp"
 #include "utils/Utils.hpp"
+#include "pal/PAL.hpp"
 #include "EventProperties.hpp"
 
+#include <mutex>
+#include <set>
+#include <thread>
+
 using namespace testing;
 using namespace MAT;
 
@@ -57,3 +63,54 @@ TEST(GuidTests, Ctor_InputIsTooLong_IgnoresExtraData)
     ASSERT_EQ("9D016D64-372E-4DCE-9FA3-0D0772217C54", guid.to_string());
 }
 
+TEST(GuidTests, GenerateUuidString_ReturnsWellFormedRandomUuid)
+{
+    for (int i = 0; i < 100; i++)
+    {
+        std::string uuid = PAL::generateUuidString();
+        ASSERT_EQ(36u, uuid.length());
+
+        std::string mask = uuid;
+        for (char& ch : mask)
+        {
+            if (::isxdigit(ch))
+            {
+                ch = 'x';
+            }
+        }
+        EXPECT_EQ("xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx", mask);
+        EXPECT_EQ(toUpper(uuid), GUID_t(uuid.c_str()).to_string());
+#ifndef _WIN32
+        EXPECT_EQ('4', uuid[14]);
+        EXPECT_NE(std::string("89ab").find(uuid[19]), std::string::npos);
+#endif
+    }
+}
+
+TEST(GuidTests, GenerateUuidString_NoCollisionsAcrossThreads)
+{
+    const size_t threadCount = 8;
+    const size_t perThread = 20000;
+    std::mutex lock;
+    std::set<std::string> all;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([&]()
+        {
+            std::vector<std::string> ids;
+            ids.reserve(perThread);
+            for (size_t i = 0; i < perThread; i++)
+            {
+                ids.push_back(PAL::generateUuidString());
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            all.insert(ids.begin(), ids.end());
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_EQ(threadCount * perThread, all.size());
+}
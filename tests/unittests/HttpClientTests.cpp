@@ -2,6 +2,7 @@
 // Copyright (c) 2015-2020 Microsoft Corporation and Contributors.
 // SPDX-License-Identifier: Apache-2.0
 //
+#include "mat/config.h"
 #ifdef HAVE_MAT_DEFAULT_HTTP_CLIENT
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers
@@ -9,6 +10,9 @@
 #include "common/Common.hpp"
 #include "common/HttpServer.hpp"
 #include "http/HttpClientFactory.hpp"
+#if defined(__linux__) && !defined(ANDROID)
+#include "http/HttpClient_CurlMulti.hpp"
+#endif
 
 using namespace testing;
 using namespace MAT;
@@ -345,5 +349,126 @@ TEST_F(HttpClientTests, SurvivesManyRequests)
     EXPECT_THAT(it, _countedRequests.end());
 
 }
-#endif // HAVE_MAT_DEFAULT_HTTP_CLIENT
+#if defined(__linux__) && !defined(ANDROID)
+
+class HttpClientCurlMultiTests : public HttpClientTests
+{
+  public:
+    HttpClientCurlMultiTests()
+    {
+        _client = std::make_shared<HttpClient_CurlMulti>();
+    }
+
+    // Responses arrive on the client's worker thread
+    std::vector<IHttpResponse*> responses()
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        return _responses;
+    }
+
+    void waitForResponses(size_t count)
+    {
+        for (int i = 0; i < 200 && responses().size() < count; i++) {
+            PAL::sleep(50);
+        }
+    }
+};
+
+TEST_F(HttpClientCurlMultiTests, HandlesPostRequest)
+{
+    Clear();
+    std::unique_ptr<IHttpRequest> request(_client->CreateRequest());
+    std::string requestId = request->GetId();
+    request->SetMethod("POST");
+    request->GetHeaders().set("Content-Type", "application/octet-stream");
+    request->SetUrl("http://" + _hostname + "/echo/");
+    auto body = Binary("Some\xBB\x11naryContent");
+    request->SetBody(body);
+    _client->SendRequestAsync(request.release(), this);
 
+    waitForResponses(1);
+    auto received = responses();
+    ASSERT_THAT(received.size(), 1u);
+    std::unique_ptr<IHttpResponse> _response(received[0]);
+    EXPECT_THAT(_response->GetId(), requestId);
+    EXPECT_THAT(_response->GetResult(), HttpResult_OK);
+    EXPECT_THAT(_response->GetStatusCode(), 200u);
+    EXPECT_THAT(_response->GetHeaders().get("Host"), _hostname);
+    EXPECT_THAT(_response->GetHeaders().get("Content-Type"), Eq("application/octet-stream"));
+    EXPECT_THAT(_response->GetBody(), Eq(Binary("Some\xBB\x11naryContent")));
+    _response.release();
+}
+
+TEST_F(HttpClientCurlMultiTests, HandlesErrorsAndCancellation)
+{
+    Clear();
+    std::unique_ptr<IHttpRequest> local(_client->CreateRequest());
+    std::string localId = local->GetId();
+    local->SetUrl("://trololo!");
+    _client->SendRequestAsync(local.release(), this);
+    waitForResponses(1);
+    auto received = responses();
+    ASSERT_THAT(received.size(), 1u);
+    EXPECT_THAT(received[0]->GetId(), localId);
+    EXPECT_THAT(received[0]->GetResult(), HttpResult_LocalFailure);
+
+    std::unique_ptr<IHttpRequest> refused(_client->CreateRequest());
+    refused->SetUrl("http://localhost:4");
+    _client->SendRequestAsync(refused.release(), this);
+    waitForResponses(2);
+    received = responses();
+    ASSERT_THAT(received.size(), 2u);
+    EXPECT_THAT(received[1]->GetResult(), HttpResult_NetworkFailure);
+
+    std::unique_ptr<IHttpRequest> cancelled(_client->CreateRequest());
+    std::string cancelledId = cancelled->GetId();
+    cancelled->SetUrl("http://" + _hostname + "/echo/");
+    _client->SendRequestAsync(cancelled.release(), this);
+    _client->CancelRequestAsync(cancelledId);
+    waitForResponses(3);
+    received = responses();
+    ASSERT_THAT(received.size(), 3u);
+    EXPECT_THAT(received[2]->GetId(), cancelledId);
+    EXPECT_THAT(received[2]->GetResult(), HttpResult_Aborted);
+}
+
+TEST_F(HttpClientCurlMultiTests, SurvivesManyRequestsAndReusesHandles)
+{
+    Clear();
+
+    size_t Count = 100;
+    // Sized up front: the server thread marks entries while requests go out
+    _countedRequests.assign(Count, Sent);
+    for (size_t i = 0; i < Count; i++) {
+        IHttpRequest* request = _client->CreateRequest();
+        request->SetMethod("POST");
+        request->GetHeaders().set("content-type", "application/octet-stream");
+        std::ostringstream url;
+        url << "http://" << _hostname << "/count/" << i;
+        request->SetUrl(url.str());
+        auto body = Binary("content");
+        request->SetBody(body);
+        _client->SendRequestAsync(request, this);
+    }
+
+    waitForResponses(Count);
+    auto received = responses();
+    ASSERT_THAT(received.size(), Count);
+    for (auto &v : received)
+    {
+        EXPECT_THAT(v->GetResult(), HttpResult_OK);
+        int id = atoi(std::string(reinterpret_cast<char const*>(v->GetBody().data()), v->GetBody().size()).c_str());
+        _countedRequests[id] = Done;
+    }
+    auto it = std::find(_countedRequests.begin(), _countedRequests.end(), Sent);
+    EXPECT_THAT(it, _countedRequests.end());
+
+    // Every completed transfer returns its easy handle to the pool; the pool
+    // only grows to the peak number of concurrent transfers.
+    auto client = std::static_pointer_cast<HttpClient_CurlMulti>(_client);
+    EXPECT_THAT(client->GetPooledHandleCount(), Gt(0u));
+    EXPECT_THAT(client->GetPooledHandleCount(), Le(Count));
+}
+
+#endif
+#endif // HAVE_MAT_DEFAULT_HTTP_CLIENT
@@ -124,6 +124,73 @@ TEST_F(HttpDeflateCompressionTests, WorksMultipleTimes)
     }
 }
 
+TEST_F(HttpDeflateCompressionTests, ReusesStreamAcrossPackagesOfDifferentSizes)
+{
+    config[CFG_MAP_HTTP][CFG_BOOL_HTTP_COMPRESSION] = true;
+    for (size_t size : { 100000, 10, 0, 5000, 250000, 1 }) {
+        std::vector<uint8_t> payload(size);
+        for (size_t i = 0; i < size; i++) {
+            payload[i] = static_cast<uint8_t>((i * 7) % 13 + (i / 1000));
+        }
+
+        EventsUploadContextPtr event = std::make_shared<EventsUploadContext>();
+        event->body = payload;
+        EXPECT_CALL(*this, resultSucceeded(event)).Times(1);
+        input(event);
+        EXPECT_THAT(event->compressed, true);
+
+        std::vector<uint8_t> inflated;
+        ZlibUtils::InflateVector(event->body, inflated, false);
+        EXPECT_THAT(inflated, Eq(payload));
+    }
+}
+
+TEST_F(HttpDeflateCompressionTests, HonorsLevelAndStrategy)
+{
+    config[CFG_MAP_HTTP][CFG_BOOL_HTTP_COMPRESSION] = true;
+    std::vector<uint8_t> payload(10000, 42);
+
+    config[CFG_MAP_HTTP][CFG_INT_HTTP_COMPRESSION_LEVEL] = 0;
+    EventsUploadContextPtr stored = std::make_shared<EventsUploadContext>();
+    stored->body = payload;
+    EXPECT_CALL(*this, resultSucceeded(stored)).Times(1);
+    input(stored);
+    EXPECT_THAT(stored->body, SizeIs(Gt(payload.size())));
+
+    config[CFG_MAP_HTTP][CFG_INT_HTTP_COMPRESSION_LEVEL] = 9;
+    config[CFG_MAP_HTTP][CFG_INT_HTTP_COMPRESSION_STRATEGY] = Z_RLE;
+    EventsUploadContextPtr rle = std::make_shared<EventsUploadContext>();
+    rle->body = payload;
+    EXPECT_CALL(*this, resultSucceeded(rle)).Times(1);
+    input(rle);
+    EXPECT_THAT(rle->body, SizeIs(Lt(payload.size() / 10)));
+
+    for (auto const& event : { stored, rle }) {
+        std::vector<uint8_t> inflated;
+        ZlibUtils::InflateVector(event->body, inflated, false);
+        EXPECT_THAT(inflated, Eq(payload));
+    }
+}
+
+TEST_F(HttpDeflateCompressionTests, FailsOnInvalidLevel)
+{
+    config[CFG_MAP_HTTP][CFG_BOOL_HTTP_COMPRESSION] = true;
+    config[CFG_MAP_HTTP][CFG_INT_HTTP_COMPRESSION_LEVEL] = 42;
+    EventsUploadContextPtr event = std::make_shared<EventsUploadContext>();
+    event->body = testPayload;
+    EXPECT_CALL(*this, resultFailed(event)).Times(1);
+    input(event);
+    EXPECT_THAT(event->body, Eq(testPayload));
+    EXPECT_THAT(event->compressed, false);
+
+    config[CFG_MAP_HTTP][CFG_INT_HTTP_COMPRESSION_LEVEL] = -1;
+    EventsUploadContextPtr event2 = std::make_shared<EventsUploadContext>();
+    event2->body = testPayload;
+    EXPECT_CALL(*this, resultSucceeded(event2)).Times(1);
+    input(event2);
+    EXPECT_THAT(event2->compressed, true);
+}
+
 #pragma warning(push)
 #pragma warning(disable:4125)
 TEST_F(HttpDeflateCompressionTests, HasReasonableCompressionRatio)
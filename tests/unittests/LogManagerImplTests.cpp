@@ -4,6 +4,8 @@
 //
 #include "api/LogManagerImpl.hpp"
 #include "common/Common.hpp"
+#include <atomic>
+#include <thread>
 
 using namespace testing;
 using namespace MAT;
@@ -21,6 +23,7 @@ class TestLogManagerImpl : public LogManagerImpl
     }
 
     using LogManagerImpl::m_httpClient;
+    using LogManagerImpl::m_config;
     // using LogManagerImpl::m_ownHttpClient;
     using LogManagerImpl::InitializeModules;
     using LogManagerImpl::m_modules;
@@ -65,6 +68,29 @@ TEST(LogManagerImplTests, Constructor_HttpClientIsNotNullptr_HttpClientIsSet)
     ASSERT_EQ(logManager.m_httpClient, httpClient);
 }
 
+TEST(LogManagerImplTests, Configure_PublishesRuntimeConfigSnapshot)
+{
+    ILogConfiguration configuration;
+    configuration[CFG_INT_MAX_PENDING_REQ] = 2;
+    configuration.AddModule(CFG_MODULE_HTTP_CLIENT, std::make_shared<TestHttpClient>());
+    TestLogManagerImpl logManager{configuration, true};
+
+    auto initial = logManager.m_config->GetSnapshot();
+    EXPECT_THAT(initial->maxPendingRequests, 2u);
+    EXPECT_THAT(initial->maxBlobBytes, static_cast<uint32_t>(configuration[CFG_MAP_TPM][CFG_INT_TPM_MAX_BLOB_BYTES]));
+    EXPECT_THAT(initial->metaStatsTenantToken, Eq(logManager.m_config->GetMetaStatsTenantToken()));
+
+    // Changes are published only on Configure()
+    configuration[CFG_INT_MAX_PENDING_REQ] = 8;
+    EXPECT_THAT(logManager.m_config->GetSnapshot()->maxPendingRequests, 2u);
+    logManager.Configure();
+    EXPECT_THAT(logManager.m_config->GetSnapshot()->maxPendingRequests, 8u);
+
+    // Earlier snapshots stay valid for readers still holding them
+    EXPECT_THAT(initial->maxPendingRequests, 2u);
+    EXPECT_THAT(logManager.m_config->GetSnapshot(), Ne(initial));
+}
+
 TEST(LogManagerImplTests, DeadLoggersAreDead)
 {
     ILogConfiguration configuration;
@@ -153,3 +179,124 @@ TEST(LogManagerImplTests, Constructor_DataViewerCollectionIsNotNullptr_DataViewe
     ASSERT_NO_THROW(logManager.GetDataViewerCollection());
 }
 
+
+class CountingDecorator : public IDecoratorModule
+{
+   public:
+    std::atomic<size_t> count{0};
+    virtual bool decorate(::CsProtocol::Record&) override
+    {
+        count++;
+        return true;
+    }
+};
+
+TEST(LogManagerImplTests, SendEvent_ConcurrentLoggers_AllEventsDecorated)
+{
+    ILogConfiguration configuration;
+    auto httpClient = std::make_shared<TestHttpClient>();
+    httpClient->theOnlyRequest = new SimpleHttpRequest("fred");
+    auto decorator = std::make_shared<CountingDecorator>();
+    configuration.AddModule(CFG_MODULE_HTTP_CLIENT, httpClient);
+    configuration.AddModule(CFG_MODULE_DECORATOR, decorator);
+    configuration[CFG_INT_MAX_TEARDOWN_TIME] = 0;
+    TestLogManagerImpl logManager{configuration};
+    logManager.PauseTransmission();
+    auto logger = logManager.GetLogger("fred");
+
+    const size_t numThreads = 8;
+    const size_t numEvents = 250;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < numThreads; i++)
+    {
+        threads.emplace_back([logger, numEvents]() {
+            for (size_t j = 0; j < numEvents; j++)
+            {
+                logger->LogEvent("ConcurrentEvent");
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    logManager.FlushAndTeardown();
+    EXPECT_EQ(numThreads * numEvents, decorator->count.load());
+}
+
+class CapturingDecorator : public IDecoratorModule
+{
+   public:
+    std::string value;
+    virtual bool decorate(::CsProtocol::Record& record) override
+    {
+        auto it = record.data[0].properties.find("key");
+        if (it != record.data[0].properties.end())
+        {
+            value = it->second.stringValue;
+        }
+        return true;
+    }
+};
+
+TEST(LogManagerImplTests, SendEvent_DecoratorModule_SeesEventProperties)
+{
+    ILogConfiguration configuration;
+    auto httpClient = std::make_shared<TestHttpClient>();
+    httpClient->theOnlyRequest = new SimpleHttpRequest("fred");
+    auto decorator = std::make_shared<CapturingDecorator>();
+    configuration.AddModule(CFG_MODULE_HTTP_CLIENT, httpClient);
+    configuration.AddModule(CFG_MODULE_DECORATOR, decorator);
+    configuration[CFG_INT_MAX_TEARDOWN_TIME] = 0;
+    TestLogManagerImpl logManager{configuration};
+    logManager.PauseTransmission();
+
+    EventProperties props("Test.Event");
+    props.SetProperty("key", "value");
+    logManager.GetLogger("fred")->LogEvent(props);
+    logManager.FlushAndTeardown();
+    EXPECT_EQ("value", decorator->value);
+}
+
+TEST(DiagLevelFilterTests, DefaultFilter_IsDisabledAndAllowsDefaultRange)
+{
+    DiagLevelFilter filter;
+    EXPECT_FALSE(filter.IsLevelFilterEnabled());
+    EXPECT_TRUE(filter.IsLevelEnabled(DIAG_LEVEL_DEFAULT_MIN));
+    EXPECT_TRUE(filter.IsLevelEnabled(DIAG_LEVEL_DEFAULT_MAX));
+    EXPECT_FALSE(filter.IsLevelEnabled(DIAG_LEVEL_DEFAULT_MAX + 1));
+}
+
+TEST(DiagLevelFilterTests, SetFilter_Range_AllowsOnlyLevelsInRange)
+{
+    DiagLevelFilter filter;
+    filter.SetFilter(DIAG_LEVEL_DEFAULT, 3, 255);
+    EXPECT_TRUE(filter.IsLevelFilterEnabled());
+    EXPECT_FALSE(filter.IsLevelEnabled(2));
+    EXPECT_TRUE(filter.IsLevelEnabled(3));
+    EXPECT_TRUE(filter.IsLevelEnabled(255));
+
+    filter.SetFilter(DIAG_LEVEL_DEFAULT, 5, 4);
+    EXPECT_FALSE(filter.IsLevelEnabled(4));
+    EXPECT_FALSE(filter.IsLevelEnabled(5));
+}
+
+TEST(DiagLevelFilterTests, SetFilter_Set_TakesPrecedenceUntilCleared)
+{
+    DiagLevelFilter filter;
+    filter.SetFilter(DIAG_LEVEL_REQUIRED, { 1, 7 });
+    EXPECT_TRUE(filter.IsLevelFilterEnabled());
+    EXPECT_THAT(filter.GetDefaultLevel(), Eq(DIAG_LEVEL_REQUIRED));
+    EXPECT_TRUE(filter.IsLevelEnabled(1));
+    EXPECT_FALSE(filter.IsLevelEnabled(2));
+    EXPECT_TRUE(filter.IsLevelEnabled(7));
+
+    // A range does not replace an explicit set of levels
+    filter.SetFilter(DIAG_LEVEL_REQUIRED, 1, 3);
+    EXPECT_FALSE(filter.IsLevelEnabled(2));
+
+    // An empty set falls back to the range
+    filter.SetFilter(DIAG_LEVEL_REQUIRED, std::set<uint8_t>{});
+    EXPECT_TRUE(filter.IsLevelEnabled(2));
+    EXPECT_FALSE(filter.IsLevelEnabled(7));
+}
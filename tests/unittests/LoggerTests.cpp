@@ -5,6 +5,10 @@
 #include "common/Common.hpp"
 #include "api/Logger.hpp"
 
+#include <atomic>
+#include <functional>
+#include <thread>
+
 using namespace testing;
 using namespace MAT;
 
@@ -19,11 +23,57 @@ public:
         IRuntimeConfig& runtimeConfig) noexcept
         : Logger(tenantToken, source, scope, logManager, parentContext, runtimeConfig) { }
     using Logger::CanEventPropertiesBeSent;
+    using Logger::resetRecord;
 
     bool SubmitCalled = {};
-    void submit(::CsProtocol::Record&, const EventProperties&) override
+    bool PropertiesDeferred = {};
+    ::CsProtocol::Record LastRecord;
+    ::CsProtocol::Record const* LastRecordAddress = {};
+    void const* LastExtAppBuffer = {};
+    std::function<void()> OnSubmit;
+    void submit(::CsProtocol::Record& record, const EventProperties& props, bool deferProperties) override
     {
         SubmitCalled = true;
+        PropertiesDeferred = deferProperties;
+        LastRecord = record;
+        LastRecordAddress = &record;
+        LastExtAppBuffer = record.extApp.data();
+        if (OnSubmit)
+        {
+            auto onSubmit = std::move(OnSubmit);
+            OnSubmit = nullptr;
+            onSubmit();
+        }
+        if (deferProperties)
+        {
+            // Same as LogManagerImpl::sendEvent does for code that inspects the record
+            EventPropertiesDecorator::decorateProperties(LastRecord, props);
+        }
+    }
+};
+
+class TestLogManager : public LogManagerImpl
+{
+public:
+    TestLogManager(ILogConfiguration& configuration)
+        : LogManagerImpl(configuration) { }
+
+    std::function<void()> OnSendEvent;
+    void sendEvent(IncomingEventContextPtr const& event) override
+    {
+        if (OnSendEvent)
+        {
+            OnSendEvent();
+        }
+        LogManagerImpl::sendEvent(event);
+    }
+
+    status_t AdmitResult = STATUS_SUCCESS;
+    std::vector<bool> AdmitMayBlock;
+    status_t admitEvent(std::string const&, EventLatency, EventPersistence, bool mayBlock) override
+    {
+        AdmitMayBlock.push_back(mayBlock);
+        return AdmitResult;
     }
 };
 
@@ -37,7 +87,7 @@ public:
     { }
 
     ILogConfiguration configuration;
-    LogManagerImpl logManager;
+    TestLogManager logManager;
     ContextFieldsProvider contextFieldsProvider;
     RuntimeConfig_Default runtimeConfig;
     TestLogger logger;
@@ -324,4 +374,276 @@ TEST_F(LoggerTests, LogSession_CanEventPropertiesBeSentReturnsTrue_CallsSubmit)
     EXPECT_TRUE(logger.SubmitCalled);
 }
 
+TEST_F(LoggerTests, LogEvent_DecoratesPartsBAndCAndCorrelationVector)
+{
+    EventProperties props("Test.Event");
+    props.SetProperty("partC", "valueC");
+    props.SetProperty("partB", "valueB", PiiKind_None, DataCategory_PartB);
+    props.SetProperty("count", int64_t { 7 });
+    props.SetProperty(CorrelationVector::PropertyName, "cv.1");
+    logger.LogEvent(props);
+
+    ASSERT_TRUE(logger.SubmitCalled);
+    // Deferred unless a listener left by another test is still registered
+    EXPECT_THAT(logger.PropertiesDeferred, Eq(!DebugEventSource::HasListeners(DebugEventType::EVT_LOG_EVENT)));
+    auto const& record = logger.LastRecord;
+    EXPECT_THAT(record.cV, Eq("cv.1"));
+    ASSERT_THAT(record.data, SizeIs(1));
+    EXPECT_THAT(record.data[0].properties.count(CorrelationVector::PropertyName), Eq(0u));
+    EXPECT_THAT(record.data[0].properties.at("partC").stringValue, Eq("valueC"));
+    EXPECT_THAT(record.data[0].properties.at("count").longValue, Eq(7));
+    ASSERT_THAT(record.baseData, SizeIs(1));
+    EXPECT_THAT(record.baseData[0].properties.at("partB").stringValue, Eq("valueB"));
+}
+
+TEST_F(LoggerTests, LogEvent_LogEventListener_AddsPropertiesToRecord)
+{
+    class NullListener : public DebugEventListener
+    {
+        void OnDebugEvent(DebugEvent&) override { }
+    } listener;
+    logManager.AddEventListener(DebugEventType::EVT_LOG_EVENT, listener);
+
+    EventProperties props("Test.Event");
+    props.SetProperty("partC", "valueC");
+    props.SetProperty(CorrelationVector::PropertyName, "cv.1");
+    logger.LogEvent(props);
+    logManager.RemoveEventListener(DebugEventType::EVT_LOG_EVENT, listener);
+
+    ASSERT_TRUE(logger.SubmitCalled);
+    EXPECT_FALSE(logger.PropertiesDeferred);
+    auto const& record = logger.LastRecord;
+    EXPECT_THAT(record.cV, Eq("cv.1"));
+    ASSERT_THAT(record.data, SizeIs(1));
+    EXPECT_THAT(record.data[0].properties.count(CorrelationVector::PropertyName), Eq(0u));
+    EXPECT_THAT(record.data[0].properties.at("partC").stringValue, Eq("valueC"));
+}
+
+TEST_F(LoggerTests, LogEvent_LogEventListenerAddedWhileSending_SeesProperties)
+{
+    class CapturingListener : public DebugEventListener
+    {
+    public:
+        std::map<std::string, ::CsProtocol::Value> Properties;
+        void OnDebugEvent(DebugEvent& evt) override
+        {
+            auto record = static_cast<::CsProtocol::Record*>(evt.data);
+            if (!record->data.empty())
+            {
+                Properties = record->data[0].properties;
+            }
+        }
+    } listener;
+    logManager.OnSendEvent = [this, &listener]() {
+        logManager.AddEventListener(DebugEventType::EVT_LOG_EVENT, listener);
+    };
+
+    Logger realLogger("", "", "", logManager, contextFieldsProvider, runtimeConfig);
+    EventProperties props("Test.Event");
+    props.SetProperty("partC", "valueC");
+    realLogger.LogEvent(props);
+    logManager.RemoveEventListener(DebugEventType::EVT_LOG_EVENT, listener);
+    logManager.OnSendEvent = nullptr;
+
+    ASSERT_THAT(listener.Properties.count("partC"), Eq(1u));
+    EXPECT_THAT(listener.Properties.at("partC").stringValue, Eq("valueC"));
+}
+
+TEST_F(LoggerTests, ResetRecord_RestoresDefaultsAndKeepsBuffers)
+{
+    ::CsProtocol::Record record;
+    record.ver = "4.0";
+    record.name = "A.Rather.Long.Event.Name.That.Does.Not.Fit.Inline";
+    record.time = 1;
+    record.popSample = 50;
+    record.iKey = "o:tenant";
+    record.flags = 2;
+    record.cV = "cv.1";
+    record.extProtocol.emplace_back();
+    record.extUser.emplace_back();
+    record.extDevice.emplace_back();
+    record.extOs.emplace_back();
+    record.extApp.emplace_back();
+    record.extUtc.emplace_back();
+    record.extNet.emplace_back();
+    record.extSdk.emplace_back();
+    record.extLoc.emplace_back();
+    record.extM365a.emplace_back();
+    record.ext.emplace_back();
+    record.tags["tag"] = "value";
+    record.baseType = "custom";
+    record.baseData.emplace_back();
+    record.data.emplace_back();
+    record.data[0].properties["partC"].stringValue = "valueC";
+    size_t const nameCapacity = record.name.capacity();
+    void const* extAppBuffer = record.extApp.data();
+
+    TestLogger::resetRecord(record);
+
+    EXPECT_TRUE(record == ::CsProtocol::Record());
+    EXPECT_THAT(record.name.capacity(), Eq(nameCapacity));
+    EXPECT_THAT(record.extApp.capacity(), Ge(1u));
+    record.extApp.emplace_back();
+    EXPECT_THAT(static_cast<void const*>(record.extApp.data()), Eq(extAppBuffer));
+}
+
+TEST_F(LoggerTests, LogEvent_ReusesRecordOfThread)
+{
+    EventProperties first("Test.First");
+    first.SetType("Custom.Type");
+    first.SetProperty("partC", "valueC");
+    first.SetProperty(CorrelationVector::PropertyName, "cv.1");
+    logger.LogEvent(first);
+    ASSERT_TRUE(logger.SubmitCalled);
+    auto firstAddress = logger.LastRecordAddress;
+    auto firstExtAppBuffer = logger.LastExtAppBuffer;
+
+    EventProperties second("Test.Second");
+    logger.LogEvent(second);
+
+    // Same record and extension buffers, without anything left from the first event
+    EXPECT_THAT(logger.LastRecordAddress, Eq(firstAddress));
+    EXPECT_THAT(logger.LastExtAppBuffer, Eq(firstExtAppBuffer));
+    auto const& record = logger.LastRecord;
+    EXPECT_THAT(record.name, Eq("Test.Second"));
+    EXPECT_THAT(record.baseType, Eq(EVENTRECORD_TYPE_CUSTOM_EVENT));
+    EXPECT_THAT(record.cV, Eq(""));
+    EXPECT_THAT(record.extApp, SizeIs(1));
+    for (auto const& data : record.data)
+    {
+        EXPECT_THAT(data.properties.count("partC"), Eq(0u));
+    }
+}
+
+TEST_F(LoggerTests, LogEvent_LoggedWhileSubmitting_GetsRecordOfItsOwn)
+{
+    ::CsProtocol::Record const* outerAddress = nullptr;
+    ::CsProtocol::Record const* nestedAddress = nullptr;
+    std::string outerName;
+    logger.OnSubmit = [this, &outerAddress, &nestedAddress, &outerName]() {
+        outerAddress = logger.LastRecordAddress;
+        logger.LogEvent("Test.Nested");
+        nestedAddress = logger.LastRecordAddress;
+        outerName = outerAddress->name;
+    };
+    logger.LogEvent("Test.Outer");
 
+    EXPECT_THAT(logger.LastRecord.name, Eq("Test.Nested"));
+    EXPECT_THAT(nestedAddress, Ne(outerAddress));
+    // The nested call leaves the outer record alone
+    EXPECT_THAT(outerName, Eq("Test.Outer"));
+}
+
+TEST_F(LoggerTests, LogEvent_LevelNotAllowed_DoesNotCallSubmit)
+{
+    logManager.SetLevelFilter(DIAG_LEVEL_OPTIONAL, { DIAG_LEVEL_REQUIRED });
+
+    EventProperties optional("Test.Optional");
+    optional.SetLevel(DIAG_LEVEL_OPTIONAL);
+    logger.LogEvent(optional);
+    EXPECT_FALSE(logger.SubmitCalled);
+
+    EventProperties inherited("Test.Inherited");
+    logger.LogEvent(inherited);
+    EXPECT_FALSE(logger.SubmitCalled);
+
+    EventProperties required("Test.Required");
+    required.SetLevel(DIAG_LEVEL_REQUIRED);
+    logger.LogEvent(required);
+    EXPECT_TRUE(logger.SubmitCalled);
+}
+
+TEST_F(LoggerTests, LogEvent_LatencyOff_DoesNotCallSubmit)
+{
+    EventProperties props("Test.Off");
+    props.SetLatency(EventLatency_Off);
+    logger.LogEvent(props);
+    EXPECT_FALSE(logger.SubmitCalled);
+}
+
+TEST_F(LoggerTests, TryLogEvent_Admitted_CallsSubmitWithoutBlocking)
+{
+    EXPECT_THAT(logger.TryLogEvent(EventProperties("Test.Try")), Eq(STATUS_SUCCESS));
+    EXPECT_TRUE(logger.SubmitCalled);
+    EXPECT_THAT(logManager.AdmitMayBlock, ElementsAre(false));
+}
+
+TEST_F(LoggerTests, TryLogEvent_IngestionLimitReached_ReturnsBusy)
+{
+    logManager.AdmitResult = STATUS_EBUSY;
+    EXPECT_THAT(logger.TryLogEvent(EventProperties("Test.Try")), Eq(STATUS_EBUSY));
+    EXPECT_FALSE(logger.SubmitCalled);
+}
+
+TEST_F(LoggerTests, TryLogEvent_LatencyOff_ReturnsPermissionDenied)
+{
+    EventProperties props("Test.Off");
+    props.SetLatency(EventLatency_Off);
+    EXPECT_THAT(logger.TryLogEvent(props), Eq(STATUS_EPERM));
+    EXPECT_FALSE(logger.SubmitCalled);
+    EXPECT_THAT(logManager.AdmitMayBlock, IsEmpty());
+}
+
+TEST_F(LoggerTests, LogPageView_IngestionLimitReached_DoesNotCallSubmit)
+{
+    logManager.AdmitResult = STATUS_EBUSY;
+    logger.LogPageView("id", "name", EventProperties("Test.PageView"));
+    EXPECT_FALSE(logger.SubmitCalled);
+    EXPECT_THAT(logManager.AdmitMayBlock, ElementsAre(true));
+}
+
+class ConcurrentLogger : public Logger
+{
+public:
+    ConcurrentLogger(ILogManagerInternal& logManager,
+        ContextFieldsProvider& parentContext,
+        IRuntimeConfig& runtimeConfig) noexcept
+        : Logger("", "", "", logManager, parentContext, runtimeConfig) { }
+
+    std::atomic<bool> ShutdownDone { false };
+    std::atomic<size_t> Submitted { 0 };
+    std::atomic<size_t> SubmittedAfterShutdown { 0 };
+    void submit(::CsProtocol::Record&, const EventProperties&, bool) override
+    {
+        Submitted++;
+        if (ShutdownDone)
+        {
+            SubmittedAfterShutdown++;
+        }
+    }
+};
+
+TEST_F(LoggerTests, RecordShutdown_WaitsForConcurrentCallsAndRejectsNewOnes)
+{
+    ConcurrentLogger shared(logManager, contextFieldsProvider, runtimeConfig);
+    std::atomic<bool> stop { false };
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 8; t++)
+    {
+        threads.emplace_back([&shared, &stop]() {
+            EventProperties props("Test.Concurrent");
+            while (!stop)
+            {
+                shared.LogEvent(props);
+            }
+        });
+    }
+
+    while (shared.Submitted < 1000)
+    {
+        std::this_thread::yield();
+    }
+    shared.RecordShutdown();
+    shared.ShutdownDone = true;
+    size_t submittedAtShutdown = shared.Submitted;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    stop = true;
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    EXPECT_THAT(shared.SubmittedAfterShutdown.load(), Eq(0u));
+    EXPECT_THAT(shared.Submitted.load(), Eq(submittedAtShutdown));
+}
@@ -100,7 +100,7 @@ size_t addEvents(MemoryStorage& storage)
         for (const EventLatency &lat : latencies)
         {
             StorageRecord record{ PAL::generateUuidString(), "token", lat, EventPersistence_Critical, INT64_MIN + 1, { 5, 4, 3, 2, 1 }, 77, INT64_MAX - 1 };
-            total_db_size += record.blob.size() + sizeof(record);
+            total_db_size += MemoryStorage::GetRecordSize(record);
             storage.StoreRecord(record);
         }
     }
@@ -270,6 +270,104 @@ TEST(MemoryStorageTests, GetAndReserveSome)
     EXPECT_EQ(totalCount - howMany, storage.GetRecordCount());
 }
 
+TEST(MemoryStorageTests, GetRecordsReturnsHighestLatencyFirstInStoreOrder)
+{
+    MemoryStorage storage(testLogManager, testConfig);
+    storage.StoreRecord(StorageRecord("n1", "token", EventLatency_Normal, EventPersistence_Normal, 1, { 1 }));
+    storage.StoreRecord(StorageRecord("r1", "token", EventLatency_RealTime, EventPersistence_Normal, 2, { 2 }));
+    storage.StoreRecord(StorageRecord("n2", "token", EventLatency_Normal, EventPersistence_Normal, 3, { 3 }));
+    storage.StoreRecord(StorageRecord("r2", "token", EventLatency_RealTime, EventPersistence_Normal, 4, { 4 }));
+
+    auto records = storage.GetRecords();
+    std::vector<StorageRecordId> ids;
+    for (auto const& record : records)
+    {
+        ids.push_back(record.id);
+    }
+    EXPECT_THAT(ids, ElementsAre("r1", "r2", "n1", "n2"));
+    EXPECT_THAT(storage.LastReadRecordCount(), 4u);
+    EXPECT_THAT(storage.GetSize(), 0);
+}
+
+TEST(MemoryStorageTests, ReleasedRecordsGoBackInTimestampOrder)
+{
+    MemoryStorage storage(testLogManager, testConfig);
+    storage.StoreRecord(StorageRecord("n1", "token", EventLatency_Normal, EventPersistence_Normal, 1, { 1 }));
+    storage.StoreRecord(StorageRecord("n2", "token", EventLatency_Normal, EventPersistence_Normal, 2, { 2 }));
+    storage.StoreRecord(StorageRecord("n3", "token", EventLatency_Normal, EventPersistence_Normal, 3, { 3 }));
+    storage.StoreRecord(StorageRecord("r1", "token", EventLatency_RealTime, EventPersistence_Normal, 4, { 4 }));
+    storage.GetAndReserveRecords([](StorageRecord&&) { return true; }, 1000);
+
+    // Stored while the others are in flight
+    storage.StoreRecord(StorageRecord("n4", "token", EventLatency_Normal, EventPersistence_Normal, 5, { 5 }));
+
+    HttpHeaders headers;
+    bool fromMemory = true;
+    storage.ReleaseRecords(std::vector<StorageRecordId>{ "n3", "n1" }, false, headers, fromMemory);
+    storage.ReleaseAllRecords();
+    EXPECT_THAT(storage.GetReservedCount(), 0);
+
+    std::vector<StorageRecordId> ids;
+    for (auto const& record : storage.GetRecords())
+    {
+        ids.push_back(record.id);
+    }
+    EXPECT_THAT(ids, ElementsAre("r1", "n1", "n2", "n3", "n4"));
+    EXPECT_THAT(storage.GetSize(), 0);
+}
+
+TEST(MemoryStorageTests, DeleteRecordsRemovesReservedAndQueuedRecords)
+{
+    MemoryStorage storage(testLogManager, testConfig);
+    storage.StoreRecord(StorageRecord("a", "token", EventLatency_Normal, EventPersistence_Normal, 1, { 1 }));
+    storage.StoreRecord(StorageRecord("b", "token", EventLatency_Normal, EventPersistence_Normal, 2, { 2 }));
+    StorageRecord queued("c", "token", EventLatency_RealTime, EventPersistence_Normal, 3, { 3, 3 });
+    storage.StoreRecord(queued);
+
+    // Reserves "c" only
+    storage.GetAndReserveRecords([](StorageRecord&&) { return true; }, 1000, EventLatency_RealTime);
+    EXPECT_THAT(storage.GetReservedCount(), 1u);
+
+    HttpHeaders headers;
+    bool fromMemory = true;
+    storage.DeleteRecords(std::vector<StorageRecordId>{ "c", "a", "unknown" }, headers, fromMemory);
+    EXPECT_THAT(storage.GetReservedCount(), 0);
+    EXPECT_THAT(storage.GetRecordCount(), 1u);
+
+    storage.DeleteRecords(std::vector<StorageRecordId>{ "b" }, headers, fromMemory);
+    EXPECT_THAT(storage.GetRecordCount(), 0);
+    EXPECT_THAT(storage.GetSize(), 0);
+}
+
+TEST(MemoryStorageTests, StoreRecordDuringFlushKeepsAllRecords)
+{
+    MemoryStorage storage(testLogManager, testConfig);
+    constexpr size_t storeCount = 20000;
+    std::atomic<bool> storing(true);
+    size_t flushed = 0;
+
+    std::thread flusher([&storage, &storing, &flushed]()
+    {
+        while (storing)
+        {
+            flushed += storage.GetRecords().size();
+        }
+        flushed += storage.GetRecords().size();
+    });
+
+    for (size_t i = 0; i < storeCount; i++)
+    {
+        StorageRecord record{ PAL::generateUuidString(), "token", (i % 2) ? EventLatency_Normal : EventLatency_RealTime, EventPersistence_Normal, 1, { 1, 2, 3 } };
+        storage.StoreRecord(record);
+    }
+    storing = false;
+    flusher.join();
+
+    EXPECT_THAT(flushed, storeCount);
+    EXPECT_THAT(storage.GetRecordCount(), 0);
+    EXPECT_THAT(storage.GetSize(), 0);
+}
+
 // This method is not implemented for RAM storage
 TEST(MemoryStorageTests, StoreSetting)
 {
@@ -7,6 +7,8 @@
 #include "common/MockIRuntimeConfig.hpp"
 #include "stats/MetaStats.hpp"
 
+#include <thread>
+
 using namespace testing;
 using namespace MAT;
 
@@ -124,3 +126,75 @@ TEST_F(MetaStatsTests, NoNewDataOrMetastatsOnlyGenerateNoEvents)
     //EXPECT_THAT(events[0].Extension, Contains(Pair("requests_acked_succeeded", "1")));
 }
 
+
+static std::string getStatsValue(::CsProtocol::Record const& record, std::string const& key)
+{
+    auto const& properties = record.data[0].properties;
+    auto it = properties.find(key);
+    return (it == properties.end()) ? std::string() : it->second.stringValue;
+}
+
+TEST_F(MetaStatsTests, ConcurrentIncomingEventsAreAllCounted)
+{
+    EXPECT_CALL(runtimeConfigMock, GetMetaStatsSendIntervalSec()).WillRepeatedly(Return(0));
+    EXPECT_CALL(runtimeConfigMock, GetMetaStatsTenantToken()).WillRepeatedly(Return("metastats-tenant-token"));
+
+    const unsigned threadCount = 16;
+    const unsigned perThread = 10000;
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([this, t]() {
+            for (unsigned i = 0; i < perThread; i++)
+            {
+                stats.updateOnEventIncoming("t1", 100 + t, EventLatency_Normal, false);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    auto events = stats.generateStatsEvent(ACT_STATS_ROLLUP_KIND_ONGOING);
+    ASSERT_THAT(events, Not(IsEmpty()));
+    EXPECT_THAT(getStatsValue(events[0], "evt_rcv"), Eq(std::to_string(threadCount * perThread)));
+    EXPECT_THAT(getStatsValue(events[0], "ln_rcv"), Eq(std::to_string(threadCount * perThread)));
+    EXPECT_THAT(getStatsValue(events[0], "evt_bytes"), Eq(std::to_string(perThread * (threadCount * 100 + threadCount * (threadCount - 1) / 2))));
+    EXPECT_THAT(getStatsValue(events[0], "evt_bytes_min"), Eq("100"));
+    EXPECT_THAT(getStatsValue(events[0], "evt_bytes_max"), Eq(std::to_string(100 + threadCount - 1)));
+    EXPECT_THAT(getStatsValue(events[0], "evt_kb_0"), Eq(std::to_string(threadCount * perThread)));
+
+    // Counters are drained on rollup
+    events = stats.generateStatsEvent(ACT_STATS_ROLLUP_KIND_ONGOING);
+    EXPECT_THAT(events, IsEmpty());
+}
+
+TEST_F(MetaStatsTests, ReportsRecordSizeAndRttDistributions)
+{
+    EXPECT_CALL(runtimeConfigMock, GetMetaStatsSendIntervalSec()).WillRepeatedly(Return(0));
+    EXPECT_CALL(runtimeConfigMock, GetMetaStatsTenantToken()).WillRepeatedly(Return("metastats-tenant-token"));
+
+    stats.updateOnEventIncoming("t1", 100, EventLatency_Normal, false);
+    stats.updateOnEventIncoming("t1", 1500, EventLatency_Normal, false);
+    stats.updateOnEventIncoming("t1", 1800, EventLatency_RealTime, false);
+    stats.updateOnEventIncoming("t1", 100000, EventLatency_RealTime, false);
+
+    std::map<std::string, std::string> recordIdAndTenantid;
+    recordIdAndTenantid["r"] = "t1";
+    stats.updateOnPackageSentSucceeded(recordIdAndTenantid, EventLatency_Normal, 0, 50, std::vector<unsigned>{ 50 }, false);
+    stats.updateOnPackageSentSucceeded(recordIdAndTenantid, EventLatency_Normal, 0, 150, std::vector<unsigned>{ 150 }, false);
+    stats.updateOnPackageSentSucceeded(recordIdAndTenantid, EventLatency_RealTime, 0, 10000, std::vector<unsigned>{ 10000 }, false);
+
+    auto events = stats.generateStatsEvent(ACT_STATS_ROLLUP_KIND_ONGOING);
+    ASSERT_THAT(events, Not(IsEmpty()));
+    EXPECT_THAT(getStatsValue(events[0], "evt_kb_0"), Eq("1"));
+    EXPECT_THAT(getStatsValue(events[0], "evt_kb_1"), Eq("2"));
+    EXPECT_THAT(getStatsValue(events[0], "evt_kb_64"), Eq("1"));
+    EXPECT_THAT(getStatsValue(events[0], "rtt_ms_0"), Eq("1"));
+    EXPECT_THAT(getStatsValue(events[0], "rtt_ms_100"), Eq("1"));
+    EXPECT_THAT(getStatsValue(events[0], "rtt_ms_3200"), Eq("1"));
+    EXPECT_THAT(getStatsValue(events[0], "ln_rcv"), Eq("2"));
+    EXPECT_THAT(getStatsValue(events[0], "lr_rcv"), Eq("2"));
+    EXPECT_THAT(getStatsValue(events[0], "lr_bytes"), Eq("101800"));
+}
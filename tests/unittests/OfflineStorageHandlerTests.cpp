@@ -0,0 +1,380 @@
+//
+// Copyright (c) 2015-2020 Microsoft Corporation and Contributors.
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "common/Common.hpp"
+#include "common/MockIOfflineStorageObserver.hpp"
+#include "config/RuntimeConfig_Default.hpp"
+#include "offline/OfflineStorageHandler.hpp"
+
+#include "NullObjects.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <thread>
+
+using namespace testing;
+using namespace MAT;
+
+char const* const TEST_STORAGE_HANDLER_PATH = "OfflineStorageHandlerTests.db";
+
+/// <summary>
+/// Keeps the queued tasks without running them, so that the RAM queue is
+/// only flushed to disk when a test calls Flush().
+/// </summary>
+class IdleTaskDispatcher : public ITaskDispatcher
+{
+  public:
+    virtual void Join() override {}
+
+    virtual void Queue(Task* task) override
+    {
+        tasks.emplace_back(task);
+    }
+
+    virtual bool Cancel(Task* task, uint64_t waitTime = 0) override
+    {
+        UNREFERENCED_PARAMETER(task);
+        UNREFERENCED_PARAMETER(waitTime);
+        return true;
+    }
+
+    std::vector<std::unique_ptr<Task>> tasks;
+};
+
+class TestOfflineStorageHandler : public OfflineStorageHandler
+{
+  public:
+    using OfflineStorageHandler::OfflineStorageHandler;
+    using OfflineStorageHandler::m_flushLock;
+
+    size_t GetMemorySize()
+    {
+        return m_offlineStorageMemory->GetSize();
+    }
+
+    size_t GetMemoryRecordCount()
+    {
+        return m_offlineStorageMemory->GetRecordCount();
+    }
+};
+
+class OfflineStorageHandlerTests : public Test
+{
+  protected:
+    static constexpr size_t IngestionLimit = 16384;
+    static constexpr size_t BlobSize = 1000;
+
+    NullLogManager                              logManager;
+    ILogConfiguration                           configuration;
+    std::unique_ptr<RuntimeConfig_Default>      runtimeConfig;
+    IdleTaskDispatcher                          taskDispatcher;
+    NiceMock<MockIOfflineStorageObserver>       observer;
+    std::unique_ptr<TestOfflineStorageHandler>  handler;
+    size_t                                      shedCount = 0;
+
+    virtual void SetUp() override
+    {
+        removeFiles();
+        configuration[CFG_STR_CACHE_FILE_PATH] = TEST_STORAGE_HANDLER_PATH;
+        configuration[CFG_INT_RAM_QUEUE_SIZE] = 4096;
+        configuration[CFG_INT_INGESTION_LIMIT] = static_cast<int64_t>(IngestionLimit);
+        ON_CALL(observer, OnStorageRecordsShed(_)).WillByDefault(Invoke([this](std::map<std::string, size_t> const& numRecords) {
+            for (auto const& tenant : numRecords)
+            {
+                shedCount += tenant.second;
+            }
+        }));
+    }
+
+    virtual void TearDown() override
+    {
+        if (handler)
+        {
+            // Nothing runs the scheduled flush, Shutdown() would wait for it
+            handler->Flush();
+            handler->Shutdown();
+            handler.reset();
+        }
+        removeFiles();
+    }
+
+    static void removeFiles()
+    {
+        std::remove(TEST_STORAGE_HANDLER_PATH);
+        std::remove((std::string(TEST_STORAGE_HANDLER_PATH) + "-wal").c_str());
+        std::remove((std::string(TEST_STORAGE_HANDLER_PATH) + "-shm").c_str());
+    }
+
+    void open(char const* policy, unsigned blockTimeMs = 50)
+    {
+        configuration[CFG_STR_INGESTION_POLICY] = policy;
+        configuration[CFG_INT_INGESTION_BLOCK_TIME] = blockTimeMs;
+        runtimeConfig.reset(new RuntimeConfig_Default(configuration));
+        handler.reset(new TestOfflineStorageHandler(logManager, *runtimeConfig, taskDispatcher));
+        handler->Initialize(observer);
+    }
+
+    static StorageRecord makeRecord(EventLatency latency, EventPersistence persistence = EventPersistence_Normal)
+    {
+        return StorageRecord(PAL::generateUuidString(), "tenant-a", latency, persistence, PAL::getUtcSystemTimeMs(), std::vector<uint8_t>(BlobSize, 0xAB));
+    }
+
+    /// Admits the record the way Logger does before serialization, then stores it
+    status_t offer(StorageRecord const& record, bool mayBlock = false)
+    {
+        status_t result = handler->AdmitRecord(record.tenantToken, record.latency, record.persistence, mayBlock);
+        if (result == STATUS_SUCCESS)
+        {
+            handler->StoreRecord(record);
+        }
+        return result;
+    }
+
+    /// Stores records until the ingestion limit is reached
+    void fill(EventLatency latency, EventPersistence persistence = EventPersistence_Normal)
+    {
+        while (handler->GetMemorySize() < IngestionLimit)
+        {
+            ASSERT_THAT(offer(makeRecord(latency, persistence)), Eq(STATUS_SUCCESS));
+        }
+    }
+
+    std::vector<StorageRecord> takeAll()
+    {
+        std::vector<StorageRecord> records;
+        handler->GetAndReserveRecords([&records](StorageRecord&& record) {
+            records.push_back(std::move(record));
+            return true;
+        }, 0);
+        return records;
+    }
+
+    size_t takeOne()
+    {
+        size_t taken = 0;
+        handler->GetAndReserveRecords([&taken](StorageRecord&&) {
+            taken++;
+            return true;
+        }, 0, EventLatency_Unspecified, 1);
+        return taken;
+    }
+
+    /// <summary>
+    /// Offers ten events for each one the consumer takes, and checks that the
+    /// RAM queue never grows over the limit by more than the event admitted last.
+    /// </summary>
+    void expectBoundedUnderOverload()
+    {
+        size_t const maxRecordSize = MemoryStorage::GetRecordSize(makeRecord(EventLatency_Normal));
+        size_t offered = 0;
+        size_t admitted = 0;
+        size_t taken = 0;
+        size_t maxSize = 0;
+        for (int tick = 0; tick < 500; tick++)
+        {
+            for (int i = 0; i < 10; i++)
+            {
+                EventLatency latency = static_cast<EventLatency>(EventLatency_Normal + (offered % 3));
+                EventPersistence persistence = (offered % 5) ? EventPersistence_Normal : EventPersistence_Critical;
+                offered++;
+                if (offer(makeRecord(latency, persistence)) == STATUS_SUCCESS)
+                {
+                    admitted++;
+                }
+                maxSize = std::max(maxSize, handler->GetMemorySize());
+            }
+            taken += takeOne();
+        }
+
+        EXPECT_THAT(maxSize, Le(IngestionLimit + maxRecordSize));
+        EXPECT_THAT(taken, Eq(500u));
+        EXPECT_THAT(admitted, Ge(taken));
+        EXPECT_THAT(admitted, Lt(offered));
+
+        // Every event is either taken, still queued, or reported as shed
+        EXPECT_THAT(taken + handler->GetMemoryRecordCount() + shedCount, Eq(offered));
+    }
+};
+
+TEST_F(OfflineStorageHandlerTests, AdmitRecord_NoLimit_AdmitsEverything)
+{
+    configuration[CFG_INT_INGESTION_LIMIT] = 0;
+    open("DropNewest");
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_THAT(offer(makeRecord(EventLatency_Normal)), Eq(STATUS_SUCCESS));
+    }
+    EXPECT_THAT(handler->GetMemoryRecordCount(), Eq(100u));
+    EXPECT_THAT(shedCount, Eq(0u));
+}
+
+TEST_F(OfflineStorageHandlerTests, DropNewest_ShedsIncomingEvent)
+{
+    open("DropNewest");
+    fill(EventLatency_Normal);
+    size_t queued = handler->GetMemoryRecordCount();
+
+    EXPECT_CALL(observer, OnStorageRecordsShed(ElementsAre(Pair("tenant-a", 1))));
+    EXPECT_THAT(offer(makeRecord(EventLatency_Max, EventPersistence_Critical)), Eq(STATUS_EBUSY));
+    EXPECT_THAT(handler->GetMemoryRecordCount(), Eq(queued));
+
+    // Room is made by the consumer
+    takeOne();
+    EXPECT_THAT(offer(makeRecord(EventLatency_Normal)), Eq(STATUS_SUCCESS));
+}
+
+TEST_F(OfflineStorageHandlerTests, DropOldest_EvictsOldestOfLowestLatency)
+{
+    open("DropOldest");
+    StorageRecord oldest = makeRecord(EventLatency_Normal);
+    ASSERT_THAT(offer(oldest), Eq(STATUS_SUCCESS));
+    fill(EventLatency_Normal);
+    size_t queued = handler->GetMemoryRecordCount();
+
+    StorageRecord realTime = makeRecord(EventLatency_RealTime);
+    EXPECT_THAT(offer(realTime), Eq(STATUS_SUCCESS));
+    EXPECT_THAT(handler->GetMemoryRecordCount(), Eq(queued));
+    EXPECT_THAT(shedCount, Eq(1u));
+
+    auto records = takeAll();
+    ASSERT_THAT(records, SizeIs(queued));
+    EXPECT_THAT(records[0].id, Eq(realTime.id));
+    for (auto const& record : records)
+    {
+        EXPECT_THAT(record.id, Ne(oldest.id));
+    }
+}
+
+TEST_F(OfflineStorageHandlerTests, DropOldest_KeepsHigherLatencies)
+{
+    open("DropOldest");
+    fill(EventLatency_RealTime);
+    size_t queued = handler->GetMemoryRecordCount();
+
+    EXPECT_THAT(offer(makeRecord(EventLatency_Normal)), Eq(STATUS_EBUSY));
+    EXPECT_THAT(handler->GetMemoryRecordCount(), Eq(queued));
+    EXPECT_THAT(shedCount, Eq(1u));
+}
+
+TEST_F(OfflineStorageHandlerTests, DropByPersistence_EvictsNormalForCritical)
+{
+    open("DropByPersistence");
+    fill(EventLatency_RealTime, EventPersistence_Normal);
+    size_t queued = handler->GetMemoryRecordCount();
+
+    EXPECT_THAT(offer(makeRecord(EventLatency_Max, EventPersistence_Normal)), Eq(STATUS_EBUSY));
+    EXPECT_THAT(offer(makeRecord(EventLatency_Normal, EventPersistence_Critical)), Eq(STATUS_SUCCESS));
+    EXPECT_THAT(handler->GetMemoryRecordCount(), Eq(queued));
+    EXPECT_THAT(shedCount, Eq(2u));
+}
+
+TEST_F(OfflineStorageHandlerTests, DropByPersistence_KeepsCritical)
+{
+    open("DropByPersistence");
+    fill(EventLatency_Normal, EventPersistence_Critical);
+
+    EXPECT_THAT(offer(makeRecord(EventLatency_Max, EventPersistence_Critical)), Eq(STATUS_EBUSY));
+    for (auto const& record : takeAll())
+    {
+        EXPECT_THAT(record.persistence, Eq(EventPersistence_Critical));
+    }
+}
+
+TEST_F(OfflineStorageHandlerTests, Block_WaitsForFlush)
+{
+    open("Block", 10000);
+    fill(EventLatency_Normal);
+
+    // Never waits unless allowed to
+    EXPECT_THAT(offer(makeRecord(EventLatency_Normal), false), Eq(STATUS_EBUSY));
+
+    std::thread flusher([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        handler->Flush();
+    });
+    EXPECT_THAT(offer(makeRecord(EventLatency_Normal), true), Eq(STATUS_SUCCESS));
+    flusher.join();
+    EXPECT_THAT(handler->GetMemoryRecordCount(), Eq(1u));
+}
+
+TEST_F(OfflineStorageHandlerTests, Block_WaitsForFlushRunningWhenBlocked)
+{
+    open("Block", 10000);
+    // Leaves the flush event signalled
+    handler->Flush();
+
+    // Holds the flush lock as a running flush would, so ScheduleFlush() never
+    // gets to reset the event while the queue fills up and the producer blocks
+    std::mutex stepLock;
+    std::condition_variable stepChanged;
+    int step = 0;
+    auto advance = [&](int next) {
+        {
+            std::lock_guard<std::mutex> lock(stepLock);
+            step = next;
+        }
+        stepChanged.notify_all();
+    };
+    auto await = [&](int expected) {
+        std::unique_lock<std::mutex> lock(stepLock);
+        stepChanged.wait(lock, [&]() { return step >= expected; });
+    };
+    std::thread flusher([&]() {
+        {
+            std::lock_guard<std::mutex> flushing(handler->m_flushLock);
+            advance(1);
+            await(2);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        handler->Flush();
+    });
+
+    await(1);
+    fill(EventLatency_Normal);
+    advance(2);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_THAT(offer(makeRecord(EventLatency_Normal), true), Eq(STATUS_SUCCESS));
+    EXPECT_THAT(std::chrono::steady_clock::now() - start, Ge(std::chrono::milliseconds(40)));
+    flusher.join();
+    EXPECT_THAT(handler->GetMemoryRecordCount(), Eq(1u));
+    EXPECT_THAT(shedCount, Eq(0u));
+}
+
+TEST_F(OfflineStorageHandlerTests, Block_ShedsAfterTimeout)
+{
+    open("Block", 20);
+    fill(EventLatency_Normal);
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_THAT(offer(makeRecord(EventLatency_Normal), true), Eq(STATUS_EBUSY));
+    EXPECT_THAT(std::chrono::steady_clock::now() - start, Ge(std::chrono::milliseconds(20)));
+    EXPECT_THAT(shedCount, Eq(1u));
+}
+
+TEST_F(OfflineStorageHandlerTests, Overload_DropNewest_StaysBounded)
+{
+    open("DropNewest");
+    expectBoundedUnderOverload();
+}
+
+TEST_F(OfflineStorageHandlerTests, Overload_DropOldest_StaysBounded)
+{
+    open("DropOldest");
+    expectBoundedUnderOverload();
+}
+
+TEST_F(OfflineStorageHandlerTests, Overload_DropByPersistence_StaysBounded)
+{
+    open("DropByPersistence");
+    expectBoundedUnderOverload();
+}
+
+TEST_F(OfflineStorageHandlerTests, Overload_Block_StaysBounded)
+{
+    // Producers that may not wait get the DropNewest behavior
+    open("Block");
+    expectBoundedUnderOverload();
+}
@@ -15,6 +15,7 @@
 #ifdef ANDROID
 #include "offline/OfflineStorage_Room.hpp"
 #endif
+#include "offline/OfflineStorage_SegmentLog.hpp"
 #include "offline/OfflineStorage_SQLite.hpp"
 #include "NullObjects.hpp"
 #include <functional>
@@ -30,7 +31,8 @@ using namespace testing;
 enum class StorageImplementation {
     Room,
     SQLite,
-    Memory
+    Memory,
+    SegmentLog
 };
 
 std::ostream & operator<<(std::ostream &o, StorageImplementation i) {
@@ -41,6 +43,8 @@ std::ostream & operator<<(std::ostream &o, StorageImplementation i) {
             return o << "SQLite";
         case StorageImplementation ::Memory:
             return o << "Memory";
+        case StorageImplementation::SegmentLog:
+            return o << "SegmentLog";
         default:
             return o << static_cast<int>(i);
     }
@@ -83,6 +87,13 @@ public:
             case StorageImplementation::Memory:
                 offlineStorage = std::make_unique<MAE::MemoryStorage>(nullLogManager, configMock);
                 break;
+            case StorageImplementation::SegmentLog:
+                name << MAE::GetTempDirectory() << "OfflineStorageTestsSegmentLog.db";
+                configMock[CFG_STR_CACHE_FILE_PATH] = name.str();
+                offlineStorage = std::make_unique<MAE::OfflineStorage_SegmentLog>(nullLogManager, configMock);
+                EXPECT_CALL(observerMock, OnStorageOpened("SegmentLog/Default"))
+                        .RetiresOnSaturation();
+                break;
         }
 
         offlineStorage->Initialize(observerMock);
@@ -161,6 +172,15 @@ TEST_P(OfflineStorageTestsRoom, TestBadFile)
         case StorageImplementation::SQLite:
             path = path + "BadDatabase.db";
             break;
+        case StorageImplementation::SegmentLog:
+            // A manifest that lists one segment, which is not valid
+            path = path + "BadSegmentLog.db";
+            {
+                auto manifest = std::ofstream(path + ".segments");
+                manifest << "0 1" << std::endl;
+            }
+            path = path + ".0.seg";
+            break;
     }
     auto badFile = std::ofstream(path);
     badFile << "this is a BAD database" << std::endl;
@@ -183,6 +203,12 @@ TEST_P(OfflineStorageTestsRoom, TestBadFile)
                 .RetiresOnSaturation();
             EXPECT_CALL(observerMock, OnStorageFailed("1")).RetiresOnSaturation();
             break;
+        case StorageImplementation::SegmentLog:
+            configMock[CFG_STR_CACHE_FILE_PATH] = GetTempDirectory() + "BadSegmentLog.db";
+            badStorage = std::make_unique<MAE::OfflineStorage_SegmentLog>(nullLogManager, configMock);
+            EXPECT_CALL(observerMock, OnStorageOpened("SegmentLog/Default"))
+                .RetiresOnSaturation();
+            break;
         default:
             return;
     }
@@ -225,6 +251,27 @@ TEST_P(OfflineStorageTestsRoom, TestStoreRecords)
     }
 }
 
+TEST_P(OfflineStorageTestsRoom, TestStoreRecordsBatchReturnsStoredCount)
+{
+    auto now = PAL::getUtcSystemTimeMs();
+    StorageRecordVector records;
+    for (size_t i = 0; i < 1000; ++i) {
+        std::ostringstream id_stream;
+        id_stream << "Batch-" << i;
+        records.emplace_back(
+                id_stream.str(),
+                "token",
+                (i % 2) ? EventLatency_Normal : EventLatency_RealTime,
+                EventPersistence_Normal,
+                now,
+                StorageBlob {1, 2, 3});
+    }
+    EXPECT_EQ(1000, offlineStorage->StoreRecords(records));
+    EXPECT_EQ(500, offlineStorage->GetRecordCount(EventLatency_Normal));
+    EXPECT_EQ(500, offlineStorage->GetRecordCount(EventLatency_RealTime));
+    EXPECT_EQ(1000, offlineStorage->GetRecordCount(EventLatency_Unspecified));
+}
+
 std::ostream & operator<<(std::ostream &os, EventLatency const &latency)
 {
     switch (latency) {
@@ -558,6 +605,11 @@ TEST_P(OfflineStorageTestsRoom, ResizeDB)
         index += 1;
     }
     auto preCount = offlineStorage->GetRecordCount();
+    if (implementation == StorageImplementation::SegmentLog) {
+        // Reports the records dropped per tenant
+        EXPECT_CALL(observerMock, OnStorageTrimmed(Contains(Key("TenantFred"))))
+                .WillOnce(Return());
+    }
     offlineStorage->ResizeDb();
     auto postCount = offlineStorage->GetRecordCount();
     EXPECT_GT(preCount, postCount);
@@ -604,10 +656,42 @@ TEST_P(OfflineStorageTestsRoom, StoreManyRecords)
     EXPECT_EQ(blocks * blockSize, offlineStorage->GetRecordCount());
 }
 
+TEST_P(OfflineStorageTestsRoom, CompressedRecordsAreRestored)
+{
+    if (implementation != StorageImplementation::SQLite) {
+        return;
+    }
+    auto now = PAL::getUtcSystemTimeMs();
+    StorageBlob compressible(4096, 0x29);
+    StorageBlob tiny {0x29, 0x01};
+    StorageRecordVector plain;
+    plain.emplace_back("plain", "plain", EventLatency_Normal, EventPersistence_Normal, now, StorageBlob(compressible));
+    offlineStorage->StoreRecords(plain);
+    offlineStorage->Shutdown();
+
+    configMock[CFG_BOOL_ENABLE_DB_COMPRESS] = true;
+    offlineStorage = std::make_unique<MAE::OfflineStorage_SQLite>(nullLogManager, configMock);
+    configMock[CFG_BOOL_ENABLE_DB_COMPRESS] = false;
+    EXPECT_CALL(observerMock, OnStorageOpened("SQLite/Default"))
+            .RetiresOnSaturation();
+    offlineStorage->Initialize(observerMock);
+
+    StorageRecordVector records;
+    records.emplace_back("compressed", "compressed", EventLatency_Normal, EventPersistence_Normal, now, StorageBlob(compressible));
+    records.emplace_back("tiny", "tiny", EventLatency_Normal, EventPersistence_Normal, now, StorageBlob(tiny));
+    offlineStorage->StoreRecords(records);
+
+    auto found = offlineStorage->GetRecords(false, EventLatency_Unspecified, 0);
+    ASSERT_EQ(3, found.size());
+    for (auto const & record : found) {
+        EXPECT_EQ(record.tenantToken == "tiny" ? tiny : compressible, record.blob) << record.tenantToken;
+    }
+}
+
 #ifdef ANDROID
-auto values = Values(StorageImplementation::Room, StorageImplementation::SQLite, StorageImplementation::Memory);
+auto values = Values(StorageImplementation::Room, StorageImplementation::SQLite, StorageImplementation::Memory, StorageImplementation::SegmentLog);
 #else
-auto values = Values(StorageImplementation::SQLite, StorageImplementation::Memory);
+auto values = Values(StorageImplementation::SQLite, StorageImplementation::Memory, StorageImplementation::SegmentLog);
 #endif
 
 INSTANTIATE_TEST_CASE_P(Storage,
@@ -0,0 +1,298 @@
+//
+// Copyright (c) 2015-2020 Microsoft Corporation and Contributors.
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "common/Common.hpp"
+#include "common/MockIOfflineStorageObserver.hpp"
+#include "config/RuntimeConfig_Default.hpp"
+#include "offline/OfflineStorage_SQLite.hpp"
+
+#include "NullObjects.hpp"
+
+#include "sqlite3.h"
+
+#include <cstdio>
+
+using namespace testing;
+using namespace MAT;
+
+char const* const TEST_SQLITE_SCHEMA_PATH = "OfflineStorageTests_SQLiteSchema.db";
+
+class OfflineStorageTests_SQLiteSchema : public Test
+{
+  protected:
+    NullLogManager                              logManager;
+    ILogConfiguration                           configuration;
+    std::unique_ptr<RuntimeConfig_Default>      runtimeConfig;
+    NiceMock<MockIOfflineStorageObserver>       observer;
+    std::unique_ptr<OfflineStorage_SQLite>      storage;
+
+    virtual void SetUp() override
+    {
+        removeFiles();
+        configuration[CFG_STR_CACHE_FILE_PATH] = TEST_SQLITE_SCHEMA_PATH;
+        runtimeConfig.reset(new RuntimeConfig_Default(configuration));
+    }
+
+    virtual void TearDown() override
+    {
+        if (storage)
+        {
+            storage->Shutdown();
+        }
+        removeFiles();
+    }
+
+    static void removeFiles()
+    {
+        std::remove(TEST_SQLITE_SCHEMA_PATH);
+        std::remove((std::string(TEST_SQLITE_SCHEMA_PATH) + "-wal").c_str());
+        std::remove((std::string(TEST_SQLITE_SCHEMA_PATH) + "-shm").c_str());
+    }
+
+    void open()
+    {
+        storage.reset(new OfflineStorage_SQLite(logManager, *runtimeConfig));
+        storage->Initialize(observer);
+    }
+
+    void close()
+    {
+        storage->Shutdown();
+        storage.reset();
+    }
+
+    /// Runs a query on the database file outside of the storage and returns
+    /// the first column of the first row
+    static std::string query(char const* sql)
+    {
+        sqlite3* db = nullptr;
+        std::string result;
+        if (sqlite3_open(TEST_SQLITE_SCHEMA_PATH, &db) == SQLITE_OK)
+        {
+            sqlite3_stmt* stmt = nullptr;
+            if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK)
+            {
+                if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0) != nullptr)
+                {
+                    result = reinterpret_cast<char const*>(sqlite3_column_text(stmt, 0));
+                }
+                sqlite3_finalize(stmt);
+            }
+        }
+        sqlite3_close(db);
+        return result;
+    }
+
+    static bool execute(char const* sql)
+    {
+        sqlite3* db = nullptr;
+        bool result = (sqlite3_open(TEST_SQLITE_SCHEMA_PATH, &db) == SQLITE_OK) &&
+                      (sqlite3_exec(db, sql, nullptr, nullptr, nullptr) == SQLITE_OK);
+        sqlite3_close(db);
+        return result;
+    }
+
+    static StorageRecord makeRecord(std::string const& tenantToken, int64_t timestamp, EventLatency latency = EventLatency_Normal)
+    {
+        return StorageRecord(PAL::generateUuidString(), tenantToken, latency, EventPersistence_Normal, timestamp, std::vector<uint8_t>{ 1, 2, 3 });
+    }
+
+    std::vector<StorageRecord> reserve(unsigned maxCount = 0)
+    {
+        std::vector<StorageRecord> records;
+        storage->GetAndReserveRecords([&records](StorageRecord&& record) {
+            records.push_back(std::move(record));
+            return true;
+        }, 60000, EventLatency_Normal, maxCount);
+        return records;
+    }
+
+    static std::vector<StorageRecordId> ids(std::vector<StorageRecord> const& records)
+    {
+        std::vector<StorageRecordId> result;
+        for (auto const& record : records)
+        {
+            result.push_back(record.id);
+        }
+        return result;
+    }
+};
+
+TEST_F(OfflineStorageTests_SQLiteSchema, Initialize_CreatesCurrentSchema)
+{
+    EXPECT_CALL(observer, OnStorageOpened("SQLite/Default"));
+    open();
+    close();
+    EXPECT_THAT(query("PRAGMA user_version"), Eq("2"));
+    EXPECT_THAT(query("SELECT type FROM pragma_table_info('events') WHERE name='record_id'"), Eq("INTEGER"));
+    EXPECT_THAT(query("SELECT count(*) FROM sqlite_master WHERE name='tenants'"), Eq("1"));
+}
+
+TEST_F(OfflineStorageTests_SQLiteSchema, StoreRecords_KeepsEachTenantTokenOnce)
+{
+    open();
+    std::vector<StorageRecord> records { makeRecord("tenant-a", 1000), makeRecord("tenant-b", 1001), makeRecord("tenant-a", 1002) };
+    EXPECT_THAT(storage->StoreRecords(records), Eq(3u));
+    close();
+
+    EXPECT_THAT(query("SELECT count(*) FROM tenants"), Eq("2"));
+    EXPECT_THAT(query("SELECT count(DISTINCT tenant_id) FROM events"), Eq("2"));
+
+    open();
+    auto reserved = reserve();
+    ASSERT_THAT(reserved, SizeIs(3));
+    EXPECT_THAT(reserved[0].tenantToken, Eq("tenant-a"));
+    EXPECT_THAT(reserved[1].tenantToken, Eq("tenant-b"));
+    EXPECT_THAT(reserved[2].tenantToken, Eq("tenant-a"));
+    EXPECT_THAT(reserved[2].blob, ElementsAre(1, 2, 3));
+}
+
+TEST_F(OfflineStorageTests_SQLiteSchema, DeleteAndReleaseRecords_UseIntegerIds)
+{
+    open();
+    std::vector<StorageRecord> records;
+    for (int64_t i = 0; i < 6; i++)
+    {
+        records.push_back(makeRecord("tenant-a", 1000 + i));
+    }
+    storage->StoreRecords(records);
+
+    auto reserved = ids(reserve());
+    ASSERT_THAT(reserved, SizeIs(6));
+    EXPECT_THAT(reserve(), IsEmpty());
+
+    // Two ranges and a stray id that is not a record id
+    HttpHeaders headers;
+    bool fromMemory = false;
+    storage->DeleteRecords(std::vector<StorageRecordId>{ reserved[4], reserved[0], reserved[1], "invalid" }, headers, fromMemory);
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Eq(3u));
+
+    storage->ReleaseRecords(std::vector<StorageRecordId>{ reserved[2], reserved[3] }, false, headers, fromMemory);
+    EXPECT_THAT(ids(reserve()), ElementsAre(reserved[2], reserved[3]));
+    EXPECT_THAT(reserve(), IsEmpty());
+}
+
+TEST_F(OfflineStorageTests_SQLiteSchema, StoreRecord_HandsOutItsOwnIds)
+{
+    open();
+    StorageRecord record = makeRecord("tenant-a", 1000);
+    std::string storedId = record.id;
+    storage->StoreRecord(record);
+
+    auto reserved = ids(reserve());
+    ASSERT_THAT(reserved, SizeIs(1));
+    EXPECT_THAT(reserved[0], Ne(storedId));
+
+    // Only the id handed out by the storage refers to the record
+    HttpHeaders headers;
+    bool fromMemory = false;
+    storage->DeleteRecords(std::vector<StorageRecordId>{ storedId }, headers, fromMemory);
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Eq(1u));
+    storage->DeleteRecords(reserved, headers, fromMemory);
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Eq(0u));
+}
+
+TEST_F(OfflineStorageTests_SQLiteSchema, DeleteRecords_ReplayedDeleteDoesNotHitNewerRecords)
+{
+    open();
+    std::vector<StorageRecord> records;
+    for (int64_t i = 0; i < 4; i++)
+    {
+        records.push_back(makeRecord("tenant-a", 1000 + i));
+    }
+    storage->StoreRecords(records);
+
+    auto reserved = ids(reserve());
+    ASSERT_THAT(reserved, SizeIs(4));
+
+    // Delete the newest rows, so that a recycled rowid would reuse their ids
+    HttpHeaders headers;
+    bool fromMemory = false;
+    std::vector<StorageRecordId> newest { reserved[2], reserved[3] };
+    storage->DeleteRecords(newest, headers, fromMemory);
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Eq(2u));
+
+    std::vector<StorageRecord> more { makeRecord("tenant-a", 2000), makeRecord("tenant-a", 2001) };
+    storage->StoreRecords(more);
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Eq(4u));
+
+    // A duplicate acknowledgement of the old ids must not delete the new rows
+    storage->DeleteRecords(newest, headers, fromMemory);
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Eq(4u));
+
+    // Also holds across a reopen
+    close();
+    open();
+    storage->DeleteRecords(newest, headers, fromMemory);
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Eq(4u));
+}
+
+TEST_F(OfflineStorageTests_SQLiteSchema, DeleteRecords_ByTenantToken)
+{
+    open();
+    std::vector<StorageRecord> records { makeRecord("tenant-a", 1000), makeRecord("tenant-b", 1001), makeRecord("tenant-a", 1002) };
+    storage->StoreRecords(records);
+
+    storage->DeleteRecords({ { "tenant_token", "tenant-a" } });
+    auto remaining = reserve();
+    ASSERT_THAT(remaining, SizeIs(1));
+    EXPECT_THAT(remaining[0].tenantToken, Eq("tenant-b"));
+}
+
+TEST_F(OfflineStorageTests_SQLiteSchema, ReleaseRecords_ReportsDroppedRecordsByTenant)
+{
+    open();
+    std::vector<StorageRecord> records { makeRecord("tenant-a", 1000), makeRecord("tenant-b", 1001) };
+    storage->StoreRecords(records);
+
+    HttpHeaders headers;
+    bool fromMemory = false;
+    EXPECT_CALL(observer, OnStorageRecordsDropped(ElementsAre(Pair("tenant-a", 1))));
+    unsigned maxRetryCount = runtimeConfig->GetMaximumRetryCount();
+    for (unsigned i = 0; i <= maxRetryCount; i++)
+    {
+        auto reserved = ids(reserve());
+        ASSERT_THAT(reserved, Not(IsEmpty()));
+        storage->ReleaseRecords({ reserved[0] }, true, headers, fromMemory);
+        if (reserved.size() > 1)
+        {
+            storage->ReleaseRecords({ reserved[1] }, false, headers, fromMemory);
+        }
+    }
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Eq(1u));
+}
+
+TEST_F(OfflineStorageTests_SQLiteSchema, Initialize_UpgradesVersion1Database)
+{
+    ASSERT_TRUE(execute(
+        "CREATE TABLE events (record_id TEXT, tenant_token TEXT NOT NULL, latency INTEGER, persistence INTEGER,"
+        " timestamp INTEGER, retry_count INTEGER DEFAULT 0, reserved_until INTEGER DEFAULT 0, payload BLOB);"
+        "CREATE INDEX k_latency_timestamp ON events (latency DESC, persistence DESC, timestamp ASC);"
+        "CREATE TABLE settings (name TEXT, value TEXT, PRIMARY KEY (name));"
+        "CREATE TABLE packages (id INTEGER);"
+        "INSERT INTO events VALUES ('b6a3c2e1-0000-0000-0000-000000000002', 'tenant-b', 2, 1, 2000, 1, 99999999999999, x'0405');"
+        "INSERT INTO events VALUES ('b6a3c2e1-0000-0000-0000-000000000001', 'tenant-a', 1, 1, 1000, 0, 0, x'010203');"
+        "INSERT INTO settings VALUES ('name', 'value');"
+        "PRAGMA user_version=1;"));
+
+    EXPECT_CALL(observer, OnStorageOpened("SQLite/Default"));
+    open();
+    EXPECT_THAT(storage->GetSetting("name"), Eq("value"));
+
+    // Reservations of the previous session are dropped, retry counts kept
+    auto records = reserve();
+    ASSERT_THAT(records, SizeIs(2));
+    EXPECT_THAT(records[0].tenantToken, Eq("tenant-b"));
+    EXPECT_THAT(records[0].latency, Eq(EventLatency_CostDeferred));
+    EXPECT_THAT(records[0].retryCount, Eq(1));
+    EXPECT_THAT(records[0].blob, ElementsAre(4, 5));
+    EXPECT_THAT(records[1].tenantToken, Eq("tenant-a"));
+    EXPECT_THAT(records[1].timestamp, Eq(1000));
+    EXPECT_THAT(records[1].blob, ElementsAre(1, 2, 3));
+    close();
+
+    EXPECT_THAT(query("PRAGMA user_version"), Eq("2"));
+    EXPECT_THAT(query("SELECT count(*) FROM sqlite_master WHERE name='events_v1'"), Eq("0"));
+    EXPECT_THAT(query("SELECT count(*) FROM tenants"), Eq("2"));
+}
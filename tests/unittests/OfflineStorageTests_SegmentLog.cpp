@@ -0,0 +1,274 @@
+//
+// Copyright (c) 2015-2020 Microsoft Corporation and Contributors.
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "common/Common.hpp"
+#include "common/MockIOfflineStorageObserver.hpp"
+#include "config/RuntimeConfig_Default.hpp"
+#include "offline/OfflineStorage_SegmentLog.hpp"
+#include "utils/FileUtils.hpp"
+
+#include "NullObjects.hpp"
+
+#include <fstream>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+using namespace testing;
+using namespace MAT;
+
+char const* const TEST_SEGMENT_LOG_PATH = "OfflineStorageTests_SegmentLog.db";
+
+class OfflineStorageTests_SegmentLog : public Test
+{
+  protected:
+    NullLogManager                              logManager;
+    ILogConfiguration                           configuration;
+    std::unique_ptr<RuntimeConfig_Default>      runtimeConfig;
+    NiceMock<MockIOfflineStorageObserver>       observer;
+    std::unique_ptr<OfflineStorage_SegmentLog>  storage;
+
+    virtual void SetUp() override
+    {
+        configuration[CFG_STR_CACHE_FILE_PATH] = TEST_SEGMENT_LOG_PATH;
+        configuration[CFG_INT_CACHE_SEGMENT_SIZE] = 4096;
+        runtimeConfig.reset(new RuntimeConfig_Default(configuration));
+        open();
+        storage->DeleteAllRecords();
+    }
+
+    virtual void TearDown() override
+    {
+        storage->DeleteAllRecords();
+        storage->Shutdown();
+        FileDelete((std::string(TEST_SEGMENT_LOG_PATH) + ".segments").c_str());
+        FileDelete((std::string(TEST_SEGMENT_LOG_PATH) + ".settings").c_str());
+    }
+
+    void open()
+    {
+        storage.reset(new OfflineStorage_SegmentLog(logManager, *runtimeConfig));
+        storage->Initialize(observer);
+    }
+
+    void reopen()
+    {
+        storage->Shutdown();
+        open();
+    }
+
+    static StorageRecord makeRecord(std::string const& id, EventLatency latency, size_t blobSize = 3)
+    {
+        std::vector<uint8_t> blob(blobSize);
+        for (size_t i = 0; i < blobSize; i++)
+        {
+            blob[i] = static_cast<uint8_t>(id.back() + i);
+        }
+        return StorageRecord(id, "tenant-token", latency, EventPersistence_Normal, 1234567890 + id.back(), std::move(blob));
+    }
+
+    std::vector<StorageRecord> reserve(EventLatency minLatency = EventLatency_Normal, unsigned maxCount = 0)
+    {
+        std::vector<StorageRecord> records;
+        storage->GetAndReserveRecords([&records](StorageRecord&& record) {
+            records.push_back(std::move(record));
+            return true;
+        }, 60000, minLatency, maxCount);
+        return records;
+    }
+
+    static std::vector<std::string> ids(std::vector<StorageRecord> const& records)
+    {
+        std::vector<std::string> result;
+        for (auto const& record : records)
+        {
+            result.push_back(record.id);
+        }
+        return result;
+    }
+};
+
+TEST_F(OfflineStorageTests_SegmentLog, Initialize_ReportsSegmentLog)
+{
+    EXPECT_CALL(observer, OnStorageOpened("SegmentLog/Default"));
+    reopen();
+}
+
+TEST_F(OfflineStorageTests_SegmentLog, GetAndReserveRecords_ReturnsHighestLatencyFirstInStoreOrder)
+{
+    storage->StoreRecord(makeRecord("n1", EventLatency_Normal));
+    storage->StoreRecord(makeRecord("r1", EventLatency_RealTime));
+    storage->StoreRecord(makeRecord("n2", EventLatency_Normal));
+    storage->StoreRecord(makeRecord("r2", EventLatency_RealTime));
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Eq(4u));
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_RealTime), Eq(2u));
+
+    auto records = reserve(EventLatency_Normal, 3);
+    EXPECT_THAT(ids(records), ElementsAre("r1", "r2", "n1"));
+    EXPECT_THAT(records[0].blob, ElementsAre('1', '2', '3'));
+    EXPECT_THAT(records[0].timestamp, Eq(1234567890 + '1'));
+    EXPECT_THAT(storage->LastReadRecordCount(), Eq(3u));
+
+    // Reserved records are not handed out again
+    EXPECT_THAT(ids(reserve()), ElementsAre("n2"));
+    EXPECT_THAT(reserve(), IsEmpty());
+}
+
+TEST_F(OfflineStorageTests_SegmentLog, ReleaseRecords_DropsRecordsOverMaximumRetryCount)
+{
+    storage->StoreRecord(makeRecord("a1", EventLatency_Normal));
+    storage->StoreRecord(makeRecord("b1", EventLatency_Normal));
+    HttpHeaders headers;
+    bool fromMemory = false;
+
+    storage->ReleaseRecords(ids(reserve()), false, headers, fromMemory);
+    EXPECT_THAT(ids(reserve()), ElementsAre("a1", "b1"));
+
+    EXPECT_CALL(observer, OnStorageRecordsDropped(ElementsAre(Pair("tenant-token", 1))));
+    unsigned maxRetryCount = runtimeConfig->GetMaximumRetryCount();
+    for (unsigned i = 0; i <= maxRetryCount; i++)
+    {
+        storage->ReleaseRecords({ "a1" }, true, headers, fromMemory);
+        reserve();
+    }
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Eq(1u));
+}
+
+TEST_F(OfflineStorageTests_SegmentLog, DeleteRecords_RemovesSegmentOnceAllItsRecordsAreGone)
+{
+    // 1 KiB records, three per 4 KiB segment
+    for (char c = '0'; c <= '5'; c++)
+    {
+        storage->StoreRecord(makeRecord(std::string("r") + c, EventLatency_Normal, 1024));
+    }
+    auto records = reserve();
+    ASSERT_THAT(records, SizeIs(6));
+    size_t size = storage->GetSize();
+
+    HttpHeaders headers;
+    bool fromMemory = false;
+    storage->DeleteRecords(std::vector<StorageRecordId>{ "r0", "r1" }, headers, fromMemory);
+    EXPECT_THAT(storage->GetSize(), Eq(size));
+
+    storage->DeleteRecords(std::vector<StorageRecordId>{ "r2" }, headers, fromMemory);
+    EXPECT_THAT(storage->GetSize(), Lt(size));
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Normal), Eq(3u));
+
+    reopen();
+    EXPECT_THAT(ids(reserve()), ElementsAre("r3", "r4", "r5"));
+}
+
+TEST_F(OfflineStorageTests_SegmentLog, DeleteRecords_PartialDeleteSurvivesReopen)
+{
+    for (char c = '0'; c <= '3'; c++)
+    {
+        storage->StoreRecord(makeRecord(std::string("r") + c, EventLatency_Normal));
+    }
+    auto records = reserve();
+    ASSERT_THAT(records, SizeIs(4));
+
+    // The segment keeps pending records, so it is not deleted
+    HttpHeaders headers;
+    bool fromMemory = false;
+    storage->DeleteRecords(std::vector<StorageRecordId>{ "r0", "r2" }, headers, fromMemory);
+
+    reopen();
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Eq(2u));
+    EXPECT_THAT(ids(reserve()), ElementsAre("r1", "r3"));
+
+    // Also without a clean shutdown
+    storage->DeleteRecords(std::vector<StorageRecordId>{ "r1" }, headers, fromMemory);
+    storage.reset();
+    open();
+    EXPECT_THAT(ids(reserve()), ElementsAre("r3"));
+}
+
+TEST_F(OfflineStorageTests_SegmentLog, StoreRecord_SameIdReplacesRecord)
+{
+    storage->StoreRecord(makeRecord("r1", EventLatency_Normal));
+    storage->StoreRecord(makeRecord("r1", EventLatency_RealTime));
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Eq(1u));
+
+    reopen();
+    auto records = reserve();
+    ASSERT_THAT(records, SizeIs(1));
+    EXPECT_THAT(records[0].latency, Eq(EventLatency_RealTime));
+}
+
+#ifndef _WIN32
+TEST_F(OfflineStorageTests_SegmentLog, StoreRecord_AllocatesSegmentBlocksUpFront)
+{
+    configuration[CFG_INT_CACHE_SEGMENT_SIZE] = 1024 * 1024;
+    runtimeConfig.reset(new RuntimeConfig_Default(configuration));
+    reopen();
+    storage->StoreRecord(makeRecord("r1", EventLatency_Normal));
+
+    // A sparse segment would fail with SIGBUS on a full disk
+    struct stat st;
+    ASSERT_THAT(::stat((std::string(TEST_SEGMENT_LOG_PATH) + ".0.seg").c_str(), &st), Eq(0));
+    EXPECT_THAT(static_cast<long long>(st.st_blocks) * 512, Ge(static_cast<long long>(st.st_size)));
+}
+#endif
+
+TEST_F(OfflineStorageTests_SegmentLog, Initialize_RecoversRecordsUpToTornWrite)
+{
+    storage->StoreRecord(makeRecord("r1", EventLatency_Normal, 100));
+    storage->StoreRecord(makeRecord("r2", EventLatency_Normal, 100));
+    storage->StoreRecord(makeRecord("r3", EventLatency_Normal, 100));
+    storage->Shutdown();
+
+    // Damage the payload of the last record
+    std::string segment = std::string(TEST_SEGMENT_LOG_PATH) + ".0.seg";
+    {
+        std::fstream file(segment, std::ios::in | std::ios::out | std::ios::binary);
+        ASSERT_TRUE(file.is_open());
+        size_t frameSize = 8 + 12 + 2 + 2 + 2 + 12 + 4 + 100;
+        file.seekp(16 + 3 * frameSize - 1);
+        file.put(static_cast<char>(0xFF));
+    }
+
+    open();
+    EXPECT_THAT(ids(reserve()), ElementsAre("r1", "r2"));
+
+    // New records go in after the last valid one
+    storage->StoreRecord(makeRecord("r4", EventLatency_Normal, 100));
+    reopen();
+    EXPECT_THAT(ids(reserve()), ElementsAre("r1", "r2", "r4"));
+}
+
+TEST_F(OfflineStorageTests_SegmentLog, Settings_ArePersisted)
+{
+    EXPECT_THAT(storage->StoreSetting("name", "value"), true);
+    EXPECT_THAT(storage->StoreSetting("other", "x"), true);
+    EXPECT_THAT(storage->DeleteSetting("other"), true);
+    reopen();
+    EXPECT_THAT(storage->GetSetting("name"), Eq("value"));
+    EXPECT_THAT(storage->GetSetting("other"), Eq(""));
+
+    EXPECT_THAT(storage->StoreSetting("name", ""), true);
+    reopen();
+    EXPECT_THAT(storage->GetSetting("name"), Eq(""));
+}
+
+TEST_F(OfflineStorageTests_SegmentLog, ResizeDb_DropsOldestSegments)
+{
+    configuration[CFG_INT_CACHE_FILE_SIZE] = 8192;
+    storage->Shutdown();
+    open();
+
+    for (char c = '0'; c <= '8'; c++)
+    {
+        storage->StoreRecord(makeRecord(std::string("r") + c, (c % 2) ? EventLatency_RealTime : EventLatency_Normal, 1024));
+    }
+
+    EXPECT_CALL(observer, OnStorageTrimmed(_));
+    EXPECT_THAT(storage->ResizeDb(), true);
+    EXPECT_THAT(storage->GetSize(), Le(8192u * 3 / 4 + 1024));
+    // The oldest records went first
+    EXPECT_THAT(storage->GetRecordCount(EventLatency_Unspecified), Lt(9u));
+    auto remaining = ids(storage->GetRecords(true, EventLatency_Normal));
+    EXPECT_THAT(remaining, Contains("r8"));
+    EXPECT_THAT(remaining, Not(Contains("r0")));
+}
@@ -130,6 +130,7 @@ TEST_F(PackagerTests, HonorsMaximumPackageSize)
     }
     EXPECT_THAT(i, 4);
     EXPECT_THAT(wantMore, false);
+    EXPECT_THAT(ctx->packageFull, true);
 
     EXPECT_CALL(*this, resultPackagedEvents(ctx))
         .WillOnce(Return());
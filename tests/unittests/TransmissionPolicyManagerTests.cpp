@@ -11,6 +11,8 @@
 #include "tpm/TransmissionPolicyManager.hpp"
 #include "TransmitProfiles.hpp"
 
+#include <thread>
+
 using namespace testing;
 using namespace MAT;
 
@@ -233,6 +235,71 @@ TEST_F(TransmissionPolicyManagerTests, NoUploadForNegative)
     TransmitProfiles::reset();
 }
 
+TEST_F(TransmissionPolicyManagerTests, IncomingEventsFromManyThreadsWhileProfileChanges)
+{
+    tpm.paused(false);
+
+    std::string customProfiles = R"(
+        [
+            {
+                "name": "Fred",
+                "rules": [
+                    {"timers": [ 4, 2, 1 ]}
+                ]
+            },
+            {
+                "name": "Barney",
+                "rules": [
+                    {"timers": [ 8, 4, 2 ]}
+                ]
+            }
+        ]
+    )";
+    EXPECT_TRUE(TransmitProfiles::load(customProfiles));
+
+    EXPECT_CALL(tpm, scheduleUpload(_, _, _))
+        .WillRepeatedly(Invoke(&tpm, &TransmissionPolicyManager4Test::NotMockScheduleUpload));
+    EXPECT_CALL(tpm, uploadAsync(_)).WillRepeatedly(Return());
+
+    std::atomic<bool> done(false);
+    std::thread profileSwitcher([&done]() {
+        for (int i = 0; !done; i++)
+        {
+            TransmitProfiles::setProfile((i % 2) ? "Fred" : "Barney");
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([this]() {
+            for (int i = 0; i < 500; i++)
+            {
+                IncomingEventContext event;
+                event.record.latency = EventLatency_Normal;
+                tpm.eventArrived(&event);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    done = true;
+    profileSwitcher.join();
+
+    // Once the profile settles, the next event picks up its timers
+    EXPECT_TRUE(TransmitProfiles::setProfile("Fred"));
+    IncomingEventContext event;
+    event.record.latency = EventLatency_Normal;
+    tpm.eventArrived(&event);
+    EXPECT_THAT(tpm.m_timerdelay, std::chrono::milliseconds { 1000 });
+
+    tpm.cancelUploadTask();
+    TransmitProfiles::reset();
+}
+
 TEST_F(TransmissionPolicyManagerTests, ImmediateIncomingEventStartsUploadImmediately)
 {
     tpm.paused(false);
@@ -248,6 +315,99 @@ TEST_F(TransmissionPolicyManagerTests, ImmediateIncomingEventStartsUploadImmedia
     EXPECT_THAT(upload->requestedMinLatency, EventLatency_Max);
 }
 
+TEST_F(TransmissionPolicyManagerTests, ImmediateIncomingEventsWithinWindowShareOneUpload)
+{
+    auto& config = testing::getSystem().getConfig();
+    config[CFG_INT_IMMEDIATE_UPLOAD_WINDOW_MS] = 200;
+    config.UpdateSnapshot();
+    tpm.paused(false);
+
+    std::atomic<int> uploads(0);
+    EventsUploadContextPtr upload;
+    EXPECT_CALL(*this, resultInitiateUpload(_))
+        .WillOnce(DoAll(SaveArg<0>(&upload), InvokeWithoutArgs([&uploads]() { uploads++; })));
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([this]() {
+            for (int i = 0; i < 25; i++)
+            {
+                IncomingEventContext event;
+                event.record.latency = EventLatency_Max;
+                event.record.blob.resize(100);
+                tpm.eventArrived(&event);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    EXPECT_THAT(uploads.load(), 0);
+
+    for (int i = 0; (i < 100) && (uploads == 0); i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    config[CFG_INT_IMMEDIATE_UPLOAD_WINDOW_MS] = 0;
+    config.UpdateSnapshot();
+
+    ASSERT_THAT(uploads.load(), 1);
+    EXPECT_THAT(upload->requestedMinLatency, EventLatency_Max);
+    EXPECT_THAT(tpm.activeUploads(), Contains(upload));
+}
+
+TEST_F(TransmissionPolicyManagerTests, ImmediateIncomingEventsFillingPackageStartUploadRightAway)
+{
+    auto& config = testing::getSystem().getConfig();
+    config[CFG_INT_IMMEDIATE_UPLOAD_WINDOW_MS] = 50;
+    config.UpdateSnapshot();
+    tpm.paused(false);
+
+    IncomingEventContext event;
+    event.record.latency = EventLatency_Max;
+    event.record.blob.resize(config.GetMaximumUploadSizeBytes() / 2 + 1);
+    tpm.eventArrived(&event);
+
+    EventsUploadContextPtr upload;
+    EXPECT_CALL(*this, resultInitiateUpload(_))
+        .WillOnce(SaveArg<0>(&upload));
+    tpm.eventArrived(&event);
+    ASSERT_THAT(upload, NotNull());
+    EXPECT_THAT(upload->requestedMinLatency, EventLatency_Max);
+
+    // The window was closed early, nothing else gets uploaded when it expires
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    config[CFG_INT_IMMEDIATE_UPLOAD_WINDOW_MS] = 0;
+    config.UpdateSnapshot();
+}
+
+TEST_F(TransmissionPolicyManagerTests, UploadStartedWithFullPackageSchedulesNextUploadImmediately)
+{
+    auto upload = tpm.fakeActiveUpload(EventLatency_RealTime);
+    upload->packageFull = true;
+    EXPECT_CALL(tpm, scheduleUpload(std::chrono::milliseconds { 0 }, EventLatency_RealTime, false))
+        .WillOnce(Return());
+    EXPECT_THAT(tpm.uploadStarted(upload), true);
+}
+
+TEST_F(TransmissionPolicyManagerTests, UploadStartedWithFullPackageDuringBackoffSchedulesNothing)
+{
+    tpm.increaseBackoff();
+    auto upload = tpm.fakeActiveUpload(EventLatency_RealTime);
+    upload->packageFull = true;
+    EXPECT_CALL(tpm, scheduleUpload(_, _, _)).Times(0);
+    EXPECT_THAT(tpm.uploadStarted(upload), true);
+}
+
+TEST_F(TransmissionPolicyManagerTests, UploadStartedWithPartialPackageSchedulesNothing)
+{
+    auto upload = tpm.fakeActiveUpload(EventLatency_RealTime);
+    EXPECT_CALL(tpm, scheduleUpload(_, _, _)).Times(0);
+    EXPECT_THAT(tpm.uploadStarted(upload), true);
+}
+
 TEST_F(TransmissionPolicyManagerTests, UploadDoesNothingWhenPaused)
 {
     tpm.uploadScheduled(true);
@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2015-2020 Microsoft Corporation and Contributors.
+// SPDX-License-Identifier: Apache-2.0
+//
+#include "common/Common.hpp"
+
+#include "pal/PAL.hpp"
+#include "pal/WorkerThread.hpp"
+
+#include <mutex>
+#include <vector>
+
+using namespace testing;
+using namespace MAT;
+
+namespace
+{
+    struct ExecutionLog
+    {
+        std::mutex            lock;
+        std::vector<uint64_t> targetTimes;
+        std::vector<int>      ids;
+    };
+
+    class LoggingTask : public Task
+    {
+    public:
+        LoggingTask(ExecutionLog& log, int id, uint64_t targetTime) :
+            m_log(log),
+            m_id(id)
+        {
+            Type = Task::TimedCall;
+            TargetTime = targetTime;
+        }
+
+        void operator()() override
+        {
+            std::lock_guard<std::mutex> lock(m_log.lock);
+            m_log.targetTimes.push_back(TargetTime);
+            m_log.ids.push_back(m_id);
+        }
+
+    private:
+        ExecutionLog& m_log;
+        int           m_id;
+    };
+
+    // Join() does not drain pending timers, so wait for them to fire first
+    size_t WaitForExecutions(ExecutionLog& log, size_t expected, unsigned timeoutMs)
+    {
+        for (unsigned waited = 0; ; waited += 10)
+        {
+            {
+                std::lock_guard<std::mutex> lock(log.lock);
+                if (log.ids.size() >= expected || waited >= timeoutMs)
+                {
+                    return log.ids.size();
+                }
+            }
+            PAL::sleep(10);
+        }
+    }
+}
+
+TEST(WorkerThreadTests, RunsTimedTasksInTargetTimeOrder)
+{
+    auto worker = PAL::WorkerThreadFactory::Create();
+    ExecutionLog log;
+
+    // Enqueue out of order, with plenty of duplicate target times
+    const int count = 2000;
+    uint64_t base = PAL::getMonotonicTimeMs() + 200;
+    for (int i = 0; i < count; i++)
+    {
+        worker->Queue(new LoggingTask(log, i, base + static_cast<uint64_t>((i * 7919) % 97)));
+    }
+
+    EXPECT_THAT(WaitForExecutions(log, count, 5000), Eq(static_cast<size_t>(count)));
+    worker->Join();
+
+    ASSERT_THAT(log.targetTimes, SizeIs(count));
+    EXPECT_TRUE(std::is_sorted(log.targetTimes.begin(), log.targetTimes.end()));
+}
+
+TEST(WorkerThreadTests, CancelledTimedTasksDoNotRun)
+{
+    auto worker = PAL::WorkerThreadFactory::Create();
+    ExecutionLog log;
+
+    const int count = 2000;
+    uint64_t base = PAL::getMonotonicTimeMs() + 300;
+    std::vector<Task*> tasks;
+    for (int i = 0; i < count; i++)
+    {
+        tasks.push_back(new LoggingTask(log, i, base + static_cast<uint64_t>(count - i) % 50));
+        worker->Queue(tasks.back());
+    }
+
+    for (int i = 0; i < count; i += 2)
+    {
+        EXPECT_TRUE(worker->Cancel(tasks[i], 0));
+    }
+
+    // Give cancelled timers a chance to fire, should the cancellation have failed
+    PAL::sleep(500);
+    EXPECT_THAT(WaitForExecutions(log, count, 0), Eq(static_cast<size_t>(count / 2)));
+    worker->Join();
+
+    ASSERT_THAT(log.ids, SizeIs(count / 2));
+    for (int id : log.ids)
+    {
+        EXPECT_THAT(id % 2, Eq(1));
+    }
+}
@@ -14,3 +14,33 @@ TEST(ZlibUtilsTests, InflateVector)
     ZlibUtils::InflateVector(compressed, inflated, true);
     ASSERT_EQ(uncompressed, inflated);
 }
+
+TEST(ZlibUtilsTests, DeflateAndInflateZlibVector)
+{
+    std::vector<uint8_t> original;
+    for (size_t i = 0; i < 10000; i++)
+    {
+        original.push_back(static_cast<uint8_t>(i % 17));
+    }
+
+    std::vector<uint8_t> compressed;
+    ASSERT_TRUE(ZlibUtils::DeflateZlibVector(original, compressed));
+    EXPECT_LT(compressed.size(), original.size());
+    EXPECT_TRUE(ZlibUtils::IsZlibStream(compressed));
+
+    std::vector<uint8_t> inflated;
+    ASSERT_TRUE(ZlibUtils::InflateZlibVector(compressed, inflated));
+    EXPECT_EQ(original, inflated);
+
+    compressed.resize(compressed.size() / 2);
+    EXPECT_FALSE(ZlibUtils::InflateZlibVector(compressed, inflated));
+}
+
+TEST(ZlibUtilsTests, IsZlibStreamRejectsBondRecords)
+{
+    // A serialized record starts with a Bond string field header
+    std::vector<uint8_t> record = { 0x29, 0x03, '3', '.', '0', 0x49, 0x04 };
+    EXPECT_FALSE(ZlibUtils::IsZlibStream(record));
+    EXPECT_FALSE(ZlibUtils::IsZlibStream({}));
+    EXPECT_FALSE(ZlibUtils::IsZlibStream({ 0x78, 0x9c }));
+}
@@ -273,6 +273,11 @@ def write_item_writer(self, ft, var, indent):
                     self.wl(indent, 'writer.WriteInt32(static_cast<int32_t>({}));', var)
                 else:
                     self.wl(indent, 'Serialize(writer, {}, false);', var)
+            elif ft['type'] == 'vector' and ft['element'] == 'uint8':
+                # Byte lists (GUIDs) are written in one go, the encoding is the same
+                self.wl(indent, 'writer.WriteContainerBegin({}.size(), {});', var, self.format_cpp_bt_const(ft['element']))
+                self.wl(indent, 'writer.WriteBlob({0}.data(), {0}.size());', var)
+                self.wl(indent, 'writer.WriteContainerEnd();')
             elif ft['type'] == 'vector':
                 self.wl(indent, 'writer.WriteContainerBegin({}.size(), {});', var, self.format_cpp_bt_const(ft['element']))
                 self.wl(indent, 'for (auto const& item{} : {}) {{', indent, var)